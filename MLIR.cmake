@@ -181,6 +181,7 @@ find_mlir_lib(LLVMAsmParser)
 find_mlir_lib(LLVMBinaryFormat)
 find_mlir_lib(LLVMRemarks)
 find_mlir_lib(LLVMIRReader)
+find_mlir_lib(LLVMLinker)
 find_mlir_lib(LLVMMLIRTableGen)
 find_mlir_lib(LLVMTransformUtils)
 find_mlir_lib(LLVMBitstreamReader)
@@ -249,6 +250,7 @@ set(MLIRLibs
         ${LLVMBitReader}
         # strict order verified
         ${LLVMFrontendOpenMP}
+        ${LLVMLinker}
         ${LLVMTransformUtils}
         ${LLVMAnalysis}
         # strict order verified
@@ -276,6 +278,13 @@ list(APPEND CMAKE_MODULE_PATH "${LLVM_CMAKE_DIR}")
 include(AddLLVM)
 include(TableGen)
 
+# Libraries emitting the object files of compiled models for the host.
+include(LLVMConfig)
+llvm_map_components_to_libnames(LLVMCodeGenLibs native codegen ipo)
+# Libraries running constant subgraphs with the JIT at compile time.
+llvm_map_components_to_libnames(LLVMJITLibs
+        orcjit executionengine runtimedyld jitlink native passes)
+
 function(onnx_mlir_tablegen ofn)
   tablegen(MLIR
           ${ARGV}
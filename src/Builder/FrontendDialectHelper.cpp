@@ -7,8 +7,12 @@
 // Helper methods for handling input ONNX models.
 //
 //===----------------------------------------------------------------------===//
+#include <algorithm>
+#include <cstring>
+
 #include <llvm/Support/Endian.h>
 #include <llvm/Support/SwapByteOrder.h>
+#include <llvm/Support/ThreadPool.h>
 
 #include "src/Builder/FrontendDialectHelper.hpp"
 
@@ -59,92 +63,156 @@ bool OnnxMlirSymbolMapping::ContainKey(std::string name) {
 template <typename T>
 struct TransformValueToONNXData {
   static const google::protobuf::RepeatedField<T> data(
-      onnx::TensorProto initializer) {
+      const onnx::TensorProto &initializer) {
     return google::protobuf::RepeatedField<T>();
   }
 };
 
 template <>
 struct TransformValueToONNXData<double> {
-  static const google::protobuf::RepeatedField<double> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<double> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.double_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<float> {
-  static const google::protobuf::RepeatedField<float> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<float> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.float_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<int32_t> {
-  static const google::protobuf::RepeatedField<int32_t> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<int32_t> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.int32_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<int64_t> {
-  static const google::protobuf::RepeatedField<int64_t> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<int64_t> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.int64_data();
   }
 };
 
 // Helper method for constructing an array attribute from a model input.
 template <typename T>
-static std::vector<T> CreateArrayAttribute(onnx::TensorProto initializer) {
-  size_t size;
-  if (initializer.raw_data().size()) {
+static std::vector<T> CreateArrayAttribute(
+    const onnx::TensorProto &initializer) {
+  const auto &rawData = initializer.raw_data();
+  if (rawData.size()) {
     // copy & take care of endianness
-    std::vector<char> byteInitializer;
-    std::copy(initializer.raw_data().begin(), initializer.raw_data().end(),
-        back_inserter(byteInitializer));
-    size = initializer.raw_data().size() / sizeof(T);
-    T *arrayPtr = reinterpret_cast<T *>(&byteInitializer[0]);
-    auto array = std::vector<T>(arrayPtr, arrayPtr + size);
+    std::vector<T> array(rawData.size() / sizeof(T));
+    std::memcpy(array.data(), rawData.data(), array.size() * sizeof(T));
     // Perform byte swap if system endianness is BE.
     // ONNX tensor content raw data is always in LE.
     if (llvm::support::endian::system_endianness() !=
         llvm::support::endianness::little)
-      for (int i = 0; i < array.size(); i++)
+      for (size_t i = 0; i < array.size(); i++)
         llvm::sys::swapByteOrder<T>(array[i]);
 
     return array;
   }
 
   // copy, no need to take care of endianness
-  auto data = TransformValueToONNXData<T>::data(initializer);
-  size = data.size();
-  return std::vector<T>(&data[0], &data[0] + size);
+  const auto &data = TransformValueToONNXData<T>::data(initializer);
+  return std::vector<T>(data.begin(), data.end());
+}
+
+// Check if an initializer of the data type can be imported.
+static bool IsSupportedDataType(int32_t dataType) {
+  return dataType == onnx::TensorProto::FLOAT ||
+         dataType == onnx::TensorProto::INT32 ||
+         dataType == onnx::TensorProto::INT64;
 }
 
 void InitializedTensorMapping::AddMapping(
-    std::string name, onnx::TensorProto tensor) {
+    std::string name, const onnx::TensorProto &tensor) {
+  auto &nameToInitializedTensor = scopes.back().nameToInitializedTensor;
   assert(nameToInitializedTensor.count(name) == 0 &&
          "Tensor initializer already mapped.");
-  nameToInitializedTensor.emplace(name, tensor);
+  nameToInitializedTensor.emplace(name, &tensor);
+}
+
+InitializedTensorMapping::Scope *InitializedTensorMapping::FindScope(
+    const std::string &name) {
+  for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+    if (scope->nameToInitializedTensor.count(name))
+      return &*scope;
+    if (scope->shadowed.count(name))
+      return nullptr;
+  }
+  return nullptr;
 }
 
 bool InitializedTensorMapping::ContainKey(std::string name) {
-  return nameToInitializedTensor.count(name) != 0;
+  return FindScope(name) != nullptr;
+}
+
+void InitializedTensorMapping::DecodeInitializers(
+    mlir::MLIRContext &context, const std::set<std::string> &used) {
+  const auto &nameToInitializedTensor = scopes.back().nameToInitializedTensor;
+  auto &nameToDecodedTensor = scopes.back().nameToDecodedTensor;
+  std::vector<std::pair<const std::string *, const onnx::TensorProto *>>
+      pending;
+  for (const auto &entry : nameToInitializedTensor)
+    if (used.count(entry.first) &&
+        nameToDecodedTensor.count(entry.first) == 0 &&
+        IsSupportedDataType(entry.second->data_type()))
+      pending.emplace_back(&entry.first, entry.second);
+
+  // Every initializer is converted into its own slot, and the attributes are
+  // recorded once all are converted, so that the result does not depend on
+  // the scheduling of the threads. The largest initializers are converted
+  // first to balance the load of the threads.
+  std::vector<mlir::DenseElementsAttr> decoded(pending.size());
+  if (pending.size() > 1) {
+    std::vector<size_t> order(pending.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<size_t> sizes;
+    for (const auto &initializer : pending)
+      sizes.emplace_back(initializer.second->ByteSizeLong());
+    std::stable_sort(order.begin(), order.end(),
+        [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    llvm::ThreadPool pool;
+    for (size_t i : order)
+      pool.async([&, i]() {
+        decoded[i] = onnxTensorProtoToDenseElmAttr(context, *pending[i].second);
+      });
+    pool.wait();
+  } else if (pending.size() == 1) {
+    decoded[0] = onnxTensorProtoToDenseElmAttr(context, *pending[0].second);
+  }
+
+  for (size_t i = 0; i < pending.size(); ++i)
+    nameToDecodedTensor.emplace(*pending[i].first, decoded[i]);
+}
+
+bool InitializedTensorMapping::IsDecoded(const std::string &name) {
+  auto *scope = FindScope(name);
+  return scope && scope->nameToDecodedTensor.count(name) != 0;
 }
 
 mlir::Value InitializedTensorMapping::EmitInitializerForInputTensor(
     mlir::Location loc, mlir::OpBuilder &builder, const std::string &name) {
-  // Initializer for input.
-  onnx::TensorProto initializer = GetInitializedTensor(name);
-
   // Emit ConstantOp and record the mapping between the input and
   // the constant value.
-  // Create value attribute.
-  mlir::DenseElementsAttr denseElmAttr =
-      onnxTensorProtoToDenseElmAttr(builder, initializer);
+  // Create value attribute, unless already converted by DecodeInitializers.
+  auto *scope = FindScope(name);
+  assert(scope && "Tensor initializer not found");
+  mlir::DenseElementsAttr denseElmAttr;
+  auto decoded = scope->nameToDecodedTensor.find(name);
+  if (decoded != scope->nameToDecodedTensor.end())
+    denseElmAttr = decoded->second;
+  else
+    denseElmAttr = onnxTensorProtoToDenseElmAttr(
+        builder, *scope->nameToInitializedTensor.at(name));
 
   // Create ConstantOp for dense array.
   return builder.create<mlir::ONNXConstantOp>(
@@ -153,6 +221,13 @@ mlir::Value InitializedTensorMapping::EmitInitializerForInputTensor(
 
 mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
     mlir::OpBuilder &builder, const onnx::TensorProto &initializer) {
+  return onnxTensorProtoToDenseElmAttr(*builder.getContext(), initializer);
+}
+
+// Only uses the MLIR context to get types and attributes, which are uniqued
+// under a lock, so that initializers can be converted concurrently.
+mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
+    mlir::MLIRContext &context, const onnx::TensorProto &initializer) {
   // Tensor dimensions.
   llvm::ArrayRef<int64_t> tensorDims(
       initializer.dims().data(), initializer.dims().size());
@@ -160,7 +235,7 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   switch (initializer.data_type()) {
   case (onnx::TensorProto::FLOAT): {
     const auto &arrayAttrInitializer = CreateArrayAttribute<float>(initializer);
-    auto elmType = builder.getF32Type();
+    auto elmType = mlir::FloatType::getF32(&context);
     auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
@@ -169,7 +244,7 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   case (onnx::TensorProto::INT32): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<int32_t>(initializer);
-    auto elmType = builder.getIntegerType(32);
+    auto elmType = mlir::IntegerType::get(32, &context);
     auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
@@ -178,7 +253,7 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   case (onnx::TensorProto::INT64): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<int64_t>(initializer);
-    auto elmType = builder.getIntegerType(64);
+    auto elmType = mlir::IntegerType::get(64, &context);
     auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
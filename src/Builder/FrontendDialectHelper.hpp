@@ -12,7 +12,9 @@
 
 #include <numeric>
 #include <regex>
+#include <set>
 #include <tuple>
+#include <vector>
 
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/Attributes.h"
@@ -69,8 +71,33 @@ private:
 };
 
 struct InitializedTensorMapping {
-  // Add new entry.
-  void AddMapping(std::string name, onnx::TensorProto tensor);
+  // Add new entry to the innermost scope. The tensor is not copied, so it
+  // must outlive the mapping.
+  void AddMapping(std::string name, const onnx::TensorProto &tensor);
+
+  // Open the scope of a subgraph, whose initializers and tensors shadow the
+  // initializers of the same name of the enclosing graphs until the scope is
+  // closed.
+  void PushScope() { scopes.emplace_back(); }
+  void PopScope() { scopes.pop_back(); }
+
+  // Hide the initializers of the enclosing graphs named like a tensor of the
+  // innermost scope that is not an initializer.
+  void Shadow(std::string name) { scopes.back().shadowed.insert(name); }
+
+  // Convert the initializers of the innermost scope named in `used` to
+  // DenseElementsAttr on a pool of threads. The byte swapping, the type
+  // conversion and the hashing done by MLIR to unique the attributes, which
+  // makes initializers with the same contents share an attribute, are then
+  // spread over the cores instead of being done on first use by the
+  // importer. Initializers that no node reads are never converted, and
+  // initializers of types that cannot be imported are left to be converted
+  // on first use.
+  void DecodeInitializers(
+      mlir::MLIRContext &context, const std::set<std::string> &used);
+
+  // Check if initializer `name` was converted by DecodeInitializers.
+  bool IsDecoded(const std::string &name);
 
   // Check if input is initialized. Not all inputs are, some of the inputs
   // require input from the user and are not stored inside the ONNX model
@@ -89,19 +116,37 @@ struct InitializedTensorMapping {
       mlir::Location loc, mlir::OpBuilder &builder, const std::string &name);
 
   // Get initialized tensor.
-  onnx::TensorProto &GetInitializedTensor(std::string name) {
-    assert(
-        nameToInitializedTensor.find(name) != nameToInitializedTensor.end() &&
-        "Tensor initializer not found");
-    return nameToInitializedTensor.at(name);
+  const onnx::TensorProto &GetInitializedTensor(std::string name) {
+    auto *scope = FindScope(name);
+    assert(scope && "Tensor initializer not found");
+    return *scope->nameToInitializedTensor.at(name);
   }
 
 private:
-  // Mapping from ONNX tensor name to InitializedTensor.
-  std::map<std::string, onnx::TensorProto> nameToInitializedTensor;
+  // The initializers of a graph.
+  struct Scope {
+    // Mapping from ONNX tensor name to InitializedTensor.
+    std::map<std::string, const onnx::TensorProto *> nameToInitializedTensor;
+    // Mapping from ONNX tensor name to the value of the initializer, once
+    // converted by DecodeInitializers.
+    std::map<std::string, mlir::DenseElementsAttr> nameToDecodedTensor;
+    // Names of the tensors of the graph hiding enclosing initializers.
+    std::set<std::string> shadowed;
+  };
+
+  // Return the innermost scope defining initializer `name`, or nullptr if
+  // `name` is not an initializer visible from the innermost scope.
+  Scope *FindScope(const std::string &name);
+
+  // The scopes of the main graph and of the subgraphs being imported, from
+  // the outermost to the innermost.
+  std::vector<Scope> scopes = std::vector<Scope>(1);
 };
 
 mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
     mlir::OpBuilder &builder, const onnx::TensorProto &initializer);
 
+mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
+    mlir::MLIRContext &context, const onnx::TensorProto &initializer);
+
 } // namespace onnx_mlir
@@ -27,11 +27,6 @@ namespace bstd = mpark;
 namespace onnx_mlir {
 namespace {
 
-/*!
- *  The list of tensors initialized by the ONNX model.
- */
-InitializedTensorMapping initializedTensors;
-
 class FrontendGenImpl {
 public:
   FrontendGenImpl(mlir::MLIRContext &context)
@@ -39,7 +34,10 @@ public:
     module_ = mlir::ModuleOp::create(mlir::UnknownLoc::get(&context));
   }
 
-  mlir::ModuleOp ImportONNXModel(onnx::ModelProto model) {
+  mlir::ModuleOp ImportONNXModel(const onnx::ModelProto &model) {
+    for (const auto &prop : model.metadata_props())
+      if (prop.key() == "onnx-mlir.dim_bounds")
+        ImportDimBounds(prop.value());
     ImportGraph(model.graph());
     return module_;
   }
@@ -51,9 +49,74 @@ private:
   mlir::Value none_;
   // mapping between string name and symbol
   OnnxMlirSymbolMapping frontend_symbols_;
+  // tensors initialized by the model, referring to its TensorProtos
+  InitializedTensorMapping initializedTensors;
+  // upper bounds of the dynamic dimensions of the inputs, by dim_param
+  std::map<std::string, int64_t> dim_bounds_;
 
   mlir::Location UnknownLoc() { return mlir::UnknownLoc::get(&context_); }
 
+  // The location of the operation imported from a node carries the name of
+  // the node, so that the code generated for it can be traced back to it.
+  mlir::Location NodeLoc(const onnx::NodeProto &node) {
+    if (node.name().empty())
+      return UnknownLoc();
+    return mlir::NameLoc::get(
+        mlir::Identifier::get(node.name(), &context_), &context_);
+  }
+
+  /*!
+   * Import the upper bounds of the dynamic dimensions of the inputs annotated
+   * in the metadata of the model, as a comma separated list of
+   * <dim_param>=<bound>, e.g. "batch=64,seq=512".
+   * @param annotation value of the onnx-mlir.dim_bounds metadata property.
+   */
+  void ImportDimBounds(llvm::StringRef annotation) {
+    llvm::SmallVector<llvm::StringRef, 4> specs;
+    annotation.split(specs, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+    for (auto spec : specs) {
+      llvm::StringRef name, bound;
+      std::tie(name, bound) = spec.split('=');
+      int64_t max_size;
+      bool invalid = bound.trim().getAsInteger(10, max_size) || max_size < 0;
+      assert(!invalid && "Invalid onnx-mlir.dim_bounds annotation");
+      dim_bounds_[name.trim().str()] = max_size;
+    }
+  }
+
+  /*!
+   * Record the names of the dynamic dimensions of the input tensor bound to
+   * a function argument, and the upper bounds annotated for them.
+   * @param input onnx input tensor ValueInfoProto.
+   * @param func function taking the input.
+   * @param index index of the argument of the function bound to the input.
+   */
+  void ImportInputDimParams(
+      const onnx::ValueInfoProto &input, mlir::FuncOp func, int index) {
+    auto shape_proto = input.type().tensor_type().shape();
+    llvm::SmallVector<llvm::StringRef, 4> dim_params;
+    llvm::SmallVector<int64_t, 4> bounds;
+    bool has_dim_params = false, has_bounds = false;
+    for (int i = 0; i < shape_proto.dim_size(); i++) {
+      const auto &dim = shape_proto.dim()[i];
+      llvm::StringRef dim_param =
+          dim.has_dim_param() ? dim.dim_param() : llvm::StringRef();
+      auto bound = dim_bounds_.find(dim_param.str());
+      dim_params.emplace_back(dim_param);
+      bounds.emplace_back(
+          !dim_param.empty() && bound != dim_bounds_.end() ? bound->second
+                                                           : -1);
+      has_dim_params |= !dim_param.empty();
+      has_bounds |= bounds.back() >= 0;
+    }
+    if (has_dim_params)
+      func.setArgAttr(index, mlir::ONNXEntryPointOp::getDimParamsAttrName(),
+          builder_.getStrArrayAttr(dim_params));
+    if (has_bounds)
+      func.setArgAttr(index, mlir::ONNXEntryPointOp::getDimBoundsAttrName(),
+          builder_.getI64ArrayAttr(bounds));
+  }
+
   /*!
    * Import an onnx input tensor type by determining and recording its type
    * in a list of input tensor mlir types.
@@ -140,6 +203,9 @@ private:
     std::vector<mlir::NamedAttribute> attributes;
     for (int i = 0; i < node.attribute_size(); ++i) {
       auto attr = node.attribute(i);
+      // Graph attributes are imported as regions.
+      if (attr.type() == onnx::AttributeProto::GRAPH)
+        continue;
       attributes.push_back(convertOnnxAttributeProtoToMlirNamedAttribute(attr));
     }
     return attributes;
@@ -152,7 +218,7 @@ private:
         inputs.push_back(frontend_symbols_.GetTensorByOnnxName(item));
       }
     }
-    mlir::OperationState result(UnknownLoc(), "frontend." + node.op_type());
+    mlir::OperationState result(NodeLoc(node), "frontend." + node.op_type());
     for (auto item : node.output()) {
       result.addTypes(mlir::UnrankedTensorType::get(builder_.getF32Type()));
     }
@@ -267,7 +333,8 @@ private:
     auto attributes = ImportNodeAttributes(node);
 
     // TODO: Handle optional inputs.
-    auto op = builder_.create<T>(UnknownLoc(), outputTypes, inputs, attributes);
+    auto op =
+        builder_.create<T>(NodeLoc(node), outputTypes, inputs, attributes);
 
     // Type inference for results.
     if (auto opWithTypeInference =
@@ -394,6 +461,156 @@ private:
     }
   }
 
+  /*!
+   * Get the subgraph held by the graph attribute `name` of `node`.
+   */
+  const onnx::GraphProto &GetGraphAttribute(
+      const onnx::NodeProto &node, const std::string &name) {
+    for (const auto &attr : node.attribute())
+      if (attr.name() == name && attr.type() == onnx::AttributeProto::GRAPH)
+        return attr.g();
+    llvm_unreachable("graph attribute not found");
+  }
+
+  /*!
+   * Gather the names of the tensors read by the nodes of a graph, including
+   * the nodes of its subgraphs, which can read the tensors of the graph.
+   */
+  void CollectReadTensors(
+      const onnx::GraphProto &graph, std::set<std::string> &names) {
+    for (const auto &node : graph.node()) {
+      for (const auto &input : node.input())
+        names.insert(legalize_name(input));
+      for (const auto &attr : node.attribute()) {
+        if (attr.has_g())
+          CollectReadTensors(attr.g(), names);
+        for (const auto &subgraph : attr.graphs())
+          CollectReadTensors(subgraph, names);
+      }
+    }
+  }
+
+  /*!
+   * Gather the inputs of a control flow node, importing the optional inputs
+   * left unspecified with an empty name as NoneType.
+   */
+  std::vector<mlir::Value> ImportControlFlowInputs(
+      const onnx::NodeProto &node) {
+    std::vector<mlir::Value> inputs;
+    for (const auto &item : node.input())
+      if (item.empty()) {
+        inputs.push_back(none_);
+      } else if (initializedTensors.ContainKey(legalize_name(item))) {
+        inputs.push_back(initializedTensors.EmitInitializerForInputTensor(
+            UnknownLoc(), builder_, legalize_name(item)));
+      } else if (frontend_symbols_.ContainKey(legalize_name(item))) {
+        inputs.push_back(frontend_symbols_.GetTensorByOnnxName(item));
+      }
+    return inputs;
+  }
+
+  /*!
+   * Get the unranked tensor types of the outputs of `graph`, skipping the
+   * first `numSkipped` ones.
+   */
+  std::vector<mlir::Type> GetGraphOutputTypes(
+      const onnx::GraphProto &graph, int numSkipped) {
+    std::vector<mlir::Type> types;
+    for (int i = numSkipped; i < graph.output().size(); ++i) {
+      auto elementOnnxType = (onnx::TensorProto_DataType)graph.output()[i]
+                                 .type()
+                                 .tensor_type()
+                                 .elem_type();
+      types.emplace_back(mlir::UnrankedTensorType::get(
+          convertONNXTypeToMLIRType(builder_, elementOnnxType)));
+    }
+    return types;
+  }
+
+  /*!
+   * Import a subgraph into the single block of `region`. The inputs of the
+   * subgraph become the arguments of the block and its outputs the operands
+   * of the terminating ONNXYieldOp. The subgraph can use the tensors of the
+   * enclosing graphs, while its own tensors, including its initializers, are
+   * only visible inside it and shadow those of the enclosing graphs with the
+   * same name.
+   * @param graph onnx subgraph.
+   * @param region region of the control flow operation holding the subgraph.
+   */
+  void ImportSubgraph(const onnx::GraphProto &graph, mlir::Region &region) {
+    mlir::OpBuilder::InsertionGuard guard(builder_);
+    OnnxMlirSymbolMapping enclosingSymbols = frontend_symbols_;
+
+    initializedTensors.PushScope();
+    for (const auto &input : graph.input())
+      initializedTensors.Shadow(legalize_name(input.name()));
+    for (const auto &node : graph.node())
+      for (const auto &output : node.output())
+        initializedTensors.Shadow(legalize_name(output));
+    for (const auto &initializer : graph.initializer())
+      initializedTensors.AddMapping(
+          legalize_name(initializer.name()), initializer);
+    std::set<std::string> readTensors;
+    CollectReadTensors(graph, readTensors);
+    initializedTensors.DecodeInitializers(context_, readTensors);
+
+    llvm::SmallVector<mlir::Type, 4> argTypes;
+    for (const auto &input : graph.input())
+      argTypes.emplace_back(ImportInputTensorType(input));
+    auto *block = builder_.createBlock(&region, {}, argTypes);
+    for (int i = 0; i < graph.input().size(); ++i)
+      ImportInputTensorSymbol(graph.input()[i], block->getArgument(i));
+
+    for (const auto &item : graph.node())
+      ImportNode(item);
+
+    llvm::SmallVector<mlir::Type, 4> ret_types;
+    llvm::SmallVector<mlir::Value, 4> ret_vals;
+    for (const auto &output : graph.output())
+      ImportOutputTensor(output, ret_types, ret_vals);
+    builder_.create<mlir::ONNXYieldOp>(UnknownLoc(), ret_vals);
+
+    initializedTensors.PopScope();
+    frontend_symbols_ = enclosingSymbols;
+  }
+
+  /*!
+   * Special handle for Loop operations, whose body is imported as a region.
+   * The body yields the condition followed by the results of the loop.
+   */
+  void ImportNodeLoop(const onnx::NodeProto &node) {
+    auto inputs = ImportControlFlowInputs(node);
+    const auto &body = GetGraphAttribute(node, "body");
+    auto loopOp = builder_.create<mlir::ONNXLoopOp>(NodeLoc(node),
+        GetGraphOutputTypes(body, /*numSkipped=*/1), inputs,
+        ImportNodeAttributes(node));
+    ImportSubgraph(body, loopOp.body());
+
+    for (int i = 0; i < node.output().size(); ++i)
+      if (!node.output()[i].empty())
+        frontend_symbols_.AddMapping(
+            legalize_name(node.output()[i]), loopOp.getResult(i));
+  }
+
+  /*!
+   * Special handle for If operations, whose branches are imported as regions.
+   */
+  void ImportNodeIf(const onnx::NodeProto &node) {
+    auto inputs = ImportControlFlowInputs(node);
+    const auto &thenBranch = GetGraphAttribute(node, "then_branch");
+    const auto &elseBranch = GetGraphAttribute(node, "else_branch");
+    auto ifOp = builder_.create<mlir::ONNXIfOp>(NodeLoc(node),
+        GetGraphOutputTypes(thenBranch, /*numSkipped=*/0), inputs,
+        ImportNodeAttributes(node));
+    ImportSubgraph(thenBranch, ifOp.then_branch());
+    ImportSubgraph(elseBranch, ifOp.else_branch());
+
+    for (int i = 0; i < node.output().size(); ++i)
+      if (!node.output()[i].empty())
+        frontend_symbols_.AddMapping(
+            legalize_name(node.output()[i]), ifOp.getResult(i));
+  }
+
   void ImportNode(const onnx::NodeProto &node) {
     llvm::StringRef opName = node.op_type();
 
@@ -434,10 +651,15 @@ private:
   void ImportGraph(
       const onnx::GraphProto &graph, const std::string &name = "main_graph") {
     // Maintain a mapping between the parameter and its initializer.
-    for (auto initializer : graph.initializer()) {
+    for (const auto &initializer : graph.initializer()) {
       auto name = initializer.name();
       initializedTensors.AddMapping(legalize_name(name), initializer);
     }
+    // Convert the initializers read by the nodes in parallel before
+    // importing the nodes.
+    std::set<std::string> readTensors;
+    CollectReadTensors(graph, readTensors);
+    initializedTensors.DecodeInitializers(context_, readTensors);
 
     // create a function for the graph
     // TODO:
@@ -478,6 +700,7 @@ private:
               legalize_name(graph.input()[i].name()))) {
         ImportInputTensorSymbol(
             graph.input()[i], entryBlock.getArguments()[entryBlockArgIdx]);
+        ImportInputDimParams(graph.input()[i], mainFunc, entryBlockArgIdx);
         entryBlockArgIdx++;
       }
     }
@@ -523,4 +746,15 @@ void ImportFrontendModelFile(std::string model_fname,
   FrontendGenImpl myONNXGen(context);
   module = myONNXGen.ImportONNXModel(model);
 }
+
+bool ImportFrontendModelBuffer(const void *data, size_t size,
+    mlir::MLIRContext &context, mlir::OwningModuleRef &module) {
+  onnx::ModelProto model;
+  if (!model.ParseFromArray(data, size))
+    return false;
+
+  FrontendGenImpl myONNXGen(context);
+  module = myONNXGen.ImportONNXModel(model);
+  return true;
+}
 } // namespace onnx_mlir
@@ -38,6 +38,15 @@ namespace onnx_mlir {
 void ImportFrontendModelFile(std::string model_fname,
     mlir::MLIRContext &context, mlir::OwningModuleRef &module);
 
+/*!
+ *  Import an ONNX model serialized in memory into the ONNX Dialect.
+ *  @param data pointer to the serialized onnx model protobuf.
+ *  @param size size of the serialized model in bytes.
+ *  @return whether the model could be parsed.
+ */
+bool ImportFrontendModelBuffer(const void *data, size_t size,
+    mlir::MLIRContext &context, mlir::OwningModuleRef &module);
+
 /*!
  *  TODO: Import models into other extension dialects that cover the
  *  operations specific to other frameworks such as Tensorflow or Pytorch.
@@ -0,0 +1,52 @@
+//===--------------------------- Compiler.cpp -----------------------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// In-process compilation of ONNX models, for programs that compile models on
+// demand without running the onnx-mlir driver.
+//
+//===----------------------------------------------------------------------===//
+
+#include <mutex>
+#include <stdexcept>
+
+#include "src/Compiler.hpp"
+#include "src/MainUtils.hpp"
+
+namespace onnx_mlir {
+
+std::string compileModel(const void *data, size_t size,
+    const std::string &outputBaseName, const CompileOptions &options) {
+  // Dialects are registered once per process, before any context is created.
+  static std::once_flag dialectsRegistered;
+  std::call_once(dialectsRegistered, registerDialects);
+
+  mlir::MLIRContext context;
+  mlir::OwningModuleRef module;
+  if (!ImportFrontendModelBuffer(data, size, context, module))
+    throw std::runtime_error("Cannot parse the ONNX model");
+  if (options.donateInputs)
+    (*module).setAttr(mlir::ONNXEntryPointOp::getDonateInputsAttrName(),
+        mlir::UnitAttr::get(&context));
+  if (!options.kvCache.empty() &&
+      !setKVCacheAttrs(module, options.kvCache, options.kvCacheCapacity))
+    throw std::runtime_error("Invalid key/value cache options");
+  if (!options.dimBounds.empty() &&
+      !setDimBoundsAttrs(module, options.dimBounds))
+    throw std::runtime_error("Invalid dimension bounds");
+
+  if (compileModule(module, context, outputBaseName, EmitLib) != 0)
+    throw std::runtime_error("Cannot compile the ONNX model");
+  return outputBaseName + ".so";
+}
+
+std::unique_ptr<ExecutionSession> compileSession(const void *data,
+    size_t size, const std::string &outputBaseName,
+    const CompileOptions &options) {
+  return std::make_unique<ExecutionSession>(
+      compileModel(data, size, outputBaseName, options),
+      "_dyn_entry_point_main_graph", options.donateInputs);
+}
+} // namespace onnx_mlir
@@ -0,0 +1,47 @@
+//===--------------------------- Compiler.hpp -----------------------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// In-process compilation of ONNX models, for programs that compile models on
+// demand without running the onnx-mlir driver.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/Runtime/ExecusionSession.hpp"
+
+namespace onnx_mlir {
+
+// Options of the compilation, matching those of the onnx-mlir driver. The
+// options of the passes keep their command line values.
+struct CompileOptions {
+  // See --donate-inputs.
+  bool donateInputs = false;
+  // See --kv-cache and --kv-cache-capacity.
+  std::vector<std::string> kvCache;
+  int64_t kvCacheCapacity = 2048;
+  // See --dim-bounds.
+  std::vector<std::string> dimBounds;
+};
+
+// Compile a serialized ONNX model into the shared library
+// <outputBaseName>.so, and return its path. Throws std::runtime_error if the
+// model cannot be compiled.
+std::string compileModel(const void *data, size_t size,
+    const std::string &outputBaseName,
+    const CompileOptions &options = CompileOptions());
+
+// Compile a serialized ONNX model into <outputBaseName>.so, and open a
+// session on its main graph.
+std::unique_ptr<ExecutionSession> compileSession(const void *data,
+    size_t size, const std::string &outputBaseName,
+    const CompileOptions &options = CompileOptions());
+} // namespace onnx_mlir
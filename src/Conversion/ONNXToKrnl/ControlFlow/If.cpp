@@ -0,0 +1,80 @@
+//===------------------- If.cpp - Lowering If Op ------------------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX If Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+
+using namespace mlir;
+
+/*!
+ * Replace the terminator of `branch` by the copy of the values it yields into
+ * `results`, followed by a branch to `endBlock`.
+ */
+static void emitBranchEnd(ConversionPatternRewriter &rewriter, Location loc,
+    Block *branch, ArrayRef<Value> results, Block *endBlock) {
+  auto yieldOp = cast<ONNXYieldOp>(branch->getTerminator());
+  rewriter.setInsertionPoint(yieldOp);
+  for (int i = 0; i < results.size(); ++i)
+    rewriter.create<KrnlMemcpyOp>(loc, results[i], yieldOp.getOperand(i),
+        emitSizeInBytes(rewriter, loc, results[i]));
+  rewriter.setInsertionPointToEnd(branch);
+  rewriter.create<BranchOp>(loc, endBlock);
+  rewriter.eraseOp(yieldOp);
+}
+
+struct ONNXIfOpLowering : public ConversionPattern {
+  ONNXIfOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXIfOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto loc = op->getLoc();
+    ONNXIfOp ifOp = llvm::dyn_cast<ONNXIfOp>(op);
+    ONNXIfOpOperandAdaptor operandAdaptor(operands);
+
+    // Both branches write the results, whose buffers are allocated before
+    // branching. Only results of the same static shape in both branches are
+    // supported.
+    for (auto result : op->getResults()) {
+      auto type = result.getType().dyn_cast<RankedTensorType>();
+      if (!type || !type.hasStaticShape())
+        return failure();
+    }
+    SmallVector<Value, 4> results;
+    for (int i = 0; i < op->getNumResults(); ++i)
+      results.emplace_back(insertAllocAndDealloc(
+          convertToMemRefType(op->getResult(i).getType()), loc, rewriter,
+          checkInsertDealloc(op, i)));
+    Value cond = rewriter.create<LoadOp>(loc, operandAdaptor.cond());
+
+    // Split the block at the operation, and inline the branches between the
+    // two parts.
+    auto *initBlock = rewriter.getInsertionBlock();
+    auto *endBlock =
+        rewriter.splitBlock(initBlock, rewriter.getInsertionPoint());
+    auto *thenBlock = &ifOp.then_branch().front();
+    auto *elseBlock = &ifOp.else_branch().front();
+    emitBranchEnd(rewriter, loc, thenBlock, results, endBlock);
+    emitBranchEnd(rewriter, loc, elseBlock, results, endBlock);
+    rewriter.inlineRegionBefore(ifOp.then_branch(), endBlock);
+    rewriter.inlineRegionBefore(ifOp.else_branch(), endBlock);
+
+    rewriter.setInsertionPointToEnd(initBlock);
+    rewriter.create<CondBranchOp>(
+        loc, cond, thenBlock, ValueRange(), elseBlock, ValueRange());
+
+    rewriter.replaceOp(op, results);
+    return success();
+  }
+};
+
+void populateLoweringONNXIfOpPattern(
+    OwningRewritePatternList &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXIfOpLowering>(ctx);
+}
@@ -0,0 +1,162 @@
+//===----------------- Loop.cpp - Lowering Loop Op ----------------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX Loop Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+
+using namespace mlir;
+
+struct ONNXLoopOpLowering : public ConversionPattern {
+  ONNXLoopOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXLoopOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto loc = op->getLoc();
+    ONNXLoopOp loopOp = llvm::dyn_cast<ONNXLoopOp>(op);
+    ONNXLoopOpOperandAdaptor operandAdaptor(operands);
+    Region &bodyRegion = loopOp.body();
+    auto yieldOp = cast<ONNXYieldOp>(bodyRegion.front().getTerminator());
+    int numCarried = operandAdaptor.v_initial().size();
+
+    // Scan outputs are not supported yet.
+    if (op->getNumResults() != numCarried)
+      return failure();
+
+    // The loop-carried values are kept in buffers that the body reads from
+    // and that are updated with the yielded values at the end of every
+    // iteration, the condition first. A yielded body argument is read from
+    // its buffer, so it must not be a loop-carried value updated before, nor
+    // the condition. The buffers are sized for the initial values, so the
+    // body must yield values of their static type.
+    SmallVector<int, 4> yieldedArgNumbers;
+    for (auto yielded : yieldOp.getOperands()) {
+      auto arg = yielded.dyn_cast<BlockArgument>();
+      bool isBodyArg = arg && arg.getOwner() == &bodyRegion.front();
+      yieldedArgNumbers.emplace_back(isBodyArg ? arg.getArgNumber() : -1);
+    }
+    for (int i = 0; i < numCarried; ++i) {
+      int argNumber = yieldedArgNumbers[i + 1];
+      if (argNumber > 0 && argNumber != i + 2)
+        return failure();
+      auto initialType =
+          loopOp.v_initial()[i].getType().dyn_cast<RankedTensorType>();
+      if (!initialType || !initialType.hasStaticShape() ||
+          yieldOp.getOperand(i + 1).getType() != initialType ||
+          op->getResult(i).getType() != initialType)
+        return failure();
+    }
+
+    // Buffers of the iteration number and of the condition.
+    auto int64Type = rewriter.getIntegerType(64);
+    auto indexType = rewriter.getIndexType();
+    Value iterationNum = insertAllocAndDealloc(
+        MemRefType::get({}, int64Type), loc, rewriter, /*insertDealloc=*/true);
+    Value condition = insertAllocAndDealloc(
+        MemRefType::get({}, rewriter.getI1Type()), loc, rewriter,
+        /*insertDealloc=*/true);
+    Value initialCondition;
+    if (operandAdaptor.cond().getType().isa<NoneType>())
+      initialCondition =
+          rewriter.create<ConstantOp>(loc, rewriter.getBoolAttr(true));
+    else
+      initialCondition = rewriter.create<LoadOp>(loc, operandAdaptor.cond());
+    rewriter.create<StoreOp>(loc, initialCondition, condition);
+
+    Value tripCount;
+    if (!operandAdaptor.M().getType().isa<NoneType>())
+      tripCount = rewriter.create<IndexCastOp>(
+          loc, rewriter.create<LoadOp>(loc, operandAdaptor.M()), indexType);
+
+    // Buffers of the loop-carried values, which become the results.
+    SmallVector<Value, 4> carried;
+    SmallVector<Value, 4> carriedSizes;
+    for (int i = 0; i < numCarried; ++i) {
+      Value initial = operandAdaptor.v_initial()[i];
+      auto memRefType = convertToMemRefType(op->getResult(i).getType());
+      Value buffer = insertAllocAndDealloc(
+          memRefType, loc, rewriter, checkInsertDealloc(op, i));
+      Value size = emitSizeInBytes(rewriter, loc, buffer);
+      rewriter.create<KrnlMemcpyOp>(loc, buffer, initial, size);
+      carried.emplace_back(buffer);
+      carriedSizes.emplace_back(size);
+    }
+
+    // Split the block at the loop. The loop becomes a header block testing
+    // the exit condition, which branches either to the body or to the block
+    // holding the operations following the loop.
+    auto *initBlock = rewriter.getInsertionBlock();
+    auto *endBlock =
+        rewriter.splitBlock(initBlock, rewriter.getInsertionPoint());
+
+    // The body reads the iteration number, the condition and the
+    // loop-carried values from their buffers.
+    SmallVector<Value, 4> buffers = {iterationNum, condition};
+    buffers.append(carried.begin(), carried.end());
+    TypeConverter::SignatureConversion signature(buffers.size());
+    for (int i = 0; i < buffers.size(); ++i)
+      signature.addInputs(i, buffers[i].getType());
+    auto *bodyBlock = rewriter.applySignatureConversion(&bodyRegion, signature);
+    rewriter.inlineRegionBefore(bodyRegion, endBlock);
+
+    auto *headerBlock = rewriter.createBlock(bodyBlock, {indexType});
+    Value iv = headerBlock->getArgument(0);
+    rewriter.create<StoreOp>(
+        loc, rewriter.create<IndexCastOp>(loc, iv, int64Type), iterationNum);
+    Value keepGoing = rewriter.create<LoadOp>(loc, condition);
+    if (tripCount) {
+      auto inRange =
+          rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, iv, tripCount);
+      keepGoing = rewriter.create<AndOp>(loc, inRange, keepGoing);
+    }
+    rewriter.create<CondBranchOp>(
+        loc, keepGoing, bodyBlock, buffers, endBlock, ValueRange());
+
+    rewriter.setInsertionPointToEnd(initBlock);
+    Value zero = emitConstantOp(rewriter, loc, indexType, 0);
+    auto entryBranch =
+        rewriter.create<BranchOp>(loc, headerBlock, ValueRange{zero});
+
+    // Constants of the body are materialized once before the loop.
+    for (auto &bodyOp : llvm::make_early_inc_range(*bodyBlock)) {
+      if (!isa<ONNXConstantOp>(bodyOp))
+        continue;
+      rewriter.setInsertionPoint(entryBranch);
+      rewriter.replaceOp(&bodyOp, rewriter.clone(bodyOp)->getResults());
+    }
+
+    // Update the buffers with the values yielded by the body.
+    rewriter.setInsertionPoint(yieldOp);
+    auto emitUpdate = [&](int index, Value buffer, Value size) {
+      int argNumber = yieldedArgNumbers[index];
+      if (argNumber == index + 1)
+        return;
+      Value yielded = argNumber >= 0 ? bodyBlock->getArgument(argNumber)
+                                     : yieldOp.getOperand(index);
+      rewriter.create<KrnlMemcpyOp>(loc, buffer, yielded, size);
+    };
+    emitUpdate(0, condition, emitConstantOp(rewriter, loc, int64Type, 1));
+    for (int i = 0; i < numCarried; ++i)
+      emitUpdate(i + 1, carried[i], carriedSizes[i]);
+
+    rewriter.setInsertionPointToEnd(bodyBlock);
+    auto nextIV = rewriter.create<AddIOp>(
+        loc, iv, emitConstantOp(rewriter, loc, indexType, 1));
+    rewriter.create<BranchOp>(loc, headerBlock, ValueRange{nextIV});
+    rewriter.eraseOp(yieldOp);
+
+    rewriter.replaceOp(op, carried);
+    return success();
+  }
+};
+
+void populateLoweringONNXLoopOpPattern(
+    OwningRewritePatternList &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXLoopOpLowering>(ctx);
+}
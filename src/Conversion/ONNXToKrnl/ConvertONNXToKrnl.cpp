@@ -34,6 +34,44 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// Call lowering, for the calls to functions outlined from ONNX operations.
+//===----------------------------------------------------------------------===//
+
+class CallOpLowering : public ConversionPattern {
+public:
+  CallOpLowering(MLIRContext *ctx)
+      : ConversionPattern(CallOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto callOp = cast<CallOp>(op);
+    auto loc = op->getLoc();
+
+    SmallVector<Type, 4> resultTypes;
+    for (auto type : op->getResultTypes()) {
+      if (auto memRefType = convertToMemRefType(type))
+        resultTypes.emplace_back(memRefType);
+      else
+        resultTypes.emplace_back(type);
+    }
+    auto newCallOp = rewriter.create<CallOp>(
+        loc, callOp.getCallee(), resultTypes, operands);
+
+    // The results are allocated by the callee, and freed by the caller unless
+    // it returns them.
+    auto *parentBlock = op->getBlock();
+    for (int i = 0; i < op->getNumResults(); ++i) {
+      if (!resultTypes[i].isa<MemRefType>() || !checkInsertDealloc(op, i))
+        continue;
+      auto dealloc = rewriter.create<DeallocOp>(loc, newCallOp.getResult(i));
+      dealloc.getOperation()->moveBefore(&parentBlock->back());
+    }
+    rewriter.replaceOp(op, newCallOp.getResults());
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // Frontend to Krnl Dialect lowering pass
 //===----------------------------------------------------------------------===//
@@ -55,7 +93,8 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
 
   // We define the specific operations, or dialects, that are legal targets for
   // this lowering.
-  target.addLegalDialect<KrnlOpsDialect, AffineDialect, StandardOpsDialect>();
+  target.addLegalDialect<KrnlOpsDialect, AffineDialect, scf::SCFDialect,
+      StandardOpsDialect>();
 
   // TODO: enable this once more ops are supported.
   // We also define the ONNX dialect as Illegal so that the conversion will fail
@@ -83,6 +122,15 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
   populateFuncOpTypeConversionPattern(
       patterns, &getContext(), tensor_to_memref_converter);
 
+  // Calls are legal once their operands and results have been converted.
+  target.addDynamicallyLegalOp<CallOp>([&](CallOp op) {
+    auto isLegal = [&](Type type) {
+      return tensor_to_memref_converter.isLegal(type);
+    };
+    return llvm::all_of(op.getOperandTypes(), isLegal) &&
+           llvm::all_of(op.getResultTypes(), isLegal);
+  });
+
   // Frontend operation lowering.
   // Math
   populateLoweringONNXElementwiseOpPattern(patterns, &getContext());
@@ -106,8 +154,13 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
   populateLoweringONNXPoolingOpPattern(patterns, &getContext());
   // Recurrent neural network
   populateLoweringONNXLSTMOpPattern(patterns, &getContext());
+  // Control flow
+  populateLoweringONNXLoopOpPattern(patterns, &getContext());
+  populateLoweringONNXIfOpPattern(patterns, &getContext());
   // Entry point
   patterns.insert<ONNXEntryPointLowering>(&getContext());
+  // Calls
+  patterns.insert<CallOpLowering>(&getContext());
 
   // With the target and rewrite patterns defined, we can now attempt the
   // conversion. The conversion will signal failure if any of our `illegal`
@@ -514,14 +514,34 @@ struct ONNXElementwiseUnaryOpLowering : public ConversionPattern {
     // dimensions with the result at this pre-optimization phase.
     // TODO: verify that dimensions match.
     // TODO: can the dimension of the result differ after optimizations?
-    Value alloc;
-    bool insertDealloc = checkInsertDealloc(op);
+    // If the input buffer is dead after this operation, the result is computed
+    // in place, each element being read before it is overwritten.
+    Value alloc = getReusableOperandBuffer(op, operands, memRefType, {0});
+    if (!alloc) {
+      bool insertDealloc = checkInsertDealloc(op);
+      if (hasAllConstantDimensions(memRefType))
+        alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+      else
+        alloc = insertAllocAndDealloc(
+            memRefType, loc, rewriter, insertDealloc, {X});
+    }
 
-    if (hasAllConstantDimensions(memRefType))
-      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
-    else
-      alloc =
-          insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc, {X});
+    // The exponential of float tensors is computed by the runtime kernel
+    // library if the model is linked with it.
+    auto module = op->getParentOfType<ModuleOp>();
+    if (isa<ONNXExpOp>(op) && memRefType.getElementType().isF32() &&
+        !hasAllScalarValues(operands) &&
+        module.getAttr(KrnlCallKernelOp::getKernelLibraryAttrName())) {
+      Value size = emitConstantOp(rewriter, loc, rewriter.getIndexType(), 1);
+      for (int i = 0; i < memRefType.getRank(); ++i)
+        size = rewriter.create<MulIOp>(
+            loc, size, rewriter.create<DimOp>(loc, X, i));
+      SmallVector<Value, 4> kernelOperands = {X, alloc, size};
+      rewriter.create<KrnlCallKernelOp>(
+          loc, rewriter.getStringAttr("omKernelExpF32"), kernelOperands);
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
 
     SmallVector<Value, 4> loopIVs;
     if (!hasAllScalarValues(operands)) {
@@ -577,18 +597,27 @@ struct ONNXElementwiseVariadicOpLowering : public ConversionPattern {
     // Insert an allocation and deallocation for the result of this operation.
     auto memRefType = convertToMemRefType(*op->result_type_begin());
 
-    Value alloc;
-    bool insertDealloc = checkInsertDealloc(op);
-    // If the output has a dynamic dimension, we compute its dimension at
-    // runtime by using dimensions from the operands.
-    // In particular, we need to know from which operand a result dimension
-    // comes from.
-    // TODO: can the dimension of the result differ after optimizations?
-    if (hasAllConstantDimensions(memRefType))
-      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
-    else
-      alloc = insertAllocAndDealloc(
-          memRefType, loc, rewriter, insertDealloc, operands);
+    // Reuse the buffer of an operand that is dead after this operation and
+    // has the shape of the result. Other operands are only read at the same
+    // or at broadcasted positions, so no value is overwritten before its use.
+    SmallVector<int, 4> candidates;
+    for (unsigned i = 0; i < numArgs; i++)
+      candidates.emplace_back(i);
+    Value alloc =
+        getReusableOperandBuffer(op, operands, memRefType, candidates);
+    if (!alloc) {
+      bool insertDealloc = checkInsertDealloc(op);
+      // If the output has a dynamic dimension, we compute its dimension at
+      // runtime by using dimensions from the operands.
+      // In particular, we need to know from which operand a result dimension
+      // comes from.
+      // TODO: can the dimension of the result differ after optimizations?
+      if (hasAllConstantDimensions(memRefType))
+        alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+      else
+        alloc = insertAllocAndDealloc(
+            memRefType, loc, rewriter, insertDealloc, operands);
+    }
 
     SmallVector<Value, 4> loopIVs;
     std::map<int, std::map<int, Value>> broadcastedDimInfo;
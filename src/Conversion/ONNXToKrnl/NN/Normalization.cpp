@@ -37,15 +37,17 @@ struct ONNXBatchNormalizationTestModeOpLowering : public ConversionPattern {
     auto mean = operandAdaptor.mean();
     auto variance = operandAdaptor.var();
 
-    // Insert an allocation and deallocation for the result of this operation.
-    Value alloc;
-    bool insertDealloc = checkInsertDealloc(op);
-
-    if (hasAllConstantDimensions(memRefType))
-      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
-    else
-      alloc = insertAllocAndDealloc(
-          memRefType, loc, rewriter, insertDealloc, {operand});
+    // Insert an allocation and deallocation for the result of this operation,
+    // unless the result can be computed in place into the buffer of X.
+    Value alloc = getReusableOperandBuffer(op, operands, memRefType, {0});
+    if (!alloc) {
+      bool insertDealloc = checkInsertDealloc(op);
+      if (hasAllConstantDimensions(memRefType))
+        alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+      else
+        alloc = insertAllocAndDealloc(
+            memRefType, loc, rewriter, insertDealloc, {operand});
+    }
 
     // Operand's dimensions can be in the form of NxCxD1xD2x...xDn or N.
     // In case of N, C is assumed to be 1.
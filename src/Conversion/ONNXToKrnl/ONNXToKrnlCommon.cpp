@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/IR/Matchers.h"
+
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
 
 /// Check is all dimensions are known at compile time.
@@ -126,6 +128,60 @@ bool checkInsertDealloc(Operation *currentOp, int resultIndex) {
   return insertDealloc;
 }
 
+// Return the buffer of one of the candidate operands if the result of the
+// current op can be computed in place into it, nullptr otherwise.
+Value getReusableOperandBuffer(Operation *currentOp, ArrayRef<Value> operands,
+    MemRefType type, ArrayRef<int> candidates) {
+  // With more than one operand, equal types only guarantee equal shapes when
+  // all dimensions are known, since dynamic dimensions may be broadcasted.
+  if (operands.size() > 1 && !hasAllConstantDimensions(type)) {
+    emitOptimizationRemark(currentOp, "lower-frontend", "InPlace",
+        RemarkKind::Missed, "the operands may be broadcasted");
+    return nullptr;
+  }
+
+  // A buffer allocated by a previous lowering is freed by the dealloc emitted
+  // for it, so it cannot hold a result returned by the function.
+  bool resultIsReturned = !checkInsertDealloc(currentOp);
+  auto module = currentOp->getParentOfType<ModuleOp>();
+  auto func = currentOp->getParentOfType<FuncOp>();
+  bool inputsDonated =
+      module && module.getAttr(ONNXEntryPointOp::getDonateInputsAttrName()) &&
+      !(func && func.getAttr(ONNXEntryPointOp::getOutlinedOpAttrName()));
+
+  StringRef reason = "no operand of the result type is last read here";
+  for (int i : candidates) {
+    Value originalOperand = currentOp->getOperand(i);
+    Value operand = operands[i];
+    // The current op must be the last reader of the operand.
+    if (!originalOperand.hasOneUse() || operand.getType() != type)
+      continue;
+
+    if (originalOperand.isa<BlockArgument>()) {
+      // Function inputs are owned by the caller and can only be overwritten
+      // once they have been donated.
+      if (inputsDonated) {
+        emitOptimizationRemark(currentOp, "lower-frontend", "InPlace",
+            RemarkKind::Applied,
+            "the result overwrites the donated input #" + Twine(i));
+        return operand;
+      }
+      reason = "the operand is an input that is not donated";
+    } else if (!resultIsReturned &&
+               llvm::isa_and_nonnull<AllocOp>(operand.getDefiningOp())) {
+      emitOptimizationRemark(currentOp, "lower-frontend", "InPlace",
+          RemarkKind::Applied, "the result overwrites operand #" + Twine(i));
+      return operand;
+    } else {
+      reason = resultIsReturned ? "the result is returned by the function"
+                                : "the operand is not an allocated buffer";
+    }
+  }
+  emitOptimizationRemark(
+      currentOp, "lower-frontend", "InPlace", RemarkKind::Missed, reason);
+  return nullptr;
+}
+
 // Create a mapping from result type's dimensions to input type's dimensions,
 // given that the result type is the result of a reduction op over the input
 // type.
@@ -241,6 +297,177 @@ unsigned getMemRefEltSizeInBytes(MemRefType memRefType) {
   return llvm::divideCeil(sizeInBits, 8);
 }
 
+// Emit the size in bytes of the buffer `memref` as an i64 value, reading its
+// dynamic dimensions at runtime.
+Value emitSizeInBytes(
+    ConversionPatternRewriter &rewriter, Location loc, Value memref) {
+  auto memRefType = memref.getType().cast<MemRefType>();
+  auto shape = memRefType.getShape();
+  auto int64Type = rewriter.getIntegerType(64);
+  int64_t staticSize = getMemRefEltSizeInBytes(memRefType);
+  Value dynamicSize;
+  for (int i = 0; i < shape.size(); ++i) {
+    if (shape[i] >= 0) {
+      staticSize *= shape[i];
+      continue;
+    }
+    Value dim = rewriter.create<IndexCastOp>(
+        loc, rewriter.create<DimOp>(loc, memref, i), int64Type);
+    dynamicSize =
+        dynamicSize ? rewriter.create<MulIOp>(loc, dynamicSize, dim) : dim;
+  }
+  Value size = emitConstantOp(rewriter, loc, int64Type, staticSize);
+  if (dynamicSize)
+    size = rewriter.create<MulIOp>(loc, dynamicSize, size);
+  return size;
+}
+
+// Return an upper bound of the dimension `index` of the buffer `memref` if
+// one is known at compile time.
+Optional<int64_t> getDimUpperBound(Value memref, int64_t index) {
+  auto shape = memref.getType().cast<MemRefType>().getShape();
+  if (shape[index] >= 0)
+    return shape[index];
+
+  if (auto arg = memref.dyn_cast<BlockArgument>()) {
+    auto func = dyn_cast<FuncOp>(arg.getOwner()->getParentOp());
+    if (!func)
+      return llvm::None;
+    auto bounds = func.getArgAttrOfType<ArrayAttr>(
+        arg.getArgNumber(), ONNXEntryPointOp::getDimBoundsAttrName());
+    if (!bounds || index >= bounds.size())
+      return llvm::None;
+    int64_t bound = bounds.getValue()[index].cast<IntegerAttr>().getInt();
+    if (bound < 0)
+      return llvm::None;
+    return bound;
+  }
+
+  // The operands of an alloc, or of a view of a buffer of the memory pool,
+  // are the sizes of its dynamic dimensions.
+  int dynamicIndex = 0;
+  for (int i = 0; i < index; ++i)
+    if (shape[i] < 0)
+      ++dynamicIndex;
+  auto *defOp = memref.getDefiningOp();
+  if (auto allocOp = dyn_cast_or_null<AllocOp>(defOp))
+    return getUpperBound(allocOp.getOperand(dynamicIndex));
+  if (auto reinterpretOp = dyn_cast_or_null<KrnlReinterpretOp>(defOp))
+    return getUpperBound(reinterpretOp.sizes()[dynamicIndex]);
+  return llvm::None;
+}
+
+// Return an upper bound of an affine expression given upper bounds of its
+// dimensions and symbols.
+static Optional<int64_t> getUpperBound(AffineExpr expr,
+    ArrayRef<Optional<int64_t>> dims, ArrayRef<Optional<int64_t>> symbols) {
+  if (auto constExpr = expr.dyn_cast<AffineConstantExpr>())
+    return constExpr.getValue();
+  if (auto dimExpr = expr.dyn_cast<AffineDimExpr>())
+    return dims[dimExpr.getPosition()];
+  if (auto symbolExpr = expr.dyn_cast<AffineSymbolExpr>())
+    return symbols[symbolExpr.getPosition()];
+
+  auto binaryExpr = expr.cast<AffineBinaryOpExpr>();
+  auto lhs = getUpperBound(binaryExpr.getLHS(), dims, symbols);
+  auto rhs = getUpperBound(binaryExpr.getRHS(), dims, symbols);
+  auto rhsConst = binaryExpr.getRHS().dyn_cast<AffineConstantExpr>();
+  switch (expr.getKind()) {
+  case AffineExprKind::Add:
+    if (lhs && rhs)
+      return *lhs + *rhs;
+    break;
+  case AffineExprKind::Mul:
+    if (lhs && rhs && *lhs >= 0 && *rhs >= 0)
+      return *lhs * *rhs;
+    break;
+  case AffineExprKind::FloorDiv:
+  case AffineExprKind::CeilDiv:
+    if (lhs && rhsConst && rhsConst.getValue() > 0)
+      return llvm::divideCeil(*lhs, rhsConst.getValue());
+    break;
+  case AffineExprKind::Mod:
+    if (rhsConst && rhsConst.getValue() > 0)
+      return rhsConst.getValue() - 1;
+    break;
+  default:
+    break;
+  }
+  return llvm::None;
+}
+
+// Return an upper bound of an index or integer value computed from constants
+// and dimensions of buffers, if one is known at compile time.
+Optional<int64_t> getUpperBound(Value value) {
+  IntegerAttr constant;
+  if (matchPattern(value, m_Constant(&constant)))
+    return constant.getInt();
+  auto *op = value.getDefiningOp();
+  if (!op)
+    return llvm::None;
+
+  if (auto dimOp = dyn_cast<DimOp>(op))
+    return getDimUpperBound(dimOp.getOperand(), dimOp.getIndex());
+  if (isa<IndexCastOp>(op))
+    return getUpperBound(op->getOperand(0));
+  if (auto selectOp = dyn_cast<SelectOp>(op)) {
+    auto trueBound = getUpperBound(selectOp.getTrueValue());
+    auto falseBound = getUpperBound(selectOp.getFalseValue());
+    if (trueBound && falseBound)
+      return std::max(*trueBound, *falseBound);
+    return llvm::None;
+  }
+  if (auto applyOp = dyn_cast<AffineApplyOp>(op)) {
+    auto map = applyOp.getAffineMap();
+    SmallVector<Optional<int64_t>, 4> operandBounds;
+    for (auto operand : applyOp.getMapOperands())
+      operandBounds.emplace_back(getUpperBound(operand));
+    return getUpperBound(map.getResult(0),
+        makeArrayRef(operandBounds).take_front(map.getNumDims()),
+        makeArrayRef(operandBounds).drop_front(map.getNumDims()));
+  }
+
+  if (op->getNumOperands() != 2)
+    return llvm::None;
+  auto lhs = getUpperBound(op->getOperand(0));
+  IntegerAttr rhsConstant;
+  bool rhsIsConstant =
+      matchPattern(op->getOperand(1), m_Constant(&rhsConstant));
+  if (isa<SubIOp>(op)) {
+    // The subtrahend is non-negative.
+    if (lhs && rhsIsConstant)
+      return *lhs - rhsConstant.getInt();
+    return lhs;
+  }
+  if (isa<SignedDivIOp>(op) || isa<UnsignedDivIOp>(op)) {
+    if (lhs && rhsIsConstant && rhsConstant.getInt() > 0)
+      return llvm::divideCeil(*lhs, rhsConstant.getInt());
+    return llvm::None;
+  }
+  auto rhs = getUpperBound(op->getOperand(1));
+  if (!lhs || !rhs)
+    return llvm::None;
+  if (isa<AddIOp>(op))
+    return *lhs + *rhs;
+  if (isa<MulIOp>(op))
+    return *lhs * *rhs;
+  return llvm::None;
+}
+
+// Return an upper bound of the size in bytes of the buffer `memref` if one is
+// known at compile time.
+Optional<int64_t> getSizeInBytesUpperBound(Value memref) {
+  auto memRefType = memref.getType().cast<MemRefType>();
+  int64_t size = getMemRefEltSizeInBytes(memRefType);
+  for (int i = 0; i < memRefType.getRank(); ++i) {
+    auto bound = getDimUpperBound(memref, i);
+    if (!bound)
+      return llvm::None;
+    size *= *bound;
+  }
+  return size;
+}
+
 // Get run-time dimension information for unknown dimensions used for
 // broadcasting.
 std::map<int, std::map<int, Value>> getBroadcastedDimInfo(Location loc,
@@ -14,6 +14,7 @@
 #include <map>
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/SCF/SCF.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/Pass/Pass.h"
@@ -26,6 +27,7 @@
 #include "src/Dialect/ONNX/ONNXOps.hpp"
 #include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
 #include "src/Pass/Passes.hpp"
+#include "src/Pass/Remarks.hpp"
 
 using namespace mlir;
 
@@ -52,6 +54,13 @@ Value insertAllocAndDealloc(MemRefType type, Location loc,
 // inserted.
 bool checkInsertDealloc(Operation *currentOp, int resultIndex = 0);
 
+// Return the buffer of one of the candidate operands if the result of the
+// current op can be computed in place into it, nullptr otherwise. A buffer is
+// reusable when the current op is its last user, its type matches the result
+// type and it is either allocated by a previous lowering or a donated input.
+Value getReusableOperandBuffer(Operation *currentOp, ArrayRef<Value> operands,
+    MemRefType type, ArrayRef<int> candidates);
+
 // Create a mapping from result type's dimensions to input type's dimensions,
 // given that the result type is the result of a reduction op over the input
 // type.
@@ -84,6 +93,26 @@ void emitKrnlLoopsAndIterationForOperand(ConversionPatternRewriter &rewriter,
 
 unsigned getMemRefEltSizeInBytes(MemRefType memRefType);
 
+// Emit the size in bytes of the buffer `memref` as an i64 value, reading its
+// dynamic dimensions at runtime.
+Value emitSizeInBytes(
+    ConversionPatternRewriter &rewriter, Location loc, Value memref);
+
+// Return an upper bound of the dimension `index` of the buffer `memref` if
+// one is known at compile time. The dynamic dimensions of the inputs of a
+// function are bounded by their onnx.dim_bounds attribute, and those of
+// allocated buffers by the bounds of the values they are allocated with.
+Optional<int64_t> getDimUpperBound(Value memref, int64_t index);
+
+// Return an upper bound of an index or integer value computed from constants
+// and dimensions of buffers, if one is known at compile time. The values are
+// assumed to be non-negative, as the sizes they compute are.
+Optional<int64_t> getUpperBound(Value value);
+
+// Return an upper bound of the size in bytes of the buffer `memref` if one is
+// known at compile time.
+Optional<int64_t> getSizeInBytesUpperBound(Value memref);
+
 // Get run-time dimension information for unknown dimensions used for
 // broadcasting.
 std::map<int, std::map<int, Value>> getBroadcastedDimInfo(Location loc,
@@ -253,3 +282,11 @@ void populateLoweringONNXConcatOpPattern(
 
 void populateLoweringONNXSplitOpPattern(
     OwningRewritePatternList &patterns, MLIRContext *ctx);
+
+// `ControlFlow` directory methods:
+
+void populateLoweringONNXLoopOpPattern(
+    OwningRewritePatternList &patterns, MLIRContext *ctx);
+
+void populateLoweringONNXIfOpPattern(
+    OwningRewritePatternList &patterns, MLIRContext *ctx);
@@ -231,6 +231,23 @@ LstmState allocAndInitializeStates<ONNXLSTMOp, LstmState>(
     rewriter.create<StoreOp>(loc, cellVal, state.ct, IVs);
   }
   rewriter.restoreInsertionPoint(ipInitializationLoops);
+
+  // Steps past the end of a sequence are skipped, so the outputs of these
+  // steps must be zero beforehand.
+  if (!isNoneType(operandAdaptor.sequence_lens()) &&
+      !isNoneType(state.allH)) {
+    BuildKrnlLoop allHLoops(rewriter, loc, state.allH);
+    allHLoops.createDefineOptimizeAndIterateOp(state.allH);
+    auto ipAllHLoops = rewriter.saveInsertionPoint();
+    rewriter.setInsertionPointToStart(allHLoops.getIterateBlock());
+    {
+      SmallVector<Value, 4> IVs;
+      for (int i = 0; i < 4; ++i)
+        IVs.emplace_back(allHLoops.getInductionVar(i));
+      rewriter.create<StoreOp>(loc, zero, state.allH, IVs);
+    }
+    rewriter.restoreInsertionPoint(ipAllHLoops);
+  }
   return state;
 }
 
@@ -238,7 +255,8 @@ template <>
 void calculateState<ONNXLSTMOp, LstmState, LstmActivationPack>(
     ConversionPatternRewriter &rewriter, Location loc,
     OperandAdaptor<ONNXLSTMOp> operandAdaptor, LstmState state,
-    LstmActivationPack activationPack, Value directionIV, Value sequenceIV) {
+    LstmActivationPack activationPack, Value directionIV,
+    RNNSequenceStep step) {
 
   bool hasBiasForInput = false, hasPeepholes = false;
   if (!isNoneType(operandAdaptor.B()))
@@ -247,6 +265,7 @@ void calculateState<ONNXLSTMOp, LstmState, LstmActivationPack>(
     hasPeepholes = true;
 
   // Prepare dimensions.
+  auto sequenceDimSize = dimAt(operandAdaptor.X(), 0);
   auto batchDimSize = dimAt(operandAdaptor.X(), 1);
   auto inputDimSize = dimAt(operandAdaptor.X(), 2);
   auto hiddenDimSize = dimAt(operandAdaptor.R(), 2);
@@ -300,6 +319,11 @@ void calculateState<ONNXLSTMOp, LstmState, LstmActivationPack>(
     auto batchIV = stateLoops.getInductionVar(0);
     auto hiddenIV = stateLoops.getInductionVar(1);
 
+    // Skip the step for a sample whose sequence has ended. Its states are
+    // left untouched so that Y_h and Y_c hold the last valid states.
+    Value sequenceIV = emitSequenceLensGuard(rewriter, loc,
+        operandAdaptor.sequence_lens(), sequenceDimSize, batchIV, step);
+
     // IVs to access tensors.
     // IVs for the hidden and cell state tensors.
     SmallVector<Value, 4> hIVs, cIVs;
@@ -71,3 +71,74 @@ Value applyActivation(ConversionPatternRewriter &rewriter, Location loc,
   Value result = rewriter.create<LoadOp>(loc, res);
   return result;
 }
+
+// Emit the length of the longest sequence of the batch given sequence_lens,
+// clamped to the sequence dimension of the input.
+Value emitMaxSequenceLength(ConversionPatternRewriter &rewriter, Location loc,
+    Value sequenceLens, int64_t sequenceDimSize) {
+  // sequence_lens :: [batch_size]
+  auto elementType = sequenceLens.getType().cast<ShapedType>().getElementType();
+  MemRefType scalarMemRefType = MemRefType::get({}, elementType, {}, 0);
+  Value maxLenAlloc = rewriter.create<AllocOp>(loc, scalarMemRefType);
+  rewriter.create<StoreOp>(
+      loc, emitConstantOp(rewriter, loc, elementType, 0), maxLenAlloc);
+
+  BuildKrnlLoop batchLoops(rewriter, loc, 1);
+  batchLoops.createDefineOptimizeAndIterateOp(sequenceLens);
+  auto ipBatchLoops = rewriter.saveInsertionPoint();
+  rewriter.setInsertionPointToStart(batchLoops.getIterateBlock());
+  {
+    Value len = rewriter.create<LoadOp>(
+        loc, sequenceLens, ArrayRef<Value>{batchLoops.getInductionVar(0)});
+    Value maxLen = rewriter.create<LoadOp>(loc, maxLenAlloc);
+    Value greater =
+        rewriter.create<CmpIOp>(loc, CmpIPredicate::sgt, len, maxLen);
+    Value nextMaxLen = rewriter.create<SelectOp>(loc, greater, len, maxLen);
+    rewriter.create<StoreOp>(loc, nextMaxLen, maxLenAlloc);
+  }
+  rewriter.restoreInsertionPoint(ipBatchLoops);
+
+  Value maxLen = rewriter.create<IndexCastOp>(loc,
+      rewriter.create<LoadOp>(loc, maxLenAlloc), rewriter.getIndexType());
+  rewriter.create<DeallocOp>(loc, maxLenAlloc);
+
+  // Lengths beyond the sequence dimension are invalid, do not read past it.
+  Value sequenceDimVal =
+      emitConstantOp(rewriter, loc, rewriter.getIndexType(), sequenceDimSize);
+  Value tooLong = rewriter.create<CmpIOp>(
+      loc, CmpIPredicate::sgt, maxLen, sequenceDimVal);
+  return rewriter.create<SelectOp>(loc, tooLong, sequenceDimVal, maxLen);
+}
+
+// Emit a guard skipping the current step for the sample at batchIV once its
+// sequence has ended, and move the insertion point into the guarded region.
+// Return the timestep to process for this sample.
+Value emitSequenceLensGuard(ConversionPatternRewriter &rewriter, Location loc,
+    Value sequenceLens, int64_t sequenceDimSize, Value batchIV,
+    RNNSequenceStep step) {
+  if (isNoneType(sequenceLens))
+    return step.sequenceIV;
+
+  Value len = rewriter.create<IndexCastOp>(loc,
+      rewriter.create<LoadOp>(loc, sequenceLens, ArrayRef<Value>{batchIV}),
+      rewriter.getIndexType());
+  Value isActive =
+      rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, step.stepIV, len);
+  auto ifOp =
+      rewriter.create<scf::IfOp>(loc, isActive, /*withElseRegion=*/false);
+  rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+
+  if (!step.isReverse)
+    return step.sequenceIV;
+  // In the reverse direction, a sample is processed from its last valid
+  // timestep: min(len, sequenceDimSize) - 1 - step. Lengths beyond the
+  // sequence dimension are invalid, do not read past it.
+  Value sequenceDimVal =
+      emitConstantOp(rewriter, loc, rewriter.getIndexType(), sequenceDimSize);
+  Value tooLong =
+      rewriter.create<CmpIOp>(loc, CmpIPredicate::sgt, len, sequenceDimVal);
+  Value validLen = rewriter.create<SelectOp>(loc, tooLong, sequenceDimVal, len);
+  Value one = emitConstantOp(rewriter, loc, rewriter.getIndexType(), 1);
+  return rewriter.create<SubIOp>(
+      loc, rewriter.create<SubIOp>(loc, validLen, step.stepIV), one);
+}
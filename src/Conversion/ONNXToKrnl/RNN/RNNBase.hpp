@@ -23,6 +23,17 @@ struct RNNActivation {
   Optional<FloatAttr> beta;
 };
 
+// One iteration of an RNN sequence loop.
+struct RNNSequenceStep {
+  // Induction variable of the sequence loop.
+  Value stepIV;
+  // Timestep processed by all samples of the batch in this iteration. It is
+  // null when the timestep depends on the sample, i.e. in the reverse
+  // direction when sequence_lens is given.
+  Value sequenceIV;
+  bool isReverse;
+};
+
 // Check a Value's type is none or not.
 bool isNoneType(Value val);
 
@@ -33,6 +44,19 @@ int64_t dimAt(Value val, int index);
 Value applyActivation(ConversionPatternRewriter &rewriter, Location loc,
     RNNActivation activation, Value scalarOperand);
 
+// Emit the length of the longest sequence of the batch given sequence_lens,
+// clamped to the sequence dimension of the input.
+Value emitMaxSequenceLength(ConversionPatternRewriter &rewriter, Location loc,
+    Value sequenceLens, int64_t sequenceDimSize);
+
+// Emit a guard skipping the current step for the sample at batchIV once its
+// sequence has ended, and move the insertion point into the guarded region.
+// Return the timestep to process for this sample, within the sequence
+// dimension of the input. No guard is emitted when sequenceLens is none.
+Value emitSequenceLensGuard(ConversionPatternRewriter &rewriter, Location loc,
+    Value sequenceLens, int64_t sequenceDimSize, Value batchIV,
+    RNNSequenceStep step);
+
 // Override the following methods when lowering an RNN operation:
 // - hasAllNoneOutput
 // - getActivationPack
@@ -57,7 +81,7 @@ S allocAndInitializeStates(ConversionPatternRewriter &rewriter, Location loc,
 template <typename RNNOp, typename S, typename A>
 void calculateState(ConversionPatternRewriter &rewriter, Location loc,
     OperandAdaptor<RNNOp> operandAdaptor, S state, A activationSet,
-    Value directionIV, Value sequenceIV);
+    Value directionIV, RNNSequenceStep step);
 
 // Write states to the RNN's outputs.
 template <typename RNNOp, typename S>
@@ -91,10 +115,23 @@ struct ONNXRNNOpLowering : public ConversionPattern {
     int64_t sequenceDimSize = dimAt(rnnOp.X(), 0);
     auto direction = rnnOp.direction();
 
+    // When sequence_lens is given, the sequence loops stop at the longest
+    // sequence of the batch and the state calculation skips the samples whose
+    // sequence has ended.
+    Value sequenceLens = operandAdaptor.sequence_lens();
+    bool hasSequenceLens = !isNoneType(sequenceLens);
+    Value maxSequenceLen;
+    if (hasSequenceLens)
+      maxSequenceLen = emitMaxSequenceLength(
+          rewriter, loc, sequenceLens, sequenceDimSize);
+
     if (direction == FORWARD || direction == BIDIRECTIONAL) {
       BuildKrnlLoop sequenceLoops(rewriter, loc, 1);
       sequenceLoops.createDefineAndOptimizeOp();
-      sequenceLoops.pushBounds(0, sequenceDimSize);
+      if (hasSequenceLens)
+        sequenceLoops.pushBounds(0, maxSequenceLen);
+      else
+        sequenceLoops.pushBounds(0, sequenceDimSize);
       sequenceLoops.createIterateOp();
 
       auto ipSequenceLoops = rewriter.saveInsertionPoint();
@@ -103,9 +140,10 @@ struct ONNXRNNOpLowering : public ConversionPattern {
         Value directionIV =
             emitConstantOp(rewriter, loc, rewriter.getIndexType(), 0);
         Value sequenceIV = sequenceLoops.getInductionVar(0);
+        RNNSequenceStep step = {sequenceIV, sequenceIV, /*isReverse=*/false};
         // Emit calculation for one RNN step.
         calculateState<RNNOp, S, A>(rewriter, loc, operandAdaptor, state,
-            activationForward, directionIV, sequenceIV);
+            activationForward, directionIV, step);
       }
       rewriter.restoreInsertionPoint(ipSequenceLoops);
     }
@@ -113,25 +151,33 @@ struct ONNXRNNOpLowering : public ConversionPattern {
     if (direction == REVERSE || direction == BIDIRECTIONAL) {
       BuildKrnlLoop sequenceLoops(rewriter, loc, 1);
       sequenceLoops.createDefineAndOptimizeOp();
-      sequenceLoops.pushBounds(0, sequenceDimSize);
+      if (hasSequenceLens)
+        sequenceLoops.pushBounds(0, maxSequenceLen);
+      else
+        sequenceLoops.pushBounds(0, sequenceDimSize);
       sequenceLoops.createIterateOp();
 
       auto ipSequenceLoops = rewriter.saveInsertionPoint();
       rewriter.setInsertionPointToStart(sequenceLoops.getIterateBlock());
       {
-        AffineMap reverseIVMap = AffineMap::get(1, 1,
-            rewriter.getAffineSymbolExpr(0) - rewriter.getAffineDimExpr(0) - 1);
-
         Value directionIV = emitConstantOp(rewriter, loc,
             rewriter.getIndexType(), (direction == REVERSE) ? 0 : 1);
-        Value reverseSequenceIV =
-            rewriter.create<AffineApplyOp>(loc, reverseIVMap,
-                ValueRange(std::vector<Value>{sequenceLoops.getInductionVar(0),
-                    emitConstantOp(rewriter, loc, rewriter.getIndexType(),
-                        sequenceDimSize)}));
+        RNNSequenceStep step = {
+            sequenceLoops.getInductionVar(0), nullptr, /*isReverse=*/true};
+        // Each sample is reversed within its own length when sequence_lens is
+        // given, so its timestep is computed by the state calculation.
+        if (!hasSequenceLens) {
+          AffineMap reverseIVMap = AffineMap::get(1, 1,
+              rewriter.getAffineSymbolExpr(0) - rewriter.getAffineDimExpr(0) -
+                  1);
+          step.sequenceIV = rewriter.create<AffineApplyOp>(loc, reverseIVMap,
+              ValueRange(std::vector<Value>{step.stepIV,
+                  emitConstantOp(rewriter, loc, rewriter.getIndexType(),
+                      sequenceDimSize)}));
+        }
         // Emit calculation for one RNN step.
         calculateState<RNNOp, S, A>(rewriter, loc, operandAdaptor, state,
-            activationReverse, directionIV, reverseSequenceIV);
+            activationReverse, directionIV, step);
       }
       rewriter.restoreInsertionPoint(ipSequenceLoops);
     }
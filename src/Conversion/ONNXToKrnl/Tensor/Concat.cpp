@@ -12,6 +12,117 @@
 
 using namespace mlir;
 
+/*!
+ * Emit the copy of `input` into `alloc`, shifted along `axis` by
+ * `dynamicOffset` if it is given, and by `staticOffset` otherwise.
+ */
+static void emitConcatCopy(ConversionPatternRewriter &rewriter, Location loc,
+    Value input, Value alloc, int64_t axis, int64_t staticOffset,
+    Value dynamicOffset) {
+  OpBuilder::InsertionGuard insertGuard(rewriter);
+  auto rank = input.getType().cast<MemRefType>().getRank();
+  // Create loop.
+  BuildKrnlLoop inputLoops(rewriter, loc, rank);
+  inputLoops.createDefineAndOptimizeOp();
+  for (int r = 0; r < rank; ++r)
+    inputLoops.pushBounds(0, input, r);
+  inputLoops.createIterateOp();
+  rewriter.setInsertionPointToStart(inputLoops.getIterateBlock());
+  // Indices for the read and write.
+  SmallVector<Value, 4> readIndices;
+  SmallVector<Value, 4> writeIndices;
+  for (int r = 0; r < rank; ++r) {
+    readIndices.emplace_back(inputLoops.getInductionVar(r));
+    if (r != axis || (!dynamicOffset && staticOffset == 0)) {
+      writeIndices.emplace_back(inputLoops.getInductionVar(r));
+    } else {
+      Value offset = dynamicOffset
+                         ? dynamicOffset
+                         : rewriter.create<ConstantIndexOp>(loc, staticOffset);
+      auto indexWithOffset =
+          rewriter.create<AddIOp>(loc, offset, inputLoops.getInductionVar(r));
+      writeIndices.emplace_back(indexWithOffset);
+    }
+  }
+  // Insert copy.
+  auto loadData = rewriter.create<LoadOp>(loc, input, readIndices);
+  rewriter.create<StoreOp>(loc, loadData, alloc, writeIndices);
+}
+
+/*!
+ * Return true if the lowering of `op` copies the buffer of its operand as a
+ * whole, ignoring its strides. This includes the operations that the runtime
+ * kernel library may compute, and the control flow operations, which copy
+ * the values carried into or yielded out of their regions.
+ */
+static bool copiesWholeBuffer(Operation *op) {
+  return isa<ONNXReshapeOp>(op) || isa<ONNXUnsqueezeOp>(op) ||
+         isa<ONNXIfOp>(op) || isa<ONNXLoopOp>(op) || isa<ONNXYieldOp>(op) ||
+         isa<ONNXTransposeOp>(op) || isa<ONNXExpOp>(op);
+}
+
+/*!
+ * Return the capacity of the key/value cache `concatOp` appends to, or 0 if
+ * it does not append to one. A concatenation appends to a cache owned by the
+ * execution session when it extends a designated past input of the entry
+ * function along the cache axis into the paired present output. The buffer
+ * of the cache is reserved for `capacity` entries along the axis, the
+ * dimensions before the axis being strided accordingly, so that the past
+ * entries keep their position when new ones are appended behind them.
+ */
+static int64_t getKVCacheCapacity(
+    ONNXConcatOp concatOp, Value pastOperand, int64_t axis) {
+  Operation *op = concatOp.getOperation();
+  auto module = op->getParentOfType<ModuleOp>();
+  auto kvCache =
+      module.getAttrOfType<ArrayAttr>(ONNXEntryPointOp::getKVCacheAttrName());
+  auto capacity = module.getAttrOfType<IntegerAttr>(
+      ONNXEntryPointOp::getKVCacheCapacityAttrName());
+  if (!kvCache || !capacity)
+    return 0;
+
+  // The past must be an argument of the entry function.
+  auto past = pastOperand.dyn_cast<BlockArgument>();
+  auto func =
+      past ? dyn_cast<FuncOp>(past.getOwner()->getParentOp()) : FuncOp();
+  if (!func || func.getAttr(ONNXEntryPointOp::getOutlinedOpAttrName()))
+    return 0;
+  auto pastType = past.getType().cast<MemRefType>();
+  if (pastType.getShape()[axis] >= 0)
+    return 0;
+
+  // Unless all the dimensions before the axis are 1, the past and the result
+  // are strided for the capacity, which operations copying their buffer as a
+  // whole do not honor.
+  bool strided = false;
+  for (int r = 0; r < axis; ++r)
+    if (pastType.getShape()[r] != 1)
+      strided = true;
+  if (strided) {
+    for (auto *user : past.getUsers())
+      if (user != op && copiesWholeBuffer(user))
+        return 0;
+    for (auto *user : op->getResult(0).getUsers())
+      if (copiesWholeBuffer(user))
+        return 0;
+  }
+
+  for (auto entry : kvCache.getValue()) {
+    auto values = entry.cast<ArrayAttr>().getValue();
+    auto pastIndex = values[0].cast<IntegerAttr>().getInt();
+    auto presentIndex = values[1].cast<IntegerAttr>().getInt();
+    auto cacheAxis = values[2].cast<IntegerAttr>().getInt();
+    if (pastIndex != past.getArgNumber() || cacheAxis != axis)
+      continue;
+    // The result must be returned as the paired present output.
+    for (auto &use : op->getResult(0).getUses())
+      if (isa<ReturnOp>(use.getOwner()) &&
+          use.getOperandNumber() == presentIndex)
+        return capacity.getInt();
+  }
+  return 0;
+}
+
 struct ONNXConcatOpLowering : public ConversionPattern {
   ONNXConcatOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXConcatOp::getOperationName(), 1, ctx) {}
@@ -25,49 +136,86 @@ struct ONNXConcatOpLowering : public ConversionPattern {
     ONNXConcatOp concatOp = llvm::dyn_cast<ONNXConcatOp>(op);
     auto axis = concatOp.axis().getSExtValue();
     int inputNum = operands.size();
-    // Alloc and dealloc.
-    auto resultOperand = concatOp.concat_result();
     auto memRefType = convertToMemRefType(*op->result_type_begin());
     auto resultShape = memRefType.getShape();
     auto rank = resultShape.size();
     assert((axis >= 0 && axis < rank) && "Concat axis out of bounds");
 
-    if (hasAllConstantDimensions(memRefType))
+    // When the size of an input along the axis is not known at compile time,
+    // the offsets at which the inputs are written are computed at runtime.
+    bool dynamicAxis = false;
+    for (int i = 0; i < inputNum; ++i)
+      if (operands[i].getType().cast<MemRefType>().getShape()[axis] < 0)
+        dynamicAxis = true;
+    SmallVector<Value, 4> writeOffsets;
+    Value resultAxisSize;
+    if (dynamicAxis) {
+      for (int i = 0; i < inputNum; ++i) {
+        writeOffsets.emplace_back(resultAxisSize);
+        Value axisSize = rewriter.create<DimOp>(loc, operands[i], axis);
+        resultAxisSize =
+            resultAxisSize
+                ? rewriter.create<AddIOp>(loc, resultAxisSize, axisSize)
+                : axisSize;
+      }
+    }
+
+    // Alloc and dealloc.
+    SmallVector<Value, 4> allocOperands;
+    for (int r = 0; r < rank; ++r)
+      if (resultShape[r] < 0)
+        allocOperands.emplace_back(r == axis
+                                       ? resultAxisSize
+                                       : rewriter.create<DimOp>(
+                                             loc, operands[0], r));
+
+    int firstInput = 0;
+    int64_t kvCacheCapacity = getKVCacheCapacity(concatOp, operands[0], axis);
+    if (kvCacheCapacity > 0) {
+      // The past is stored in a buffer owned by the execution session that
+      // is large enough to hold the result when it does not exceed the
+      // capacity of the cache: the result then views this buffer with the
+      // strides of the capacity, and only the new entries are copied.
+      // Otherwise, the result is allocated and the past copied into it.
+      auto capacity = emitConstantOp(
+          rewriter, loc, rewriter.getIndexType(), kvCacheCapacity);
+      auto fits = rewriter.create<CmpIOp>(
+          loc, CmpIPredicate::sle, resultAxisSize, capacity);
+      auto ifOp = rewriter.create<scf::IfOp>(
+          loc, ArrayRef<Type>{memRefType}, fits, /*withElseRegion=*/true);
+      {
+        OpBuilder::InsertionGuard insertGuard(rewriter);
+        rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+        Value view = rewriter.create<KrnlReinterpretOp>(loc, memRefType,
+            operands[0], allocOperands, rewriter.getI64IntegerAttr(axis),
+            rewriter.getI64IntegerAttr(kvCacheCapacity));
+        rewriter.create<scf::YieldOp>(loc, view);
+
+        rewriter.setInsertionPointToStart(&ifOp.elseRegion().front());
+        Value buffer = rewriter.create<AllocOp>(loc, memRefType, allocOperands);
+        emitConcatCopy(rewriter, loc, operands[0], buffer, axis, 0, nullptr);
+        rewriter.create<scf::YieldOp>(loc, buffer);
+      }
+      alloc = ifOp.getResult(0);
+      firstInput = 1;
+    } else if (hasAllConstantDimensions(memRefType)) {
       alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
-    else
-      alloc = insertAllocAndDealloc(
-          memRefType, loc, rewriter, insertDealloc, {resultOperand});
+    } else {
+      alloc = rewriter.create<AllocOp>(loc, memRefType, allocOperands);
+      if (insertDealloc) {
+        auto *parentBlock = alloc.getDefiningOp()->getBlock();
+        auto dealloc = rewriter.create<DeallocOp>(loc, alloc);
+        dealloc.getOperation()->moveBefore(&parentBlock->back());
+      }
+    }
 
     // Creates loops, one for each input.
     int writeOffset = 0;
     for (int i = 0; i < inputNum; ++i) {
-      OpBuilder::InsertionGuard insertGuard(rewriter);
-      // Operand info.
       auto currShape = operands[i].getType().cast<MemRefType>().getShape();
-      // Create loop.
-      BuildKrnlLoop inputLoops(rewriter, loc, rank);
-      inputLoops.createDefineAndOptimizeOp();
-      for (int r = 0; r < rank; ++r)
-        inputLoops.pushBounds(0, operands[i], r);
-      inputLoops.createIterateOp();
-      rewriter.setInsertionPointToStart(inputLoops.getIterateBlock());
-      // Indices for the read and write.
-      SmallVector<Value, 4> readIndices;
-      SmallVector<Value, 4> writeIndices;
-      for (int r = 0; r < rank; ++r) {
-        readIndices.emplace_back(inputLoops.getInductionVar(r));
-        if (r != axis || writeOffset == 0) {
-          writeIndices.emplace_back(inputLoops.getInductionVar(r));
-        } else {
-          auto indexWithOffset = rewriter.create<AddIOp>(loc,
-              rewriter.create<ConstantIndexOp>(loc, writeOffset),
-              inputLoops.getInductionVar(r));
-          writeIndices.emplace_back(indexWithOffset);
-        }
-      }
-      // Insert copy.
-      auto loadData = rewriter.create<LoadOp>(loc, operands[i], readIndices);
-      rewriter.create<StoreOp>(loc, loadData, alloc, writeIndices);
+      if (i >= firstInput)
+        emitConcatCopy(rewriter, loc, operands[i], alloc, axis, writeOffset,
+            dynamicAxis ? writeOffsets[i] : nullptr);
       // Increment offset
       writeOffset += currShape[axis];
     }
@@ -12,6 +12,20 @@
 
 using namespace mlir;
 
+// Return the name of the kernel of the runtime kernel library transposing
+// matrices of the given element type, or an empty string if there is none.
+static StringRef getTranspose2DKernelName(Type elementType) {
+  if (elementType.isF32())
+    return "omKernelTranspose2DF32";
+  if (elementType.isF64())
+    return "omKernelTranspose2DF64";
+  if (elementType.isInteger(32))
+    return "omKernelTranspose2DI32";
+  if (elementType.isInteger(64))
+    return "omKernelTranspose2DI64";
+  return "";
+}
+
 struct ONNXTransposeOpLowering : public ConversionPattern {
   ONNXTransposeOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXTransposeOp::getOperationName(), 1, ctx) {}
@@ -36,6 +50,24 @@ struct ONNXTransposeOpLowering : public ConversionPattern {
     auto memRefShape = memRefType.getShape();
     int64_t rank = memRefShape.size();
 
+    // Matrices are transposed by the runtime kernel library if the model is
+    // linked with it.
+    auto module = op->getParentOfType<ModuleOp>();
+    auto kernelName = getTranspose2DKernelName(memRefType.getElementType());
+    if (rank == 2 && !kernelName.empty() &&
+        module.getAttr(KrnlCallKernelOp::getKernelLibraryAttrName())) {
+      auto perm = llvm::dyn_cast<ONNXTransposeOp>(op).permAttr();
+      if (!perm || perm.getValue()[0].cast<IntegerAttr>().getInt() == 1) {
+        SmallVector<Value, 4> kernelOperands = {data, alloc};
+        for (int i = 0; i < 2; ++i)
+          kernelOperands.emplace_back(rewriter.create<DimOp>(loc, data, i));
+        rewriter.create<KrnlCallKernelOp>(
+            loc, rewriter.getStringAttr(kernelName), kernelOperands);
+        rewriter.replaceOp(op, alloc);
+        return success();
+      }
+    }
+
     // Define loops.
     std::vector<Value> originalLoops;
     std::vector<Value> optimizedLoops;
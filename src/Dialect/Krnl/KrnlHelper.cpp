@@ -250,6 +250,14 @@ int BuildKrnlLoop::pushBounds(Value lowerBound, Value upperBound) {
   return pushCount++;
 }
 
+int BuildKrnlLoop::pushBounds(AffineMap lowerBound,
+    ArrayRef<Value> operandsForLowerBoundMap, AffineMap upperBound,
+    ArrayRef<Value> operandsForUpperBoundMap) {
+  pack->pushAffineMapBound(lowerBound, operandsForLowerBoundMap);
+  pack->pushAffineMapBound(upperBound, operandsForUpperBoundMap);
+  return pushCount++;
+}
+
 void BuildKrnlLoop::createIterateOp() {
   // Loop definition operation is mandatory.
   assert(createdDefineOp && "Must create define op before iterate op.");
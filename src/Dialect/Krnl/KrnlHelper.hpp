@@ -164,6 +164,8 @@ public:
   int pushBounds(int64_t lowerBound, AffineMap upperBound,
       ArrayRef<Value> operandsForUpperBoundMap);
   int pushBounds(Value lowerBound, Value upperBound);
+  int pushBounds(AffineMap lowerBound, ArrayRef<Value> operandsForLowerBoundMap,
+      AffineMap upperBound, ArrayRef<Value> operandsForUpperBoundMap);
   int pushBounds(int64_t lowerBound, Value upperBoundMemRefOperand,
       int upperBoundMemRefIndex, bool upperBoundMustBeConstant = false);
 
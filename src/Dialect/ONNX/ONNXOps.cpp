@@ -2213,6 +2213,78 @@ LogicalResult ONNXConvIntegerOp::inferShapes() {
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// Loop
+//===----------------------------------------------------------------------===//
+
+// Return the type of a value that may be either of type `lhs` or `rhs`. The
+// dimensions on which both types agree are kept, and the others are dynamic.
+static Type mergeTensorTypes(Type lhs, Type rhs) {
+  auto lhsTy = lhs.dyn_cast<RankedTensorType>();
+  auto rhsTy = rhs.dyn_cast<RankedTensorType>();
+  if (!lhsTy)
+    return rhs;
+  if (!rhsTy)
+    return lhs;
+  if (lhsTy.getRank() != rhsTy.getRank())
+    return UnrankedTensorType::get(lhsTy.getElementType());
+  SmallVector<int64_t, 4> dims;
+  for (int i = 0; i < lhsTy.getRank(); ++i)
+    dims.emplace_back(lhsTy.getShape()[i] == rhsTy.getShape()[i]
+                          ? lhsTy.getShape()[i]
+                          : -1);
+  return RankedTensorType::get(dims, lhsTy.getElementType());
+}
+
+LogicalResult ONNXLoopOp::inferShapes() {
+  auto yieldOp = cast<ONNXYieldOp>(body().front().getTerminator());
+  int numCarried = v_initial().size();
+  if (yieldOp.getNumOperands() != getNumResults() + 1)
+    return emitError("Body must yield the condition and all the results");
+
+  // A loop-carried value is either its initial value or the value yielded by
+  // the body.
+  for (int i = 0; i < numCarried; ++i) {
+    auto yieldedTy = yieldOp.getOperand(i + 1).getType();
+    getResult(i).setType(mergeTensorTypes(v_initial()[i].getType(), yieldedTy));
+  }
+
+  // Scan outputs concatenate the values yielded by every iteration along a
+  // new outermost dimension.
+  for (int i = numCarried; i < getNumResults(); ++i) {
+    auto yieldedTy = yieldOp.getOperand(i + 1).getType();
+    auto rankedTy = yieldedTy.dyn_cast<RankedTensorType>();
+    if (!rankedTy)
+      return emitError("Scan output shape not inferred");
+    SmallVector<int64_t, 4> dims = {-1};
+    dims.append(rankedTy.getShape().begin(), rankedTy.getShape().end());
+    getResult(i).setType(
+        RankedTensorType::get(dims, rankedTy.getElementType()));
+  }
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// If
+//===----------------------------------------------------------------------===//
+
+LogicalResult ONNXIfOp::inferShapes() {
+  auto thenYield = cast<ONNXYieldOp>(then_branch().front().getTerminator());
+  auto elseYield = cast<ONNXYieldOp>(else_branch().front().getTerminator());
+  if (thenYield.getNumOperands() != getNumResults() ||
+      elseYield.getNumOperands() != getNumResults())
+    return emitError("Both branches must yield all the results");
+
+  for (int i = 0; i < getNumResults(); ++i) {
+    auto thenTy = thenYield.getOperand(i).getType();
+    auto elseTy = elseYield.getOperand(i).getType();
+    if (!thenTy.isa<RankedTensorType>() || !elseTy.isa<RankedTensorType>())
+      return emitError("Branch output shape not inferred");
+    getResult(i).setType(mergeTensorTypes(thenTy, elseTy));
+  }
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // TableGen'd op method definitions
 //===----------------------------------------------------------------------===//
@@ -31,6 +31,30 @@ void initOMPasses() {
         return mlir::createAttributePromotionPass();
       });
 
+  mlir::registerPass("constant-subgraph-eval",
+      "Evaluate the operations whose inputs are all constants with the JIT.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createConstantSubgraphEvaluationPass();
+      });
+
+  mlir::registerPass("fuse-sibling-matmuls",
+      "Fuse sibling MatMul and Gemm operations sharing their input.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createSiblingMatMulFusionPass();
+      });
+
+  mlir::registerPass("pipeline-partition",
+      "Partition the main graph into pipeline stages.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createPipelinePartitionPass();
+      });
+
+  mlir::registerPass("outline-onnx-ops",
+      "Outline ONNX operations into functions named after their nodes.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createOutlineONNXOpsPass();
+      });
+
   mlir::registerPass("elide-constants", "Elide values of constant operations.",
       []() -> std::unique_ptr<mlir::Pass> {
         return mlir::createElideConstantValuePass();
@@ -64,6 +88,12 @@ void initOMPasses() {
         return mlir::createKrnlLowerToLLVMPass();
       });
 
+  mlir::registerPass("memory-footprint",
+      "Compute the memory footprint of a model.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createMemoryFootprintPass();
+      });
+
   mlir::registerPass("pack-krnl-constants",
       "Elide the constant values of the Global Krnl operations.",
       []() -> std::unique_ptr<mlir::Pass> {
@@ -8,19 +8,32 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <fcntl.h>
+#include <mutex>
 #include <regex>
 #include <string>
 
+#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/Program.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Target/TargetMachine.h>
 #include <mlir/Dialect/LLVMIR/LLVMDialect.h>
+#include <mlir/IR/Diagnostics.h>
 #include <mlir/IR/SymbolTable.h>
+#include <mlir/Support/FileUtilities.h>
 
 #include "src/ExternalUtil.hpp"
 #include "src/MainUtils.hpp"
+#include "src/Pass/Remarks.hpp"
+#include "src/Runtime/RuntimeBitcode.hpp"
 
 #include "MainUtils.hpp"
 
@@ -33,6 +46,63 @@
 using namespace std;
 using namespace onnx_mlir;
 
+llvm::cl::OptionCategory OnnxMlirOptions(
+    "ONNX MLIR Options", "These are frontend options.");
+
+static llvm::cl::opt<bool> evalConstantSubgraphs("eval-constant-subgraphs",
+    llvm::cl::desc("Evaluate at compile time the operations whose inputs are "
+                   "all constants, by running them with the JIT."),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<bool> fuseSiblingMatMuls("fuse-sibling-matmuls",
+    llvm::cl::desc("Fuse the MatMul and Gemm operations multiplying the same "
+                   "input by constant weights into a single operation, when "
+                   "the reads of the input it saves outweigh the copies of "
+                   "the results split out of the fused one."),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<unsigned> optLevel("O",
+    llvm::cl::desc("Optimization level of the LLVM module of the compiled "
+                   "model, from -O0 to -O3 (default)."),
+    llvm::cl::Prefix, llvm::cl::init(3), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<bool> useKernelLibrary("kernel-library",
+    llvm::cl::desc("Call the kernels of the runtime kernel library from the "
+                   "lowering of the operations it implements."),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<string> symbolPrefix("symbol-prefix",
+    llvm::cl::desc("Prefix of the symbols of the model emitted by --EmitObj "
+                   "or --EmitStaticLib, so that several models can be linked "
+                   "into the same binary (defaults to the name of the output "
+                   "file)."),
+    llvm::cl::init(""), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<unsigned> pipelineStages("pipeline-stages",
+    llvm::cl::desc("Partition the model into the given number of stages run "
+                   "concurrently by a pipeline session (0 or 1 disables the "
+                   "partitioning)."),
+    llvm::cl::init(0), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<bool> outlineONNXOps("outline-onnx-ops",
+    llvm::cl::desc("Outline every ONNX operation into a function named "
+                   "onnx_<op type>_<node name>, so that profilers attribute "
+                   "the time spent in the model to its nodes."),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<bool> emitConstantPool("emit-constant-pool",
+    llvm::cl::desc("Keep the packed constants of the compiled model next to "
+                   "it, as <name>.constants.bin, and their layout as "
+                   "<name>.constants.json, which binary-decoder --analyze "
+                   "reads."),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+static llvm::cl::opt<std::string> remarksFilename("remarks",
+    llvm::cl::desc("Write the optimization remarks of the passes, keyed by "
+                   "ONNX node name, to the given YAML file."),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""),
+    llvm::cl::cat(OnnxMlirOptions));
+
 namespace {
 
 llvm::Optional<std::string> getEnvVar(std::string name) {
@@ -95,6 +165,49 @@ struct Command {
     }
   }
 };
+
+// Helper function quoting a string as a single-quoted YAML scalar.
+std::string quoteYAML(llvm::StringRef str) {
+  std::string quoted = "'";
+  for (auto c : str) {
+    if (c == '\'')
+      quoted += '\'';
+    quoted += c;
+  }
+  return quoted + "'";
+}
+
+// Write a remark as a YAML document. The optimization remarks emitted by the
+// passes (see src/Pass/Remarks.hpp) are written from their fields, the other
+// remarks as analyses.
+void writeRemark(llvm::raw_ostream &os, mlir::Diagnostic &diag) {
+  std::string message;
+  auto fields = mlir::getOptimizationRemarkFields(diag);
+  auto getField = [&](llvm::StringRef name) {
+    return fields.get(name).cast<mlir::StringAttr>().getValue();
+  };
+  if (fields) {
+    os << "--- !" << (getField("kind") == "applied" ? "Passed" : "Missed")
+       << "\n";
+    os << "Pass:            " << getField("pass") << "\n";
+    os << "Name:            " << getField("name") << "\n";
+    message = getField("reason").str();
+  } else {
+    os << "--- !Analysis\n";
+    message = diag.str();
+  }
+
+  auto nodeName = mlir::getONNXNodeName(diag.getLocation());
+  if (!nodeName.empty()) {
+    os << "Node:            " << quoteYAML(nodeName) << "\n";
+  } else {
+    std::string location;
+    llvm::raw_string_ostream locationStream(location);
+    locationStream << diag.getLocation();
+    os << "Location:        " << quoteYAML(locationStream.str()) << "\n";
+  }
+  os << "Message:         " << quoteYAML(message) << "\n...\n";
+}
 } // namespace
 
 void LoadMLIR(string inputFilename, mlir::MLIRContext &context,
@@ -119,8 +232,68 @@ void LoadMLIR(string inputFilename, mlir::MLIRContext &context,
   }
 }
 
-void compileModuleToSharedLibrary(
-    const mlir::OwningModuleRef &module, string outputBaseName) {
+// Prefix the names of the external symbols the LLVM module defines, and of
+// the symbols of the constant pack it refers to.
+static void prefixSymbols(llvm::Module &module, const string &symbolPrefix) {
+  for (auto &global : module.global_values()) {
+    auto name = global.getName();
+    if (global.hasLocalLinkage() || name.startswith("llvm.") ||
+        (global.isDeclaration() && !name.startswith("_binary_param_bin_")))
+      continue;
+    global.setName(llvm::Twine(symbolPrefix) + name);
+  }
+}
+
+// Emit the LLVM module as a position independent object file for the host,
+// without running llc, optimizing it and generating its code at the given
+// level, from 0 to 3.
+static void emitObjectFile(
+    llvm::Module &llvmModule, unsigned level, const string &objPath) {
+  static std::once_flag targetInitialized;
+  std::call_once(targetInitialized, []() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+
+  auto triple = llvm::sys::getDefaultTargetTriple();
+  std::string error;
+  auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+  if (!target)
+    llvm::report_fatal_error("Cannot find the target " + triple + ": " + error);
+  std::unique_ptr<llvm::TargetMachine> targetMachine(
+      target->createTargetMachine(triple, /*CPU=*/"generic", /*Features=*/"",
+          llvm::TargetOptions(), llvm::Reloc::PIC_, llvm::None,
+          static_cast<llvm::CodeGenOpt::Level>(level)));
+  llvmModule.setTargetTriple(triple);
+  llvmModule.setDataLayout(targetMachine->createDataLayout());
+
+  if (level > 0) {
+    auto transformer = mlir::makeOptimizingTransformer(
+        /*optLevel=*/level, /*sizeLevel=*/0, targetMachine.get());
+    if (auto error = transformer(&llvmModule))
+      llvm::report_fatal_error(std::move(error));
+  }
+
+  error_code ec;
+  llvm::raw_fd_ostream objStream(objPath, ec, llvm::sys::fs::F_None);
+  if (ec)
+    llvm::report_fatal_error("Cannot open " + objPath + ": " + ec.message());
+  llvm::legacy::PassManager codegenPasses;
+  if (targetMachine->addPassesToEmitFile(
+          codegenPasses, objStream, nullptr, llvm::CGFT_ObjectFile))
+    llvm::report_fatal_error("Cannot emit an object file for " + triple);
+  codegenPasses.run(llvmModule);
+  objStream.flush();
+}
+
+// Compile the module to an object file, and its constant pack to an object
+// file of its own if any, and pass their paths to `link` before removing
+// them. If the symbol prefix is not empty, the external symbols of both
+// object files are prefixed with it, which requires the runtime bitcode to be
+// linked into the model.
+static void compileModuleToObjects(const mlir::OwningModuleRef &module,
+    string outputBaseName, const string &symbolPrefix,
+    llvm::function_ref<void(const string &, llvm::Optional<string>)> link) {
   // Extract constant pack file name, which is embedded as a symbol in the
   // module being compiled.
   auto constPackFilePathSym = (*module).lookupSymbol<mlir::LLVM::GlobalOp>(
@@ -130,6 +303,17 @@ void compileModuleToSharedLibrary(
                                .getValue()
                                .str();
   llvm::FileRemover constPackRemover(constPackFilePath);
+  llvm::FileRemover constIndexRemover(constPackFilePath + ".json");
+  if (emitConstantPool) {
+    auto poolPath = outputBaseName + ".constants.bin";
+    auto indexPath = outputBaseName + ".constants.json";
+    if (llvm::sys::fs::copy_file(constPackFilePath, poolPath) ||
+        llvm::sys::fs::copy_file(constPackFilePath + ".json", indexPath))
+      llvm::errs() << "Could not write the constant pool to " << poolPath
+                   << "\n";
+    else
+      printf("Constant pool written to %s\n", poolPath.c_str());
+  }
 
   llvm::Optional<std::string> constPackObjPath;
 #if __APPLE__
@@ -175,12 +359,14 @@ void compileModuleToSharedLibrary(
   // Rename the symbols to saner ones expected by the runtime function.
   Command redefineSym(/*exePath=*/kObjCopyPath);
   redefineSym.appendStr("--redefine-sym")
-      .appendStr(sanitizedName + "_start=_binary_param_bin_start")
+      .appendStr(sanitizedName + "_start=" + symbolPrefix +
+                 "_binary_param_bin_start")
       .appendStr(constPackObjPath.getValue())
       .exec();
   redefineSym.resetArgs()
       .appendStr("--redefine-sym")
-      .appendStr(sanitizedName + "_end=_binary_param_bin_end")
+      .appendStr(
+          sanitizedName + "_end=" + symbolPrefix + "_binary_param_bin_end")
       .appendStr(constPackObjPath.getValue())
       .exec();
 
@@ -205,39 +391,68 @@ void compileModuleToSharedLibrary(
       .valueAttr(builder.getI64IntegerAttr(constPackFileName.str().size()));
 #endif
 
-  // Write LLVM bitcode.
-  string outputFilename = outputBaseName + ".bc";
-  error_code error;
-  llvm::raw_fd_ostream moduleBitcodeStream(
-      outputFilename, error, llvm::sys::fs::F_None);
-
-  llvm::WriteBitcodeToFile(
-      *mlir::translateModuleToLLVMIR(*module), moduleBitcodeStream);
-  moduleBitcodeStream.flush();
-  llvm::FileRemover bcRemover(outputFilename);
-
-  // Compile LLVM bitcode to object file.
-  Command llvmToObj(/*exePath=*/kLlcPath);
-  llvmToObj.appendStr("-filetype=obj");
-  llvmToObj.appendStr("-relocation-model=pic");
-  llvmToObj.appendStr(outputFilename);
-  llvmToObj.exec();
-  std::string modelObjPath = outputBaseName + ".o";
+  // Link the runtime functions called by the model from the runtime bitcode,
+  // so that they are optimized together with the model and inlined. Without
+  // the bitcode, they are linked from the runtime libraries.
+  auto llvmModule = mlir::translateModuleToLLVMIR(*module);
+  if (auto error = onnx_mlir::linkRuntimeBitcode(*llvmModule))
+    llvm::report_fatal_error(std::move(error));
+  if (!symbolPrefix.empty())
+    prefixSymbols(*llvmModule, symbolPrefix);
+
+  // Compile the LLVM module to an object file.
+  std::string modelObjPath = outputBaseName + ".model.o";
+  emitObjectFile(*llvmModule, std::min(optLevel.getValue(), 3u), modelObjPath);
   llvm::FileRemover modelObjRemover(modelObjPath);
 
-  llvm::Optional<std::string> runtimeDirInclFlag;
-  if (getEnvVar("RUNTIME_DIR").hasValue())
-    runtimeDirInclFlag = "-L" + getEnvVar("RUNTIME_DIR").getValue();
-
-  // Link everything into a shared object.
-  Command link(kCxxPath);
-  link.appendList({"-shared", "-fPIC"})
-      .appendStr(modelObjPath)
-      .appendStr(constPackObjPath.getValueOr(""))
-      .appendList({"-o", outputBaseName + ".so"})
-      .appendStrOpt(runtimeDirInclFlag)
-      .appendList({"-lEmbeddedDataLoader", "-lcruntime"})
-      .exec();
+  link(modelObjPath, constPackObjPath);
+}
+
+void compileModuleToSharedLibrary(
+    const mlir::OwningModuleRef &module, string outputBaseName) {
+  compileModuleToObjects(module, outputBaseName, /*symbolPrefix=*/"",
+      [&](const string &modelObjPath, llvm::Optional<string> constPackObjPath) {
+        llvm::Optional<std::string> runtimeDirInclFlag;
+        if (getEnvVar("RUNTIME_DIR").hasValue())
+          runtimeDirInclFlag = "-L" + getEnvVar("RUNTIME_DIR").getValue();
+
+        // Link everything into a shared object.
+        Command link(kCxxPath);
+        link.appendList({"-shared", "-fPIC"})
+            .appendStr(modelObjPath)
+            .appendStr(constPackObjPath.getValueOr(""))
+            .appendList({"-o", outputBaseName + ".so"})
+            .appendStrOpt(runtimeDirInclFlag)
+            .appendList({"-lEmbeddedDataLoader", "-lcruntime"})
+            .exec();
+      });
+}
+
+void compileModuleToStaticLibrary(const mlir::OwningModuleRef &module,
+    string outputBaseName, string symbolPrefix, bool archive) {
+  compileModuleToObjects(module, outputBaseName, symbolPrefix + "_",
+      [&](const string &modelObjPath, llvm::Optional<string> constPackObjPath) {
+        // Merge the model and its constant pack into a single relocatable
+        // object file.
+        string objPath = outputBaseName + ".o";
+        Command link(/*exePath=*/kLinkerPath);
+        link.appendStr("-r")
+            .appendList({"-o", objPath})
+            .appendStr(modelObjPath)
+            .appendStrOpt(constPackObjPath)
+            .exec();
+        if (!archive)
+          return;
+
+        llvm::FileRemover objRemover(objPath);
+        string archivePath = outputBaseName + ".a";
+        llvm::sys::fs::remove(archivePath);
+        Command createArchive(/*exePath=*/kArPath);
+        createArchive.appendStr("rcs")
+            .appendStr(archivePath)
+            .appendStr(objPath)
+            .exec();
+      });
 }
 
 void registerDialects() {
@@ -257,11 +472,22 @@ void addONNXToMLIRPasses(mlir::PassManager &pm) {
   pm.addPass(mlir::createAttributePromotionPass());
   pm.addPass(mlir::createShapeInferencePass());
   pm.addPass(mlir::createAttributePromotionPass());
+  if (evalConstantSubgraphs) {
+    pm.addPass(mlir::createConstantSubgraphEvaluationPass());
+    pm.addPass(mlir::createCanonicalizerPass());
+  }
+  if (fuseSiblingMatMuls)
+    pm.addPass(mlir::createSiblingMatMulFusionPass());
+  if (pipelineStages > 1)
+    pm.addPass(mlir::createPipelinePartitionPass(pipelineStages));
+  if (outlineONNXOps)
+    pm.addPass(mlir::createOutlineONNXOpsPass());
 }
 
 void addONNXToKrnlPasses(mlir::PassManager &pm) {
   pm.addPass(mlir::createLowerToKrnlPass());
-  pm.addPass(mlir::createPackKrnlGlobalConstantsPass());
+  pm.addPass(mlir::createPackKrnlGlobalConstantsPass(
+      /*writeIndex=*/emitConstantPool));
   // An additional pass of canonicalization is helpful because lowering
   // from ONNX dialect to Standard dialect exposes additional canonicalization
   // oppertunities.
@@ -269,6 +495,7 @@ void addONNXToKrnlPasses(mlir::PassManager &pm) {
 
   // TODO: make this pass optional:
   pm.addPass(mlir::createKrnlEnableMemoryPoolPass());
+  pm.addPass(mlir::createMemoryFootprintPass());
 }
 
 void addKrnlToAffinePasses(mlir::PassManager &pm) {
@@ -347,6 +574,18 @@ void emitOutputFiles(string outputBaseName, EmissionTargetType emissionTarget,
     // Write LLVM bitcode to disk, compile & link.
     compileModuleToSharedLibrary(module, outputBaseName);
     printf("Shared library %s.so has been compiled.\n", outputBaseName.c_str());
+  } else if (emissionTarget == EmitObj || emissionTarget == EmitStaticLib) {
+    // The symbols are prefixed with a valid C identifier, by default the name
+    // of the output file.
+    auto prefix = symbolPrefix.empty()
+                      ? llvm::sys::path::filename(outputBaseName).str()
+                      : symbolPrefix.getValue();
+    prefix = std::regex_replace(prefix, std::regex("[^0-9A-Za-z_]"), "_");
+    bool archive = emissionTarget == EmitStaticLib;
+    compileModuleToStaticLibrary(module, outputBaseName, prefix, archive);
+    printf("%s %s.%s has been compiled, with symbols prefixed by %s_.\n",
+        archive ? "Static library" : "Object file", outputBaseName.c_str(),
+        archive ? "a" : "o", prefix.c_str());
   } else {
     // Emit the version with all constants included.
     outputCode(module, outputBaseName, ".onnx.mlir");
@@ -374,6 +613,187 @@ void emitOutputFiles(string outputBaseName, EmissionTargetType emissionTarget,
   }
 }
 
+// Return the function of the entry point of the module, or nullptr if the
+// module has no entry point.
+static mlir::FuncOp lookupEntryFunction(mlir::OwningModuleRef &module) {
+  mlir::ONNXEntryPointOp entryPoint;
+  (*module).walk([&](mlir::ONNXEntryPointOp op) { entryPoint = op; });
+  if (!entryPoint)
+    return nullptr;
+  return (*module).lookupSymbol<mlir::FuncOp>(
+      entryPoint
+          .getAttrOfType<mlir::SymbolRefAttr>(
+              mlir::ONNXEntryPointOp::getEntryPointFuncAttrName())
+          .getLeafReference());
+}
+
+bool setKVCacheAttrs(mlir::OwningModuleRef &module,
+    const std::vector<std::string> &specs, int64_t capacity) {
+  if (capacity <= 0) {
+    llvm::errs() << "The key/value cache capacity must be positive.\n";
+    return false;
+  }
+  auto func = lookupEntryFunction(module);
+  if (!func) {
+    llvm::errs() << "A key/value cache requires an entry point.\n";
+    return false;
+  }
+  auto funcType = func.getType();
+
+  mlir::Builder builder(module->getContext());
+  llvm::SmallVector<mlir::Attribute, 4> kvCache;
+  for (const auto &spec : specs) {
+    // Parse <past input index>:<present output index>:<axis>.
+    llvm::SmallVector<llvm::StringRef, 3> fields;
+    llvm::StringRef(spec).split(fields, ':');
+    int64_t pastIndex, presentIndex, axis;
+    if (fields.size() != 3 || fields[0].getAsInteger(10, pastIndex) ||
+        fields[1].getAsInteger(10, presentIndex) ||
+        fields[2].getAsInteger(10, axis)) {
+      llvm::errs() << "Invalid key/value cache '" << spec
+                   << "', expected <past input>:<present output>:<axis>.\n";
+      return false;
+    }
+    if (pastIndex < 0 || pastIndex >= funcType.getNumInputs() ||
+        presentIndex < 0 || presentIndex >= funcType.getNumResults()) {
+      llvm::errs() << "Invalid key/value cache '" << spec
+                   << "', no such input or output.\n";
+      return false;
+    }
+    auto pastType =
+        funcType.getInput(pastIndex).dyn_cast<mlir::RankedTensorType>();
+    if (!pastType || axis < 0 || axis >= pastType.getRank()) {
+      llvm::errs() << "Invalid key/value cache '" << spec
+                   << "', the past must be a ranked tensor with this axis.\n";
+      return false;
+    }
+    int64_t elementSize = (pastType.getElementTypeBitWidth() + 7) / 8;
+    kvCache.emplace_back(
+        builder.getI64ArrayAttr({pastIndex, presentIndex, axis, elementSize}));
+  }
+
+  (*module).setAttr(mlir::ONNXEntryPointOp::getKVCacheAttrName(),
+      builder.getArrayAttr(kvCache));
+  (*module).setAttr(mlir::ONNXEntryPointOp::getKVCacheCapacityAttrName(),
+      builder.getI64IntegerAttr(capacity));
+  return true;
+}
+
+bool setDimBoundsAttrs(
+    mlir::OwningModuleRef &module, const std::vector<std::string> &specs) {
+  auto func = lookupEntryFunction(module);
+  if (!func) {
+    llvm::errs() << "Dimension bounds require an entry point.\n";
+    return false;
+  }
+  auto funcType = func.getType();
+
+  // Bounds of every dimension of every input, -1 when unbounded, starting
+  // from the bounds annotated in the model.
+  std::vector<llvm::SmallVector<int64_t, 4>> bounds(funcType.getNumInputs());
+  for (int i = 0; i < bounds.size(); ++i) {
+    if (auto inputType = funcType.getInput(i).dyn_cast<mlir::ShapedType>())
+      bounds[i].resize(inputType.getRank(), -1);
+    if (auto annotated = func.getArgAttrOfType<mlir::ArrayAttr>(
+            i, mlir::ONNXEntryPointOp::getDimBoundsAttrName()))
+      for (int d = 0; d < annotated.size() && d < bounds[i].size(); ++d)
+        bounds[i][d] =
+            annotated.getValue()[d].cast<mlir::IntegerAttr>().getInt();
+  }
+
+  for (const auto &spec : specs) {
+    // Parse <input index>:<dimension>=<bound> or <dim_param>=<bound>.
+    llvm::StringRef input, dim, bound;
+    std::tie(input, bound) = llvm::StringRef(spec).split('=');
+    int64_t maxSize;
+    if (bound.getAsInteger(10, maxSize) || maxSize < 0) {
+      llvm::errs() << "Invalid dimension bound '" << spec
+                   << "', expected <input>:<dimension>=<bound> or "
+                      "<dim_param>=<bound>.\n";
+      return false;
+    }
+
+    // Bound every dimension of the inputs with the given name.
+    if (!input.contains(':')) {
+      bool found = false;
+      for (int i = 0; i < bounds.size(); ++i) {
+        auto dimParams = func.getArgAttrOfType<mlir::ArrayAttr>(
+            i, mlir::ONNXEntryPointOp::getDimParamsAttrName());
+        if (!dimParams)
+          continue;
+        for (int d = 0; d < dimParams.size() && d < bounds[i].size(); ++d)
+          if (dimParams.getValue()[d].cast<mlir::StringAttr>().getValue() ==
+              input) {
+            bounds[i][d] = maxSize;
+            found = true;
+          }
+      }
+      if (!found) {
+        llvm::errs() << "Invalid dimension bound '" << spec
+                     << "', no dimension is named '" << input << "'.\n";
+        return false;
+      }
+      continue;
+    }
+
+    int64_t inputIndex, dimIndex;
+    std::tie(input, dim) = input.split(':');
+    if (input.getAsInteger(10, inputIndex) || dim.getAsInteger(10, dimIndex)) {
+      llvm::errs() << "Invalid dimension bound '" << spec
+                   << "', expected <input>:<dimension>=<bound> or "
+                      "<dim_param>=<bound>.\n";
+      return false;
+    }
+    auto inputType =
+        inputIndex < 0 || inputIndex >= funcType.getNumInputs()
+            ? mlir::RankedTensorType()
+            : funcType.getInput(inputIndex).dyn_cast<mlir::RankedTensorType>();
+    if (!inputType || dimIndex < 0 || dimIndex >= inputType.getRank() ||
+        !inputType.isDynamicDim(dimIndex)) {
+      llvm::errs() << "Invalid dimension bound '" << spec
+                   << "', no such dynamic dimension.\n";
+      return false;
+    }
+    bounds[inputIndex][dimIndex] = maxSize;
+  }
+
+  mlir::Builder builder(module->getContext());
+  for (int i = 0; i < bounds.size(); ++i)
+    if (llvm::any_of(bounds[i], [](int64_t bound) { return bound >= 0; }))
+      func.setArgAttr(i, mlir::ONNXEntryPointOp::getDimBoundsAttrName(),
+          builder.getI64ArrayAttr(bounds[i]));
+  return true;
+}
+
+// Write the memory footprint of the model computed by the memory footprint
+// pass next to the compiled model, as <outputBaseName>.footprint.json.
+static void emitMemoryFootprint(
+    mlir::OwningModuleRef &module, std::string outputBaseName) {
+  llvm::StringRef footprint;
+  if (auto footprintAttr = (*module).getAttrOfType<mlir::StringAttr>(
+          mlir::KrnlEntryPointOp::getMemoryFootprintAttrName()))
+    footprint = footprintAttr.getValue();
+  else if (auto footprintSym = (*module).lookupSymbol<mlir::LLVM::GlobalOp>(
+               mlir::KrnlEntryPointOp::getMemoryFootprintSymbolName()))
+    footprint = footprintSym.valueAttr()
+                    .cast<mlir::StringAttr>()
+                    .getValue()
+                    .rtrim('\0');
+  else
+    return;
+
+  std::string errorMessage;
+  auto footprintPath = outputBaseName + ".footprint.json";
+  auto output = mlir::openOutputFile(footprintPath, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return;
+  }
+  output->os() << footprint << "\n";
+  output->keep();
+  printf("Memory footprint written to %s\n", footprintPath.c_str());
+}
+
 int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
     std::string outputBaseName, EmissionTargetType emissionTarget) {
   mlir::PassManager pm(&context);
@@ -389,8 +809,57 @@ int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
   if (emissionTarget >= EmitLLVMIR)
     addKrnlToLLVMPasses(pm);
 
+  // Models linked into a host binary call runtime functions of their own,
+  // which only the runtime bitcode provides.
+  if (emissionTarget == EmitObj || emissionTarget == EmitStaticLib) {
+#if !__linux__
+    llvm::errs() << "Object files and static libraries can only be emitted "
+                    "on Linux.\n";
+    return 4;
+#endif
+    if (!onnx_mlir::getRuntimeBitcodePath()) {
+      llvm::errs() << "Object files and static libraries require the runtime "
+                      "bitcode, which was not built.\n";
+      return 4;
+    }
+  }
+
+  // The lowerings may call the runtime kernel library, which is linked into
+  // the compiled model.
+  if (emissionTarget >= EmitMLIR && useKernelLibrary)
+    (*module).setAttr(mlir::KrnlCallKernelOp::getKernelLibraryAttrName(),
+        mlir::UnitAttr::get(&context));
+
+  // The passes only emit their remarks when a remarks file is given, for
+  // the duration of the pipeline.
+  std::unique_ptr<llvm::ToolOutputFile> remarksFile;
+  if (!remarksFilename.empty()) {
+    std::string errorMessage;
+    remarksFile = mlir::openOutputFile(remarksFilename, &errorMessage);
+    if (!remarksFile) {
+      llvm::errs() << errorMessage << "\n";
+      return 4;
+    }
+    (*module).setAttr(
+        mlir::getRemarksAttrName(), mlir::UnitAttr::get(&context));
+  }
+  mlir::ScopedDiagnosticHandler remarksHandler(
+      &context, [&](mlir::Diagnostic &diag) {
+        if (diag.getSeverity() != mlir::DiagnosticSeverity::Remark)
+          return mlir::failure();
+        if (remarksFile)
+          writeRemark(remarksFile->os(), diag);
+        return mlir::success();
+      });
+
   if (mlir::failed(pm.run(*module)))
     return 4;
+  if (remarksFile) {
+    (*module).getOperation()->removeAttr(mlir::getRemarksAttrName());
+    remarksFile->keep();
+  }
+
+  emitMemoryFootprint(module, outputBaseName);
 
   emitOutputFiles(outputBaseName, emissionTarget, context, module);
   return 0;
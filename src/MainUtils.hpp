@@ -37,12 +37,17 @@
 #include "mlir/Target/LLVMIR.h"
 #include "mlir/Transforms/Passes.h"
 
+// Options of the onnx-mlir driver, shared with the pass pipeline setup.
+extern llvm::cl::OptionCategory OnnxMlirOptions;
+
 enum EmissionTargetType {
   EmitONNXBasic,
   EmitONNXIR,
   EmitMLIR,
   EmitLLVMIR,
   EmitLib,
+  EmitObj,
+  EmitStaticLib,
 };
 
 void LoadMLIR(std::string inputFilename, mlir::MLIRContext &context,
@@ -51,6 +56,13 @@ void LoadMLIR(std::string inputFilename, mlir::MLIRContext &context,
 void compileModuleToSharedLibrary(
     const mlir::OwningModuleRef &module, std::string outputBaseName);
 
+// Compile the module into a relocatable object file, or a static library if
+// `archive` is set, embedding its constants. The external symbols of the
+// model, e.g. its entry points, are prefixed with `symbolPrefix` and an
+// underscore, and the runtime functions it calls are private copies.
+void compileModuleToStaticLibrary(const mlir::OwningModuleRef &module,
+    std::string outputBaseName, std::string symbolPrefix, bool archive);
+
 void registerDialects();
 
 void addONNXToMLIRPasses(mlir::PassManager &pm);
@@ -72,5 +84,20 @@ void emitOutputFiles(std::string outputBaseName,
     EmissionTargetType emissionTarget, mlir::MLIRContext &context,
     mlir::OwningModuleRef &module);
 
+// Mark the module so that the execution session keeps the key/value caches
+// described by `specs`, each given as "<past input>:<present output>:<axis>",
+// in buffers holding `capacity` entries along the axis. Returns false and
+// reports an error if a specification is invalid.
+bool setKVCacheAttrs(mlir::OwningModuleRef &module,
+    const std::vector<std::string> &specs, int64_t capacity);
+
+// Bound the dynamic dimensions of the inputs of the model as described by
+// `specs`, each given as "<input>:<dimension>=<bound>" or, for the dimensions
+// named by an ONNX dim_param, "<dim_param>=<bound>". The specifications
+// override the bounds annotated in the model. Returns false and reports an
+// error if a specification is invalid.
+bool setDimBoundsAttrs(
+    mlir::OwningModuleRef &module, const std::vector<std::string> &specs);
+
 int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
     std::string outputBaseName, EmissionTargetType targetType);
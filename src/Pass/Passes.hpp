@@ -25,6 +25,22 @@ std::unique_ptr<Pass> createConstPropONNXToONNXPass();
 /// Pass for promoting constant operands to attributes.
 std::unique_ptr<Pass> createAttributePromotionPass();
 
+/// Pass for evaluating at compile time, with the JIT, the operations whose
+/// inputs are all constants.
+std::unique_ptr<Pass> createConstantSubgraphEvaluationPass();
+
+/// Pass for fusing sibling MatMul or Gemm operations that multiply the same
+/// input by constant weights into a single operation.
+std::unique_ptr<Pass> createSiblingMatMulFusionPass();
+
+/// Pass for partitioning the main graph into the given number of pipeline
+/// stages of balanced estimated cost.
+std::unique_ptr<Pass> createPipelinePartitionPass(int numStages = 2);
+
+/// Pass for outlining the operations of the entry functions into functions
+/// named after their ONNX nodes.
+std::unique_ptr<Pass> createOutlineONNXOpsPass();
+
 /// Pass for eliding the values of constant operations.
 std::unique_ptr<Pass> createElideConstantValuePass();
 
@@ -43,7 +59,12 @@ std::unique_ptr<Pass> createElideConstGlobalValuePass();
 /// Pass for lowering Krnl dialect to LLVM dialect.
 std::unique_ptr<Pass> createKrnlLowerToLLVMPass();
 
-/// Pass for packing Krnl global constants.
-std::unique_ptr<Pass> createPackKrnlGlobalConstantsPass();
+/// Pass for packing Krnl global constants, writing their layout next to their
+/// file if `writeIndex` is set.
+std::unique_ptr<Pass> createPackKrnlGlobalConstantsPass(
+    bool writeIndex = false);
+
+/// Pass for computing the memory footprint of a model.
+std::unique_ptr<Pass> createMemoryFootprintPass();
 
 } // end namespace mlir
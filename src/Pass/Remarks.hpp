@@ -0,0 +1,83 @@
+//===---------- Remarks.hpp - ONNX MLIR Optimization Remarks --------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file declares the helpers the passes of ONNX MLIR use to report their
+// optimization decisions as MLIR remarks. A remark states whether an
+// optimization was applied to, or missed for, an operation and why. It is
+// keyed by the name of the ONNX node the operation was imported from, so that
+// the onnx-mlir driver can collect the remarks of a model into a file (see
+// --remarks). Remarks are only emitted for modules that request them, so
+// that passes run without --remarks, e.g. by onnx-mlir-opt, stay quiet.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Module.h"
+
+namespace mlir {
+
+/// Whether an optimization was applied or missed.
+enum class RemarkKind { Applied, Missed };
+
+/// Return the name of the ONNX node a location refers to, or an empty string
+/// if it is unknown.
+inline StringRef getONNXNodeName(Location loc) {
+  if (auto nameLoc = loc.dyn_cast<NameLoc>())
+    return nameLoc.getName().strref();
+  if (auto fusedLoc = loc.dyn_cast<FusedLoc>())
+    for (auto nestedLoc : fusedLoc.getLocations())
+      if (auto nameLoc = nestedLoc.dyn_cast<NameLoc>())
+        return nameLoc.getName().strref();
+  return "";
+}
+
+/// Unit attribute set on a module whose passes emit optimization remarks.
+inline StringRef getRemarksAttrName() { return "onnx.remarks"; }
+
+/// Emit a remark reporting that the optimization `name` of the pass `pass`
+/// was applied to, or missed for, `op`, if the module of `op` requests
+/// remarks. The message of the remark reads
+/// "[<pass>] <applied|missed> <name>: <reason>", and its fields are attached
+/// to it as a note holding a dictionary attribute (see
+/// getOptimizationRemarkFields).
+inline void emitOptimizationRemark(Operation *op, StringRef pass,
+    StringRef name, RemarkKind kind, const Twine &reason) {
+  auto module = isa<ModuleOp>(op) ? cast<ModuleOp>(op)
+                                  : op->getParentOfType<ModuleOp>();
+  if (!module || !module.getAttr(getRemarksAttrName()))
+    return;
+
+  Builder builder(op->getContext());
+  StringRef kindName = kind == RemarkKind::Applied ? "applied" : "missed";
+  auto message = reason.str();
+  auto remark = emitRemark(op->getLoc());
+  remark << "[" << pass << "] " << kindName << " " << name << ": " << message;
+  remark.attachNote() << builder.getDictionaryAttr(
+      {builder.getNamedAttr("pass", builder.getStringAttr(pass)),
+          builder.getNamedAttr("name", builder.getStringAttr(name)),
+          builder.getNamedAttr("kind", builder.getStringAttr(kindName)),
+          builder.getNamedAttr("reason", builder.getStringAttr(message))});
+}
+
+/// Return the fields of an optimization remark emitted by
+/// emitOptimizationRemark: its "pass", "name", "kind" and "reason", or a null
+/// attribute for other diagnostics.
+inline DictionaryAttr getOptimizationRemarkFields(Diagnostic &diag) {
+  for (auto &note : diag.getNotes())
+    for (auto &arg : note.getArguments())
+      if (arg.getKind() ==
+          DiagnosticArgument::DiagnosticArgumentKind::Attribute)
+        if (auto fields = arg.getAsAttribute().dyn_cast<DictionaryAttr>())
+          if (fields.get("pass") && fields.get("kind"))
+            return fields;
+  return DictionaryAttr();
+}
+
+} // end namespace mlir
@@ -0,0 +1,408 @@
+//===------------ BatchScorer.cpp - BatchScorer Implementation ------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of BatchScorer class, which runs a
+// compiled model offline over a dataset stored in files, batch after batch.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "BatchScorer.hpp"
+
+namespace onnx_mlir {
+
+namespace {
+
+const char kNpyMagic[] = "\x93NUMPY";
+
+void throwSystemError(const std::string &what) {
+  throw std::runtime_error(what + ": " + strerror(errno));
+}
+
+int64_t product(std::vector<int64_t>::const_iterator begin,
+    std::vector<int64_t>::const_iterator end) {
+  return std::accumulate(begin, end, (int64_t)1, std::multiplies<int64_t>());
+}
+
+// Return the value of a key of the dictionary held by the header of a .npy
+// file, e.g. '<f4' for 'descr' or (4, 3) for 'shape', or an empty string if
+// the key is missing.
+std::string getNpyField(const std::string &header, const std::string &key) {
+  auto pos = header.find("'" + key + "'");
+  if (pos == std::string::npos || (pos = header.find(':', pos)) == header.npos)
+    return "";
+  auto begin = header.find_first_not_of(' ', pos + 1);
+  if (begin == std::string::npos)
+    return "";
+  // Tuples and strings end with their closing character, other values
+  // before the next separator.
+  size_t end;
+  if (header[begin] == '(')
+    end = header.find(')', begin) + 1;
+  else if (header[begin] == '\'')
+    end = header.find('\'', begin + 1) + 1;
+  else
+    end = header.find_first_of(",}", begin);
+  if (end == std::string::npos || end == 0)
+    return "";
+  return header.substr(begin, end - begin);
+}
+
+// Fault in the pages of a range of memory.
+void touchPages(const char *begin, size_t size) {
+  if (size == 0)
+    return;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  auto first = (uintptr_t)begin & ~(pageSize - 1);
+  auto end = (uintptr_t)begin + size;
+  madvise((void *)first, end - first, MADV_WILLNEED);
+  for (auto page = first; page < end; page += pageSize)
+    (void)*(volatile char *)page;
+}
+
+// Drop the pages lying entirely within a range of memory, which the batches
+// staged next do not share.
+void dropPages(const char *begin, size_t size) {
+  long pageSize = sysconf(_SC_PAGESIZE);
+  auto first = ((uintptr_t)begin + pageSize - 1) & ~(pageSize - 1);
+  auto end = ((uintptr_t)begin + size) & ~(pageSize - 1);
+  if (first < end)
+    madvise((void *)first, end - first, MADV_DONTNEED);
+}
+
+std::vector<int> getCoreGroup(const ThreadingConfig &config, size_t i) {
+  return i < config.coreGroups.size() ? config.coreGroups[i]
+                                      : std::vector<int>();
+}
+} // namespace
+
+BatchScorer::MappedFile::~MappedFile() {
+  if (map)
+    munmap(map, mapSize);
+}
+
+BatchScorer::BatchScorer(
+    std::string sharedLibPath, int64_t batchSize, ThreadingConfig config)
+    : _batchSize(batchSize), _config(config) {
+  // The model reads private copy-on-write mappings of the files, so it may
+  // overwrite its inputs.
+  _session = std::make_unique<ExecutionSession>(sharedLibPath,
+      "_dyn_entry_point_main_graph", /*donateInputs=*/true);
+  _inputs = _session->getInputSignature();
+  _outputElementSizes = _session->getOutputElementSizes();
+  if (_inputs.empty() || _outputElementSizes.empty())
+    throw std::runtime_error(
+        "Library does not export the signature of its inputs and outputs: " +
+        sharedLibPath);
+  for (size_t i = 0; i < _inputs.size(); i++)
+    if (_inputs[i].dims.empty())
+      throw std::runtime_error(
+          "Input " + std::to_string(i) + " has no sample dimension");
+
+  if (_inputs[0].dims[0] >= 0) {
+    _batchSize = _inputs[0].dims[0];
+    _staticBatch = true;
+  }
+  if (_batchSize < 1)
+    throw std::runtime_error("Batch size must be positive");
+  _session->warmup();
+}
+
+std::shared_ptr<BatchScorer::MappedFile> BatchScorer::mapFile(
+    const std::string &path, const ExecutionSession::TensorSignature &input) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throwSystemError("Cannot open " + path);
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) < 0) {
+    close(fd);
+    throwSystemError("Cannot stat " + path);
+  }
+
+  auto file = std::make_shared<MappedFile>();
+  file->mapSize = fileStat.st_size;
+  if (file->mapSize > 0) {
+    void *map = mmap(nullptr, file->mapSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      throwSystemError("Cannot map " + path);
+    }
+    file->map = (char *)map;
+  }
+  close(fd);
+
+  size_t dataSize;
+  const size_t magicSize = sizeof(kNpyMagic) - 1;
+  if (file->mapSize >= magicSize + 4 &&
+      memcmp(file->map, kNpyMagic, magicSize) == 0) {
+    // A .npy file: the magic string, the version, the size of the header
+    // and the header, a Python dictionary describing the array.
+    auto *bytes = (const unsigned char *)file->map;
+    size_t headerBegin, headerSize;
+    if (bytes[6] == 1) {
+      headerBegin = 10;
+      headerSize = bytes[8] | bytes[9] << 8;
+    } else {
+      headerBegin = 12;
+      headerSize = bytes[8] | bytes[9] << 8 | bytes[10] << 16 |
+                   (size_t)bytes[11] << 24;
+    }
+    if (headerBegin + headerSize > file->mapSize)
+      throw std::runtime_error("Truncated .npy header: " + path);
+    std::string header(file->map + headerBegin, headerSize);
+
+    auto descr = getNpyField(header, "descr");
+    if (descr.size() < 5 || std::string("<|=").find(descr[1]) == descr.npos ||
+        std::string("biufc").find(descr[2]) == descr.npos)
+      throw std::runtime_error(
+          "Unsupported .npy element type " + descr + ": " + path);
+    file->kind = descr[2];
+    file->elementSize = std::stoll(descr.substr(3, descr.size() - 4));
+    if (getNpyField(header, "fortran_order") != "False")
+      throw std::runtime_error("Unsupported .npy Fortran order: " + path);
+    auto shape = getNpyField(header, "shape");
+    for (size_t pos = 1; pos < shape.size();) {
+      auto end = shape.find_first_of(",)", pos);
+      auto dim = shape.substr(pos, end - pos);
+      if (dim.find_first_not_of(' ') != std::string::npos)
+        file->dims.emplace_back(std::stoll(dim));
+      pos = end + 1;
+    }
+    file->data = file->map + headerBegin + headerSize;
+    dataSize = file->mapSize - headerBegin - headerSize;
+  } else {
+    // A raw file: its samples take the static dimensions of the input.
+    for (size_t d = 1; d < input.dims.size(); d++)
+      if (input.dims[d] < 0)
+        throw std::runtime_error(
+            "Input with dynamic dimensions must be a .npy file: " + path);
+    int64_t sampleSize =
+        input.elementSize * product(input.dims.begin() + 1, input.dims.end());
+    if (sampleSize == 0 || file->mapSize % sampleSize != 0)
+      throw std::runtime_error(
+          "Raw file does not hold whole samples of the input: " + path);
+    file->elementSize = input.elementSize;
+    file->dims = input.dims;
+    file->dims[0] = file->mapSize / sampleSize;
+    file->data = file->map;
+    dataSize = file->mapSize;
+  }
+
+  // The integers of the model are signless, so they are read from signed
+  // and unsigned integers alike.
+  bool kindMatches = !file->kind || !input.kind || file->kind == input.kind ||
+                     (input.kind == 'i' && file->kind == 'u');
+  bool matches = kindMatches && file->elementSize == input.elementSize &&
+                 file->dims.size() == input.dims.size();
+  for (size_t d = 1; matches && d < input.dims.size(); d++)
+    matches = input.dims[d] < 0 || input.dims[d] == file->dims[d];
+  if (!matches)
+    throw std::runtime_error(
+        "File does not match the signature of its input: " + path);
+  if (file->elementSize * product(file->dims.begin(), file->dims.end()) >
+      (int64_t)dataSize)
+    throw std::runtime_error("Truncated file: " + path);
+  return file;
+}
+
+void BatchScorer::stage(
+    const std::vector<std::vector<std::string>> &shards, std::vector<int> cores) {
+  if (!cores.empty())
+    ThreadingConfig::pinCurrentThread(cores);
+  for (const auto &shard : shards) {
+    if (_failed)
+      break;
+    std::vector<std::shared_ptr<MappedFile>> files;
+    try {
+      if (shard.size() != _inputs.size())
+        throw std::runtime_error("Shard has " + std::to_string(shard.size()) +
+                                 " files for " +
+                                 std::to_string(_inputs.size()) + " inputs");
+      for (size_t i = 0; i < shard.size(); i++) {
+        files.emplace_back(mapFile(shard[i], _inputs[i]));
+        if (files[i]->dims[0] != files[0]->dims[0])
+          throw std::runtime_error(
+              "Files of a shard have different numbers of samples: " +
+              shard[i]);
+      }
+    } catch (...) {
+      auto batch = std::make_unique<Batch>();
+      batch->error = std::current_exception();
+      _staged->push(std::move(batch));
+      break;
+    }
+
+    int64_t numSamples = files[0]->dims[0];
+    for (int64_t first = 0; first < numSamples && !_failed;
+         first += _batchSize) {
+      auto batch = std::make_unique<Batch>();
+      batch->files = files;
+      batch->firstSample = first;
+      batch->numSamples = std::min(_batchSize, numSamples - first);
+      batch->paddedSamples = _staticBatch ? _batchSize : batch->numSamples;
+
+      for (const auto &file : files) {
+        auto *input = new DynMemRef(file->dims.size());
+        input->offset = 0;
+        std::copy(file->dims.begin(), file->dims.end(), input->sizes);
+        input->sizes[0] = batch->paddedSamples;
+        auto strides = input->computeStridesFromSizes();
+        std::copy(strides.begin(), strides.end(), input->strides);
+
+        int64_t sampleSize = file->elementSize *
+                             product(file->dims.begin() + 1, file->dims.end());
+        char *begin = file->data + first * sampleSize;
+        size_t size = batch->numSamples * sampleSize;
+        if (batch->paddedSamples == batch->numSamples) {
+          // The batch is passed in place; the file owns its data.
+          input->data = nullptr;
+          input->alignedData = begin;
+          touchPages(begin, size);
+        } else {
+          input->data = calloc(batch->paddedSamples, sampleSize);
+          input->alignedData = input->data;
+          memcpy(input->data, begin, size);
+        }
+        batch->values.emplace_back(input);
+      }
+      _staged->push(std::move(batch));
+    }
+  }
+  _staged->push(nullptr);
+}
+
+void BatchScorer::run(std::vector<int> cores) {
+  if (!cores.empty())
+    ThreadingConfig::pinCurrentThread(cores);
+  while (auto batch = _staged->pop()) {
+    if (!batch->error && !_failed) {
+      try {
+        batch->values = _session->run(std::move(batch->values));
+      } catch (...) {
+        batch->values.clear();
+        batch->error = std::current_exception();
+        _failed = true;
+      }
+    }
+    _scored->push(std::move(batch));
+  }
+  _scored->push(nullptr);
+}
+
+void BatchScorer::write(
+    const std::vector<std::string> &outputPaths, std::vector<int> cores) {
+  if (!cores.empty())
+    ThreadingConfig::pinCurrentThread(cores);
+  std::vector<FILE *> outputs;
+  try {
+    for (const auto &path : outputPaths) {
+      outputs.emplace_back(fopen(path.c_str(), "wb"));
+      if (!outputs.back())
+        throwSystemError("Cannot open " + path);
+    }
+  } catch (...) {
+    _error = std::current_exception();
+    _failed = true;
+  }
+
+  _outputSampleDims.resize(outputPaths.size());
+  while (auto batch = _scored->pop()) {
+    if (!_error && batch->error) {
+      _error = batch->error;
+      _failed = true;
+    }
+    if (!_error) {
+      try {
+        if (batch->values.size() != outputs.size())
+          throw std::runtime_error("Model returned " +
+                                   std::to_string(batch->values.size()) +
+                                   " outputs for " +
+                                   std::to_string(outputs.size()) +
+                                   " in its signature");
+        for (size_t i = 0; i < outputs.size(); i++) {
+          // Outputs along the batch are trimmed of their padded samples.
+          const auto &output = *batch->values[i];
+          std::vector<int64_t> dims(output.sizes, output.sizes + output.rank);
+          int64_t elementSize = _outputElementSizes[i];
+          size_t size = output.size() * elementSize;
+          if (!dims.empty() && dims[0] == batch->paddedSamples) {
+            size = size / batch->paddedSamples * batch->numSamples;
+            dims.erase(dims.begin());
+          }
+          auto *data = (char *)output.alignedData + output.offset * elementSize;
+          if (fwrite(data, 1, size, outputs[i]) != size)
+            throwSystemError("Cannot write " + outputPaths[i]);
+          _outputSampleDims[i] = dims;
+        }
+        _numScored += batch->numSamples;
+      } catch (...) {
+        _error = std::current_exception();
+        _failed = true;
+      }
+    }
+
+    // Outputs computed in place point into the files, so the pages of the
+    // batch are only dropped once its outputs are written.
+    batch->values.clear();
+    for (const auto &file : batch->files) {
+      int64_t sampleSize = file->elementSize *
+                           product(file->dims.begin() + 1, file->dims.end());
+      dropPages(file->data + batch->firstSample * sampleSize,
+          batch->numSamples * sampleSize);
+    }
+  }
+
+  for (size_t i = 0; i < outputs.size(); i++)
+    if (outputs[i] && fclose(outputs[i]) != 0 && !_error) {
+      try {
+        throwSystemError("Cannot write " + outputPaths[i]);
+      } catch (...) {
+        _error = std::current_exception();
+      }
+    }
+}
+
+int64_t BatchScorer::score(const std::vector<std::vector<std::string>> &shards,
+    const std::vector<std::string> &outputPaths) {
+  if (outputPaths.size() != _outputElementSizes.size())
+    throw std::runtime_error("Model has " +
+                             std::to_string(_outputElementSizes.size()) +
+                             " outputs, " + std::to_string(outputPaths.size()) +
+                             " output files given");
+  _staged = std::make_unique<SPSCQueue<std::unique_ptr<Batch>>>(
+      1, _config.spinDuration);
+  _scored = std::make_unique<SPSCQueue<std::unique_ptr<Batch>>>(
+      _config.queueDepth, _config.spinDuration);
+  _failed = false;
+  _error = nullptr;
+  _numScored = 0;
+
+  std::thread stager(&BatchScorer::stage, this, std::cref(shards),
+      getCoreGroup(_config, 0));
+  std::thread runner(&BatchScorer::run, this, getCoreGroup(_config, 1));
+  std::thread writer(&BatchScorer::write, this, std::cref(outputPaths),
+      getCoreGroup(_config, 2));
+  stager.join();
+  runner.join();
+  writer.join();
+
+  if (_error)
+    std::rethrow_exception(_error);
+  return _numScored;
+}
+} // namespace onnx_mlir
@@ -0,0 +1,121 @@
+//===------------- BatchScorer.hpp - BatchScorer Declaration --------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of BatchScorer class, which runs a compiled
+// model offline over a dataset stored in files, batch after batch.
+//
+// The dataset is split into shards, each made of one file per input of the
+// model, whose samples are laid out along the first dimension. A file is
+// either a .npy file, in C order and little endian, or a raw file holding
+// the samples only, whose other dimensions are given by the input signature
+// of the model. The files are memory-mapped and the batches are passed to the
+// model in place, without being copied.
+//
+// Three threads overlap: one stages the next batch, faulting in its pages,
+// one runs the model on the current batch, and one appends the outputs of
+// the previous batch to the output files, in raw form.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/Runtime/ExecusionSession.hpp"
+#include "src/Runtime/SPSCQueue.hpp"
+#include "src/Runtime/ThreadingConfig.hpp"
+
+namespace onnx_mlir {
+
+class BatchScorer {
+public:
+  // Score with the model of `sharedLibPath`, `batchSize` samples at a time.
+  // Models whose first input dimension is static are run on batches of that
+  // size, the last batch of a shard being padded with zeros. The stages run
+  // on the first three core groups of the threading configuration, when
+  // configured.
+  BatchScorer(std::string sharedLibPath, int64_t batchSize,
+      ThreadingConfig config = ThreadingConfig::fromEnvironment());
+
+  // Score the shards, in order, appending output i of every batch to
+  // `outputPaths[i]`. Return the number of samples scored. An error raised
+  // by a stage is rethrown here once the other stages stopped.
+  int64_t score(const std::vector<std::vector<std::string>> &shards,
+      const std::vector<std::string> &outputPaths);
+
+  // Return the size in bytes of the elements of every output.
+  const std::vector<int64_t> &getOutputElementSizes() const {
+    return _outputElementSizes;
+  }
+
+  // Return the dimensions of a sample of every output, as seen on the last
+  // batch scored.
+  const std::vector<std::vector<int64_t>> &getOutputSampleDims() const {
+    return _outputSampleDims;
+  }
+
+protected:
+  // A memory-mapped input file and the description of its samples.
+  struct MappedFile {
+    char *map = nullptr;
+    size_t mapSize = 0;
+    char *data = nullptr;
+    int64_t elementSize = 0;
+    // The NumPy kind of the elements of a .npy file, or 0 for a raw file.
+    char kind = 0;
+    std::vector<int64_t> dims;
+
+    ~MappedFile();
+  };
+
+  // A batch flowing through the stages: its inputs pointing into the files
+  // kept mapped until it is written, then its outputs, or the error that
+  // stopped it.
+  struct Batch {
+    std::vector<std::shared_ptr<MappedFile>> files;
+    int64_t firstSample = 0;
+    int64_t numSamples = 0;
+    int64_t paddedSamples = 0;
+    std::vector<std::unique_ptr<DynMemRef>> values;
+    std::exception_ptr error;
+  };
+
+  std::shared_ptr<MappedFile> mapFile(
+      const std::string &path, const ExecutionSession::TensorSignature &input);
+
+  void stage(const std::vector<std::vector<std::string>> &shards,
+      std::vector<int> cores);
+
+  void run(std::vector<int> cores);
+
+  void write(const std::vector<std::string> &outputPaths,
+      std::vector<int> cores);
+
+  std::unique_ptr<ExecutionSession> _session;
+  std::vector<ExecutionSession::TensorSignature> _inputs;
+  std::vector<int64_t> _outputElementSizes;
+  int64_t _batchSize;
+  bool _staticBatch = false;
+  ThreadingConfig _config;
+
+  // Queue of the staged batches, holding a single batch so that the stager
+  // stays one batch ahead of the model, and queue of the batches to write.
+  // A null batch stops the next stage.
+  std::unique_ptr<SPSCQueue<std::unique_ptr<Batch>>> _staged;
+  std::unique_ptr<SPSCQueue<std::unique_ptr<Batch>>> _scored;
+
+  // Set once a stage failed, so that the stager stops early. The first error
+  // is kept by the writer, the last stage.
+  std::atomic<bool> _failed{false};
+  std::exception_ptr _error;
+  int64_t _numScored = 0;
+  std::vector<std::vector<int64_t>> _outputSampleDims;
+};
+} // namespace onnx_mlir
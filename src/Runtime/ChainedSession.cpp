@@ -0,0 +1,190 @@
+//===--------- ChainedSession.cpp - ChainedSession Implementation ---------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of ChainedSession class, which runs
+// several compiled models back to back, the outputs of a model being passed
+// to the next ones as inputs without being copied.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "ChainedSession.hpp"
+
+namespace onnx_mlir {
+
+namespace {
+
+// Release a value. A value computed in place into it, which points into its
+// buffer without owning it, takes over the ownership of the buffer.
+void release(std::vector<std::unique_ptr<DynMemRef>> &values, size_t v) {
+  auto &value = values[v];
+  for (auto &other : values)
+    if (other && other != value && !other->data &&
+        other->alignedData == value->alignedData) {
+      other->data = value->data;
+      value->data = nullptr;
+      break;
+    }
+  value.reset();
+}
+} // namespace
+
+ChainedSession::ChainedSession(
+    const std::vector<ChainStage> &stages, std::vector<size_t> outputs)
+    : _outputs(std::move(outputs)) {
+  if (stages.empty())
+    throw std::runtime_error("A chain needs at least one stage");
+  auto sortedOutputs = _outputs;
+  std::sort(sortedOutputs.begin(), sortedOutputs.end());
+  if (std::adjacent_find(sortedOutputs.begin(), sortedOutputs.end()) !=
+      sortedOutputs.end())
+    throw std::runtime_error("A value can only be returned once by a chain");
+
+  // The chain owns all its values, so every stage may overwrite the values
+  // it is the last to use.
+  for (const auto &stage : stages) {
+    _sessions.emplace_back(std::make_unique<ExecutionSession>(
+        stage.sharedLibPath, "_dyn_entry_point_main_graph",
+        /*donateInputs=*/true));
+    _stageInputs.emplace_back(stage.inputs);
+  }
+}
+
+DynMemRef *ChainedSession::borrow(
+    const DynMemRef &value, size_t stage, size_t input) {
+  auto *borrowed = new DynMemRef(value.rank);
+  std::copy(value.sizes, value.sizes + value.rank, borrowed->sizes);
+  if (!_sessions[stage]->writesInputs()) {
+    // A view of the buffer, which the stage does not free.
+    std::copy(value.strides, value.strides + value.rank, borrowed->strides);
+    borrowed->offset = value.offset;
+    borrowed->data = nullptr;
+    borrowed->alignedData = value.alignedData;
+    return borrowed;
+  }
+
+  // A copy of the buffer, which the stage may overwrite.
+  auto signature = _sessions[stage]->getInputSignature();
+  if (input >= signature.size()) {
+    delete borrowed;
+    throw std::runtime_error("Stage " + std::to_string(stage) +
+                             " does not export the signature of its inputs");
+  }
+  int64_t elementSize = signature[input].elementSize;
+  auto strides = borrowed->computeStridesFromSizes();
+  std::copy(strides.begin(), strides.end(), borrowed->strides);
+  borrowed->offset = 0;
+  borrowed->data = malloc(value.size() * elementSize);
+  borrowed->alignedData = borrowed->data;
+  memcpy(borrowed->data,
+      (char *)value.alignedData + value.offset * elementSize,
+      value.size() * elementSize);
+  return borrowed;
+}
+
+std::vector<std::unique_ptr<DynMemRef>> ChainedSession::run(
+    std::vector<std::unique_ptr<DynMemRef>> ins) {
+  const size_t numStages = _sessions.size();
+  const size_t kept = numStages;
+  auto values = std::move(ins);
+  // Stage producing every value, numStages for the inputs of the chain, and
+  // last stage using it, kept if returned by the chain.
+  std::vector<size_t> lastUses;
+  size_t producedBegin = 0;
+
+  // Record the last uses of the values produced by a stage.
+  auto addValues = [&](size_t producer) {
+    for (size_t v = lastUses.size(); v < values.size(); v++) {
+      size_t lastUse = numStages;
+      bool used = false;
+      size_t next = producer == numStages ? 0 : producer + 1;
+      if (next < numStages && _stageInputs[next].empty()) {
+        lastUse = next;
+        used = true;
+      }
+      for (size_t s = next; s < numStages; s++)
+        if (std::find(_stageInputs[s].begin(), _stageInputs[s].end(), v) !=
+            _stageInputs[s].end()) {
+          lastUse = s;
+          used = true;
+        }
+      bool returned =
+          _outputs.empty()
+              ? producer == numStages - 1
+              : std::find(_outputs.begin(), _outputs.end(), v) !=
+                    _outputs.end();
+      if (returned)
+        lastUse = kept;
+      else if (!used)
+        lastUse = producer == numStages ? 0 : producer;
+      lastUses.emplace_back(lastUse);
+    }
+  };
+  addValues(numStages);
+
+  for (size_t stage = 0; stage < numStages; stage++) {
+    auto inputs = _stageInputs[stage];
+    if (inputs.empty())
+      for (size_t v = producedBegin; v < values.size(); v++)
+        inputs.emplace_back(v);
+
+    std::vector<std::unique_ptr<DynMemRef>> stageIns;
+    for (size_t i = 0; i < inputs.size(); i++) {
+      size_t v = inputs[i];
+      if (v >= values.size())
+        throw std::runtime_error("Stage " + std::to_string(stage) +
+                                 " uses value " + std::to_string(v) +
+                                 ", which is not computed before it");
+      auto &value = values[v];
+      if (!value)
+        stageIns.emplace_back(nullptr);
+      else if (lastUses[v] == stage &&
+               std::count(inputs.begin(), inputs.end(), v) == 1)
+        stageIns.emplace_back(std::move(value));
+      else
+        stageIns.emplace_back(borrow(*value, stage, i));
+    }
+
+    producedBegin = values.size();
+    for (auto &output : _sessions[stage]->run(std::move(stageIns)))
+      values.emplace_back(std::move(output));
+    addValues(stage);
+
+    // Release the values no stage uses anymore.
+    for (size_t v = 0; v < values.size(); v++)
+      if (values[v] && lastUses[v] <= stage)
+        release(values, v);
+  }
+
+  std::vector<std::unique_ptr<DynMemRef>> outs;
+  if (_outputs.empty())
+    for (size_t v = producedBegin; v < values.size(); v++)
+      outs.emplace_back(std::move(values[v]));
+  for (size_t v : _outputs) {
+    if (v >= values.size())
+      throw std::runtime_error(
+          "Chain returns value " + std::to_string(v) + ", which is not computed");
+    outs.emplace_back(std::move(values[v]));
+  }
+
+  // The values left point into returned values or are no longer used; a
+  // returned value computed in place into one of them takes over its buffer.
+  for (size_t v = 0; v < values.size(); v++)
+    if (values[v]) {
+      for (auto &out : outs)
+        if (out && !out->data && out->alignedData == values[v]->alignedData) {
+          out->data = values[v]->data;
+          values[v]->data = nullptr;
+          break;
+        }
+      values[v].reset();
+    }
+  return outs;
+}
+} // namespace onnx_mlir
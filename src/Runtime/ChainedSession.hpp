@@ -0,0 +1,63 @@
+//===---------- ChainedSession.hpp - ChainedSession Declaration -----------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of ChainedSession class, which runs several
+// compiled models back to back, the outputs of a model being passed to the
+// next ones as inputs without being copied.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/Runtime/ExecusionSession.hpp"
+
+namespace onnx_mlir {
+
+// A model of a chain and the values of the chain passed as its inputs. The
+// values of a chain are numbered in order of creation: the inputs of the
+// chain, then the outputs of every stage.
+struct ChainStage {
+  std::string sharedLibPath;
+
+  // Value passed as every input of the model. If empty, the outputs of the
+  // previous stage, or the inputs of the chain for the first stage, are
+  // passed in order.
+  std::vector<size_t> inputs;
+};
+
+class ChainedSession {
+public:
+  // Load the models of the stages. The values returned by run are given by
+  // `outputs`, or are the outputs of the last stage if empty.
+  ChainedSession(
+      const std::vector<ChainStage> &stages, std::vector<size_t> outputs = {});
+
+  // Run the stages in order; the inputs are consumed by the call.
+  //
+  // A value is moved into the stage using it last, which may compute its
+  // outputs in place into it when compiled with --donate-inputs. Stages
+  // using a value before that are passed a view of its buffer, or a copy of
+  // it if their model may overwrite it. A value is released as soon as no
+  // stage uses it anymore.
+  std::vector<std::unique_ptr<DynMemRef>> run(
+      std::vector<std::unique_ptr<DynMemRef>> ins);
+
+  size_t numStages() const { return _sessions.size(); }
+
+protected:
+  // Value passed as input `input` of stage `stage`, which is not its last
+  // use, without giving up the ownership of its buffer.
+  DynMemRef *borrow(const DynMemRef &value, size_t stage, size_t input);
+
+  std::vector<std::unique_ptr<ExecutionSession>> _sessions;
+  std::vector<std::vector<size_t>> _stageInputs;
+  std::vector<size_t> _outputs;
+};
+} // namespace onnx_mlir
@@ -9,19 +9,27 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstring>
 #include <iostream>
+#include <link.h>
 #include <memory>
 #include <sstream>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <vector>
 
 #include "ExecusionSession.hpp"
 
 namespace onnx_mlir {
 
-ExecutionSession::ExecutionSession(
-    std::string sharedLibPath, std::string entryPointName) {
+ExecutionSession::ExecutionSession(std::string sharedLibPath,
+    std::string entryPointName, bool donateInputs)
+    : _sharedLibPath(sharedLibPath), _entryPointName(entryPointName),
+      _donateInputs(donateInputs) {
   // Adapted from https://www.tldp.org/HOWTO/html_single/C++-dlopen/.
-  _sharedLibraryHandle = dlopen(sharedLibPath.c_str(), RTLD_LAZY);
+  // The symbols of the library are bound when it is opened, rather than at
+  // their first call during the first run.
+  _sharedLibraryHandle = dlopen(sharedLibPath.c_str(), RTLD_NOW);
   if (!_sharedLibraryHandle) {
     std::stringstream errStr;
     errStr << "Cannot open library: " << dlerror() << std::endl;
@@ -40,13 +48,245 @@ ExecutionSession::ExecutionSession(
     dlclose(_sharedLibraryHandle);
     throw std::runtime_error(errStr.str());
   }
+
+  // Models compiled to overwrite donated inputs export a marker symbol.
+  _modelWritesInputs = dlsym(_sharedLibraryHandle, "inputsDonated") != nullptr;
+  dlerror();
+
+  // Models appending to key/value caches export their configuration: the
+  // capacity, the number of caches, and four values per cache.
+  auto *kvCacheConfig = (int64_t *)dlsym(_sharedLibraryHandle, "kvCacheConfig");
+  dlerror();
+  if (kvCacheConfig) {
+    _kvCacheCapacity = kvCacheConfig[0];
+    for (int64_t i = 0; i < kvCacheConfig[1]; i++) {
+      int64_t *entry = kvCacheConfig + 2 + 4 * i;
+      _kvCaches.emplace_back(
+          KVCache{entry[0], entry[1], entry[2], entry[3], nullptr});
+    }
+  }
+
+  // Models with bounded dynamic dimensions export the bounds of their inputs:
+  // the number of inputs, and the rank and bounds of every input. Models
+  // also export the signature of their outputs.
+  const std::string prefix = "_dyn_entry_point_";
+  if (entryPointName.compare(0, prefix.size(), prefix) == 0) {
+    auto boundsName = "_input_bounds_" + entryPointName.substr(prefix.size());
+    auto *bounds = (int64_t *)dlsym(_sharedLibraryHandle, boundsName.c_str());
+    dlerror();
+    if (bounds) {
+      int64_t *entry = bounds + 1;
+      for (int64_t i = 0; i < bounds[0]; i++) {
+        _inputBounds.emplace_back(entry + 1, entry + 1 + entry[0]);
+        entry += 1 + entry[0];
+      }
+    }
+
+    // The output signature holds the number of outputs, and the element
+    // size, element kind, rank and dimensions of every output.
+    auto signatureName =
+        "_output_signature_" + entryPointName.substr(prefix.size());
+    auto *signature =
+        (int64_t *)dlsym(_sharedLibraryHandle, signatureName.c_str());
+    dlerror();
+    if (signature) {
+      int64_t *entry = signature + 1;
+      for (int64_t i = 0; i < signature[0]; i++) {
+        _outputElementSizes.emplace_back(entry[0]);
+        entry += 3 + entry[2];
+      }
+    }
+  }
+}
+
+DynMemRef *ExecutionSession::createKVCacheBuffer(
+    const DynMemRef &past, const KVCache &cache) {
+  // The buffer holds `entries` entries along the axis for every index of the
+  // dimensions before it, so that the entries of the past keep their
+  // position when the model appends new ones behind them.
+  int64_t entries = std::max(_kvCacheCapacity, past.sizes[cache.axis]);
+  int64_t rows = 1, entryElements = 1;
+  for (unsigned int i = 0; i < cache.axis; i++)
+    rows *= past.sizes[i];
+  for (unsigned int i = cache.axis + 1; i < past.rank; i++)
+    entryElements *= past.sizes[i];
+
+  auto *buffer = new DynMemRef(past.rank);
+  buffer->offset = 0;
+  std::copy(past.sizes, past.sizes + past.rank, buffer->sizes);
+  int64_t stride = 1;
+  for (int i = past.rank - 1; i >= 0; i--) {
+    buffer->strides[i] = stride;
+    stride *= i == cache.axis ? entries : past.sizes[i];
+  }
+  buffer->data = malloc(rows * entries * entryElements * cache.elementSize);
+  buffer->alignedData = buffer->data;
+
+  // Copy the contiguous past row by row.
+  int64_t pastRowSize =
+      past.sizes[cache.axis] * entryElements * cache.elementSize;
+  int64_t bufferRowSize = entries * entryElements * cache.elementSize;
+  auto *pastData = (char *)past.alignedData + past.offset * cache.elementSize;
+  for (int64_t row = 0; row < rows; row++)
+    memcpy((char *)buffer->data + row * bufferRowSize,
+        pastData + row * pastRowSize, pastRowSize);
+  return buffer;
+}
+
+void ExecutionSession::checkInputBounds(
+    size_t index, const std::vector<int64_t> &dims) const {
+  if (index >= _inputBounds.size())
+    return;
+  const auto &bounds = _inputBounds[index];
+  for (size_t d = 0; d < dims.size() && d < bounds.size(); d++)
+    if (bounds[d] >= 0 && dims[d] > bounds[d]) {
+      std::stringstream errStr;
+      errStr << "Dimension " << d << " of input " << index << " is "
+             << dims[d] << ", which exceeds its bound " << bounds[d];
+      throw std::runtime_error(errStr.str());
+    }
+}
+
+DynMemRef *ExecutionSession::copyInput(
+    const DynMemRef &input, size_t index) const {
+  auto signature = getInputSignature();
+  if (index >= signature.size())
+    throw std::runtime_error(
+        "The model may overwrite its inputs but does not export their "
+        "signature, so input " +
+        std::to_string(index) + " cannot be copied; donate the inputs");
+  int64_t elementSize = signature[index].elementSize;
+  auto *copy = new DynMemRef(input.rank);
+  copy->offset = 0;
+  std::copy(input.sizes, input.sizes + input.rank, copy->sizes);
+  auto strides = copy->computeStridesFromSizes();
+  std::copy(strides.begin(), strides.end(), copy->strides);
+  copy->data = malloc(input.size() * elementSize);
+  copy->alignedData = copy->data;
+  memcpy(copy->data,
+      (char *)input.alignedData + input.offset * elementSize,
+      input.size() * elementSize);
+  return copy;
+}
+
+void ExecutionSession::resetKVCache() {
+  for (auto &cache : _kvCaches)
+    cache.past.reset();
+}
+
+void ExecutionSession::warmup(bool runInference) {
+  // Touch every page of the loaded segments of the library, which hold its
+  // code and its embedded constants.
+  Dl_info info;
+  if (dladdr((void *)_entryPointFunc, &info)) {
+    auto touchSegments = [](struct dl_phdr_info *phdrInfo, size_t,
+                             void *base) {
+      if ((void *)phdrInfo->dlpi_addr != base)
+        return 0;
+      long pageSize = sysconf(_SC_PAGESIZE);
+      for (int i = 0; i < phdrInfo->dlpi_phnum; i++) {
+        const auto &phdr = phdrInfo->dlpi_phdr[i];
+        if (phdr.p_type != PT_LOAD)
+          continue;
+        auto begin = (phdrInfo->dlpi_addr + phdr.p_vaddr) & ~(pageSize - 1);
+        auto end = phdrInfo->dlpi_addr + phdr.p_vaddr + phdr.p_memsz;
+        madvise((void *)begin, end - begin, MADV_WILLNEED);
+        for (auto page = begin; page < end; page += pageSize)
+          (void)*(volatile char *)page;
+      }
+      return 1;
+    };
+    // The base address of a library is its load bias, unless it is linked
+    // at a fixed address.
+    dl_iterate_phdr(touchSegments, info.dli_fbase);
+  }
+
+  // The constant pool and the buffers of the model are first touched by a
+  // run on inputs of the right shape.
+  auto signature = getInputSignature();
+  if (!runInference || signature.empty())
+    return;
+
+  std::vector<std::unique_ptr<DynMemRef>> ins;
+  for (const auto &input : signature) {
+    auto *dmr = new DynMemRef(input.dims.size());
+    dmr->offset = 0;
+    for (size_t d = 0; d < input.dims.size(); d++)
+      dmr->sizes[d] = std::max<int64_t>(input.dims[d], 1);
+    auto strides = dmr->computeStridesFromSizes();
+    std::copy(strides.begin(), strides.end(), dmr->strides);
+    dmr->data = calloc(dmr->size(), input.elementSize);
+    dmr->alignedData = dmr->data;
+    ins.emplace_back(dmr);
+  }
+  run(std::move(ins));
+  resetKVCache();
+}
+
+std::vector<ExecutionSession::TensorSignature>
+ExecutionSession::getInputSignature() const {
+  // The input signature holds the number of inputs, and the element size,
+  // element kind, rank and dimensions of every input.
+  std::vector<TensorSignature> inputs;
+  const std::string prefix = "_dyn_entry_point_";
+  if (_entryPointName.compare(0, prefix.size(), prefix) != 0)
+    return inputs;
+  auto signatureName =
+      "_input_signature_" + _entryPointName.substr(prefix.size());
+  auto *signature =
+      (int64_t *)dlsym(_sharedLibraryHandle, signatureName.c_str());
+  dlerror();
+  if (!signature)
+    return inputs;
+
+  int64_t *entry = signature + 1;
+  for (int64_t i = 0; i < signature[0]; i++) {
+    inputs.emplace_back(TensorSignature{entry[0], (char)entry[1],
+        std::vector<int64_t>(entry + 3, entry + 3 + entry[2])});
+    entry += 3 + entry[2];
+  }
+  return inputs;
+}
+
+std::string ExecutionSession::getMemoryFootprint() const {
+  auto *footprint =
+      (const char *)dlsym(_sharedLibraryHandle, "_memory_footprint");
+  dlerror();
+  return footprint ? std::string(footprint) : std::string();
 }
 
 std::vector<std::unique_ptr<DynMemRef>> ExecutionSession::run(
     std::vector<std::unique_ptr<DynMemRef>> ins) {
+  // The buffers of the model are planned for inputs within their bounds.
+  for (size_t i = 0; i < ins.size(); i++)
+    if (ins[i])
+      checkInputBounds(i, std::vector<int64_t>(
+                              ins[i]->sizes, ins[i]->sizes + ins[i]->rank));
+
+  // The buffers owned by the inputs are consumed by the call, but those the
+  // inputs only point to still belong to the caller, who did not allow the
+  // model to overwrite them.
+  if (inputsNeedCopy())
+    for (size_t i = 0; i < ins.size(); i++)
+      if (ins[i] && !ins[i]->data)
+        ins[i].reset(copyInput(*ins[i], i));
+
+  // Past inputs given by the caller start new sequences, the others continue
+  // from the present outputs of the previous run.
+  for (auto &cache : _kvCaches) {
+    auto &past = ins.at(cache.pastIndex);
+    if (past)
+      cache.past.reset(createKVCacheBuffer(*past, cache));
+    else if (!cache.past)
+      throw std::runtime_error("No past given for key/value cache input " +
+                               std::to_string(cache.pastIndex));
+  }
+
   auto *wrappedInput = createOrderedDynMemRefDict();
   for (size_t i = 0; i < ins.size(); i++)
     setDynMemRef(wrappedInput, i, ins.at(i).get());
+  for (auto &cache : _kvCaches)
+    setDynMemRef(wrappedInput, cache.pastIndex, cache.past.get());
 
   auto *wrappedOutput = _entryPointFunc(wrappedInput);
 
@@ -57,6 +297,23 @@ std::vector<std::unique_ptr<DynMemRef>> ExecutionSession::run(
     outs.emplace_back(
         std::unique_ptr<DynMemRef>(getDynMemRef(wrappedOutput, i)));
   }
+
+  // An output computed in place into an input buffer now owns that buffer, so
+  // the input must not release it.
+  for (auto &in : ins)
+    for (auto &out : outs)
+      if (in && in->data == out->data)
+        in->data = nullptr;
+
+  // Keep the present outputs as the pasts of the next run. A present
+  // appended in place into the buffer of its past takes over that buffer.
+  for (auto &cache : _kvCaches) {
+    auto &present = outs.at(cache.presentIndex);
+    if (present->data == cache.past->data)
+      cache.past->data = nullptr;
+    cache.past = std::move(present);
+  }
+
   return std::move(outs);
 }
 
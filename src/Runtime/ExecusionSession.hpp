@@ -13,7 +13,9 @@
 
 #include <cassert>
 #include <dlfcn.h>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "src/Runtime/DynMemRef.h"
 
@@ -23,18 +25,132 @@ typedef OrderedDynMemRefDict *(*entryPointFuncType)(OrderedDynMemRefDict *);
 
 class ExecutionSession {
 public:
-  ExecutionSession(std::string sharedLibPath, std::string entryPointName);
+  // If donateInputs is set, the caller allows the model to overwrite the
+  // buffers of the inputs passed to run; models compiled with --donate-inputs
+  // then compute results in place into dead inputs.
+  ExecutionSession(std::string sharedLibPath, std::string entryPointName,
+      bool donateInputs = false);
 
+  // A session closes its library when destroyed, so it cannot be copied.
+  ExecutionSession(const ExecutionSession &) = delete;
+  ExecutionSession &operator=(const ExecutionSession &) = delete;
+
+  // Run the model on the calling thread; the inputs are consumed by the
+  // call. An output computed in place into a donated input takes over the
+  // ownership of its buffer. Unless the inputs are donated, inputs that do
+  // not own their buffer are copied before running a model that may overwrite
+  // them. Inputs exceeding the bounds of their dimensions given at compile
+  // time (see --dim-bounds) are rejected.
+  //
+  // For models compiled with --kv-cache, the session keeps every present
+  // output and feeds it back as the paired past input of the next run: the
+  // caller passes nullptr at the past input to continue the sequence, or a
+  // past to start a new one, and gets nullptr at the present output.
   std::vector<std::unique_ptr<DynMemRef>> run(
       std::vector<std::unique_ptr<DynMemRef>>);
 
+  // Drop the key/value caches kept by the session.
+  void resetKVCache();
+
+  // Whether the session keeps key/value caches from one run to the next, in
+  // which case its runs must not overlap.
+  bool hasKVCaches() const { return !_kvCaches.empty(); }
+
+  // Pay the one-time costs of the first run ahead of time: fault in the
+  // pages of the code and constants of the model, and, if runInference is
+  // set, run it once on zero inputs built from its input signature, dynamic
+  // dimensions being 1. The key/value caches are reset afterwards. The
+  // symbols of the model are already bound when the session opens it.
+  void warmup(bool runInference = true);
+
+  // Return the memory footprint of the model as computed at compile time, a
+  // JSON document described in src/Transform/MemoryFootprint.cpp, or an
+  // empty string if the model does not record it.
+  std::string getMemoryFootprint() const;
+
+  // Whether the model may overwrite the buffers of its inputs, when compiled
+  // with --donate-inputs and given donated inputs.
+  bool writesInputs() const { return _modelWritesInputs && _donateInputs; }
+
+  // The size in bytes and the kind of the elements of a tensor, and its
+  // dimensions, -1 when dynamic. The kind is the character NumPy uses for
+  // it: 'b' for booleans, 'i' for integers, which are signless, 'f' for
+  // floats, or 0 for other element types.
+  struct TensorSignature {
+    int64_t elementSize;
+    char kind;
+    std::vector<int64_t> dims;
+  };
+
+  // Return the signature of every input of the model, or an empty vector if
+  // the model does not export the signature of its inputs.
+  std::vector<TensorSignature> getInputSignature() const;
+
+  // Return the size in bytes of the elements of every output of the model,
+  // which its outputs do not carry, or an empty vector if the model does not
+  // export the signature of its outputs.
+  const std::vector<int64_t> &getOutputElementSizes() const {
+    return _outputElementSizes;
+  }
+
+  // Throw if the dimensions of input `index` exceed the bounds given at
+  // compile time, for which the buffers of the model are planned.
+  void checkInputBounds(size_t index, const std::vector<int64_t> &dims) const;
+
   ~ExecutionSession();
 
 protected:
+  // A key/value cache whose present output is fed back as its past input.
+  struct KVCache {
+    int64_t pastIndex;
+    int64_t presentIndex;
+    int64_t axis;
+    int64_t elementSize;
+    // The past of the next run, in a buffer reserved for the capacity of the
+    // cache.
+    std::unique_ptr<DynMemRef> past;
+  };
+
+  // Copy the contiguous past given by the caller into a buffer reserved for
+  // the capacity of the cache, in which the model appends the new entries.
+  // The dimensions before the axis are strided for the capacity.
+  DynMemRef *createKVCacheBuffer(const DynMemRef &past, const KVCache &cache);
+
+  // Whether the buffers of the inputs of the model must be copied before
+  // running it, to shield the caller's data from being overwritten.
+  bool inputsNeedCopy() const { return _modelWritesInputs && !_donateInputs; }
+
+  // Copy input `index` into a buffer owned by the copy, using the element
+  // size given by the input signature of the model.
+  DynMemRef *copyInput(const DynMemRef &input, size_t index) const;
+
   // Handler to the shared library file being loaded.
   void *_sharedLibraryHandle = nullptr;
 
+  // Path of the shared library and name of the entry point.
+  std::string _sharedLibPath;
+  std::string _entryPointName;
+
   // Entry point function.
   entryPointFuncType _entryPointFunc = nullptr;
+
+  // Whether the caller donates the input buffers to the model.
+  bool _donateInputs = false;
+
+  // Whether the model was compiled to write into its input buffers.
+  bool _modelWritesInputs = false;
+
+  // Number of entries along their axis the key/value caches can hold.
+  int64_t _kvCacheCapacity = 0;
+
+  // Key/value caches of models compiled with --kv-cache.
+  std::vector<KVCache> _kvCaches;
+
+  // Upper bounds of the dimensions of every input, -1 when unbounded, for
+  // models compiled with --dim-bounds.
+  std::vector<std::vector<int64_t>> _inputBounds;
+
+  // Element sizes in bytes of the outputs of the model.
+  std::vector<int64_t> _outputElementSizes;
 };
 } // namespace onnx_mlir
\ No newline at end of file
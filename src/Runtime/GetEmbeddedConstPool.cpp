@@ -36,7 +36,7 @@ void checkEndianness() {
 #include <mach-o/getsect.h>
 extern const struct mach_header_64 _mh_dylib_header;
 
-void *getEmbeddedConstPool(int64_t size_in_byte) {
+static void *loadEmbeddedConstPool(int64_t size_in_byte) {
   checkEndianness();
   size_t size = size_in_byte;
   unsigned char *data =
@@ -48,14 +48,94 @@ void *getEmbeddedConstPool(int64_t size_in_byte) {
 }
 
 #elif __linux__
+#include <atomic>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 extern char _binary_param_bin_start;
 extern char _binary_param_bin_end;
 
-void *getEmbeddedConstPool(int64_t _) {
+// Placement of the constant pool on machines with several NUMA nodes, chosen
+// with the ONNX_MLIR_CONST_POOL_NUMA environment variable:
+//  - "replicate": every node gets its own copy of the pool, and a thread
+//    reads the copy of the node it runs on;
+//  - "interleave": a single copy of the pool has its pages spread over all
+//    the nodes, so that no node serves all the reads;
+//  - otherwise, the pool is copied by every call.
+enum ConstPoolNUMAPolicy { NUMA_NONE, NUMA_REPLICATE, NUMA_INTERLEAVE };
+
+#define MAX_NUMA_NODES 64
+#define MPOL_INTERLEAVE 3
+
+static ConstPoolNUMAPolicy getNUMAPolicy() {
+  static ConstPoolNUMAPolicy policy = []() {
+    const char *env = getenv("ONNX_MLIR_CONST_POOL_NUMA");
+    if (env && !strcmp(env, "replicate"))
+      return NUMA_REPLICATE;
+    if (env && !strcmp(env, "interleave"))
+      return NUMA_INTERLEAVE;
+    return NUMA_NONE;
+  }();
+  return policy;
+}
+
+static int getCurrentNUMANode() {
+  unsigned int cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= MAX_NUMA_NODES)
+    return 0;
+  return node;
+}
+
+// Copy the pool into fresh pages shared by all the calls. Unless they are
+// interleaved, the pages are placed on the node of the thread first touching
+// them, which is the calling thread.
+static void *createSharedConstPool(size_t size, bool interleave) {
+  void *buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer == MAP_FAILED) {
+    fprintf(stderr, "Cannot map memory for the constant pack.");
+    exit(1);
+  }
+  if (interleave) {
+    unsigned long nodeMask = 0;
+    char path[64];
+    for (int node = 0; node < MAX_NUMA_NODES; node++) {
+      snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+      if (access(path, F_OK) == 0)
+        nodeMask |= 1UL << node;
+    }
+    // The placement is a hint: if it fails, the pages are simply placed on
+    // the calling node.
+    syscall(SYS_mbind, buffer, size, MPOL_INTERLEAVE, &nodeMask,
+        MAX_NUMA_NODES + 1, 0);
+  }
+  memcpy(buffer, &_binary_param_bin_start, size);
+  return buffer;
+}
+
+static void *loadEmbeddedConstPool(int64_t _) {
+  static std::atomic<void *> copies[MAX_NUMA_NODES];
+
   checkEndianness();
   auto size = (unsigned int)(&_binary_param_bin_end - &_binary_param_bin_start);
-  void *buffer = malloc(size);
-  memcpy(buffer, &_binary_param_bin_start, size);
+  auto policy = getNUMAPolicy();
+  if (policy == NUMA_NONE) {
+    void *buffer = malloc(size);
+    memcpy(buffer, &_binary_param_bin_start, size);
+    return buffer;
+  }
+
+  // The constants are never written, so the copies are shared by all the
+  // calls. Threads racing to create the same copy keep the first one.
+  auto &copy = copies[policy == NUMA_REPLICATE ? getCurrentNUMANode() : 0];
+  void *buffer = copy.load(std::memory_order_acquire);
+  if (buffer)
+    return buffer;
+  void *newBuffer = createSharedConstPool(size, policy == NUMA_INTERLEAVE);
+  if (copy.compare_exchange_strong(buffer, newBuffer))
+    return newBuffer;
+  munmap(newBuffer, size);
   return buffer;
 }
 
@@ -64,7 +144,7 @@ void *getEmbeddedConstPool(int64_t _) {
 extern char constPackFileName[];
 extern int64_t constPackFileNameStrLen;
 
-void *getEmbeddedConstPool(int64_t _) {
+static void *loadEmbeddedConstPool(int64_t _) {
   checkEndianness();
   char *fname = (char *)calloc(1, constPackFileNameStrLen + 1);
   memcpy(fname, constPackFileName, constPackFileNameStrLen);
@@ -85,4 +165,16 @@ void *getEmbeddedConstPool(int64_t _) {
 
   return (void *)buffer;
 }
-#endif
\ No newline at end of file
+#endif
+
+// The functions of a model read the pool loaded by the entry point running
+// on the same thread, so that entry points running concurrently on threads
+// of different NUMA nodes each read the replica of their node.
+static thread_local void *threadConstPool = nullptr;
+
+void *getEmbeddedConstPool(int64_t size_in_byte) {
+  threadConstPool = loadEmbeddedConstPool(size_in_byte);
+  return threadConstPool;
+}
+
+void *getThreadConstPool() { return threadConstPool; }
@@ -14,5 +14,9 @@
 #include <stdint.h>
 
 extern "C" {
+// Load the constant pool and record it as the pool of the calling thread.
 void *getEmbeddedConstPool(int64_t size_in_byte);
+
+// Return the constant pool last loaded by the calling thread.
+void *getThreadConstPool();
 }
\ No newline at end of file
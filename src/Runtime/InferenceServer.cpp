@@ -0,0 +1,655 @@
+//===-------- InferenceServer.cpp - InferenceServer Implementation --------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of InferenceServer and InferenceClient
+// classes, which serve compiled models to co-located clients over a Unix
+// domain socket and a ring of shared memory.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "InferenceServer.hpp"
+
+namespace onnx_mlir {
+
+namespace {
+
+// Tensors are placed in the ring at this alignment.
+const size_t kTensorAlignment = 64;
+
+size_t alignTensor(size_t offset) {
+  return (offset + kTensorAlignment - 1) & ~(kTensorAlignment - 1);
+}
+
+void throwSystemError(const std::string &what) {
+  throw std::runtime_error(what + ": " + strerror(errno));
+}
+
+bool readFully(int socket, void *buffer, size_t size) {
+  auto *bytes = (char *)buffer;
+  while (size > 0) {
+    ssize_t count = recv(socket, bytes, size, 0);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+bool writeFully(int socket, const void *buffer, size_t size) {
+  auto *bytes = (const char *)buffer;
+  while (size > 0) {
+    ssize_t count = send(socket, bytes, size, MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+// Read a message, i.e. its number of words followed by its words.
+bool readMessage(int socket, std::vector<int64_t> &message) {
+  int64_t numWords;
+  if (!readFully(socket, &numWords, sizeof(numWords)) || numWords < 0)
+    return false;
+  message.resize(numWords);
+  return readFully(socket, message.data(), numWords * sizeof(int64_t));
+}
+
+bool writeMessage(int socket, const std::vector<int64_t> &message) {
+  int64_t numWords = message.size();
+  return writeFully(socket, &numWords, sizeof(numWords)) &&
+         writeFully(socket, message.data(), numWords * sizeof(int64_t));
+}
+
+// Append bytes to a message as their size followed by the words holding
+// them.
+void appendBytes(std::vector<int64_t> &message, const char *bytes, size_t size) {
+  message.emplace_back(size);
+  size_t begin = message.size();
+  message.resize(begin + (size + sizeof(int64_t) - 1) / sizeof(int64_t), 0);
+  if (size > 0)
+    memcpy(message.data() + begin, bytes, size);
+}
+
+// Reads the words of a message, failing on messages shorter than expected.
+class MessageReader {
+public:
+  explicit MessageReader(const std::vector<int64_t> &message)
+      : _message(message) {}
+
+  int64_t next() {
+    if (_position >= _message.size())
+      throw std::runtime_error("Truncated message");
+    return _message[_position++];
+  }
+
+  // Return the bytes appended by appendBytes, which stay in the message.
+  const char *nextBytes(size_t &size) {
+    int64_t byteSize = next();
+    size_t numWords = (byteSize + sizeof(int64_t) - 1) / sizeof(int64_t);
+    if (byteSize < 0 || numWords > _message.size() - _position)
+      throw std::runtime_error("Truncated message");
+    auto *bytes = (const char *)(_message.data() + _position);
+    _position += numWords;
+    size = byteSize;
+    return bytes;
+  }
+
+  std::string nextString() {
+    size_t size;
+    const char *bytes = nextBytes(size);
+    return std::string(bytes, size);
+  }
+
+  // Read the element size, rank and dimensions of a tensor.
+  ServedTensor nextTensor() {
+    ServedTensor tensor;
+    tensor.elementSize = next();
+    int64_t rank = next();
+    if (tensor.elementSize <= 0 || rank < 0 ||
+        (size_t)rank > _message.size() - _position)
+      throw std::runtime_error("Invalid tensor");
+    for (int64_t d = 0; d < rank; d++) {
+      tensor.dims.emplace_back(next());
+      if (tensor.dims.back() < 0)
+        throw std::runtime_error("Invalid tensor");
+    }
+    return tensor;
+  }
+
+private:
+  const std::vector<int64_t> &_message;
+  size_t _position = 0;
+};
+
+void appendTensor(std::vector<int64_t> &message, int64_t offset,
+    const ServedTensor &tensor) {
+  message.emplace_back(offset);
+  message.emplace_back(tensor.elementSize);
+  message.emplace_back(tensor.dims.size());
+  message.insert(message.end(), tensor.dims.begin(), tensor.dims.end());
+}
+
+// Throw if an input of a request does not match the signature of the model
+// for that input: the model reads it in place with the element size, rank
+// and static dimensions it was compiled for.
+void checkInput(const ServedTensor &tensor,
+    const ExecutionSession::TensorSignature &signature, int64_t index) {
+  auto input = "Input " + std::to_string(index);
+  if (tensor.elementSize != signature.elementSize)
+    throw std::runtime_error(input + " has elements of " +
+                             std::to_string(tensor.elementSize) +
+                             " bytes, expected " +
+                             std::to_string(signature.elementSize));
+  if (tensor.dims.size() != signature.dims.size())
+    throw std::runtime_error(input + " has rank " +
+                             std::to_string(tensor.dims.size()) +
+                             ", expected " +
+                             std::to_string(signature.dims.size()));
+  for (size_t d = 0; d < tensor.dims.size(); d++)
+    if (signature.dims[d] >= 0 && tensor.dims[d] != signature.dims[d])
+      throw std::runtime_error(input + " has dimension " + std::to_string(d) +
+                               " of " + std::to_string(tensor.dims[d]) +
+                               ", expected " +
+                               std::to_string(signature.dims[d]));
+}
+
+// Return whether a tensor holds at most `limit` bytes, without overflowing.
+bool fitsIn(const ServedTensor &tensor, int64_t limit) {
+  int64_t size = tensor.elementSize;
+  if (size > limit)
+    return false;
+  for (auto dim : tensor.dims) {
+    if (dim == 0)
+      return true;
+    if (size > limit / dim)
+      return false;
+    size *= dim;
+  }
+  return true;
+}
+
+// Map a ring of shared memory from its file descriptor.
+char *mapRing(int fd, size_t size) {
+  void *ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ring == MAP_FAILED)
+    throwSystemError("Cannot map the ring");
+  return (char *)ring;
+}
+} // namespace
+
+int64_t ServedTensor::sizeInBytes() const {
+  return std::accumulate(dims.begin(), dims.end(), elementSize,
+      std::multiplies<int64_t>());
+}
+
+InferenceServer::Connection::~Connection() {
+  if (ring)
+    munmap(ring, ringSize);
+  // The socket is forgotten by the server before it is closed, so that stop
+  // does not shut down a socket reusing its descriptor.
+  if (server) {
+    std::lock_guard<std::mutex> lock(server->_connectionsMutex);
+    auto &sockets = server->_connectionSockets;
+    sockets.erase(
+        std::remove(sockets.begin(), sockets.end(), socket), sockets.end());
+  }
+  close(socket);
+}
+
+InferenceServer::InferenceServer(
+    const std::map<std::string, std::string> &models, std::string socketPath,
+    size_t ringSize, ThreadingConfig config)
+    : _socketPath(socketPath), _ringSize(alignTensor(ringSize)) {
+  size_t numWorkers = config.coreGroups.size();
+  if (numWorkers == 0)
+    numWorkers = std::max(1u, std::thread::hardware_concurrency());
+  _sessions.resize(numWorkers);
+  for (auto &sessions : _sessions)
+    for (auto &model : models) {
+      auto session = std::make_unique<ExecutionSession>(
+          model.second, "_dyn_entry_point_main_graph");
+      session->warmup();
+      sessions[model.first] = std::move(session);
+    }
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path too long: " + socketPath);
+  strcpy(address.sun_path, socketPath.c_str());
+  _listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (_listenSocket < 0)
+    throwSystemError("Cannot create socket");
+  unlink(socketPath.c_str());
+  if (bind(_listenSocket, (sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(_listenSocket, SOMAXCONN) != 0) {
+    close(_listenSocket);
+    throwSystemError("Cannot listen on " + socketPath);
+  }
+
+  for (size_t i = 0; i < numWorkers; i++)
+    _workers.emplace_back(&InferenceServer::runWorker, this, i,
+        i < config.coreGroups.size() ? config.coreGroups[i]
+                                     : std::vector<int>());
+}
+
+void InferenceServer::serve() {
+  while (true) {
+    int socket = accept(_listenSocket, nullptr, nullptr);
+    if (socket < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      // The listening socket was shut down by stop.
+      return;
+    }
+
+    // Every connection gets a ring of its own, whose file descriptor is
+    // passed to the client with its size.
+    auto connection = std::make_shared<Connection>();
+    connection->socket = socket;
+    connection->ringSize = _ringSize;
+    int fd = syscall(SYS_memfd_create, "onnx-mlir-serve", 0);
+    if (fd < 0 || ftruncate(fd, _ringSize) != 0) {
+      if (fd >= 0)
+        close(fd);
+      continue;
+    }
+    try {
+      connection->ring = mapRing(fd, _ringSize);
+    } catch (const std::exception &) {
+      close(fd);
+      continue;
+    }
+    int64_t ringSize = _ringSize;
+    iovec data = {&ringSize, sizeof(ringSize)};
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr header = {};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    cmsghdr *fdMessage = CMSG_FIRSTHDR(&header);
+    fdMessage->cmsg_level = SOL_SOCKET;
+    fdMessage->cmsg_type = SCM_RIGHTS;
+    fdMessage->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(fdMessage), &fd, sizeof(int));
+    bool sent = sendmsg(socket, &header, MSG_NOSIGNAL) == sizeof(ringSize);
+    close(fd);
+    if (!sent)
+      continue;
+
+    joinFinishedConnections();
+    std::lock_guard<std::mutex> lock(_connectionsMutex);
+    if (_stopping)
+      return;
+    connection->server = this;
+    _connectionSockets.emplace_back(socket);
+    int64_t id = _nextConnectionId++;
+    _connectionThreads[id] = std::thread(
+        &InferenceServer::serveConnection, this, std::move(connection), id);
+  }
+}
+
+void InferenceServer::serveConnection(
+    std::shared_ptr<Connection> connection, int64_t id) {
+  std::vector<int64_t> message;
+  while (readMessage(connection->socket, message)) {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    if (_stopping)
+      break;
+    _queue.emplace_back(Request{connection, std::move(message)});
+    _queueCondition.notify_one();
+  }
+
+  // The connection is released before the thread is marked as ended, since
+  // closing it takes the connections mutex.
+  connection.reset();
+  std::lock_guard<std::mutex> lock(_connectionsMutex);
+  _finishedConnections.emplace_back(id);
+}
+
+void InferenceServer::joinFinishedConnections() {
+  std::vector<std::thread> finished;
+  {
+    std::lock_guard<std::mutex> lock(_connectionsMutex);
+    for (auto id : _finishedConnections) {
+      finished.emplace_back(std::move(_connectionThreads[id]));
+      _connectionThreads.erase(id);
+    }
+    _finishedConnections.clear();
+  }
+  for (auto &thread : finished)
+    thread.join();
+}
+
+void InferenceServer::runWorker(size_t worker, std::vector<int> cores) {
+  if (!cores.empty())
+    ThreadingConfig::pinCurrentThread(cores);
+  while (true) {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(_queueMutex);
+      _queueCondition.wait(
+          lock, [this]() { return _stopping || !_queue.empty(); });
+      if (_stopping)
+        return;
+      request = std::move(_queue.front());
+      _queue.pop_front();
+    }
+    auto response = process(request, _sessions[worker]);
+    auto &connection = *request.connection;
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    writeMessage(connection.socket, response);
+  }
+}
+
+std::vector<int64_t> InferenceServer::process(const Request &request,
+    std::map<std::string, std::unique_ptr<ExecutionSession>> &sessions) {
+  auto &connection = *request.connection;
+  std::vector<int64_t> response;
+  int64_t id = request.message.empty() ? -1 : request.message[0];
+  try {
+    MessageReader reader(request.message);
+    reader.next();
+    int64_t regionOffset = reader.next();
+    int64_t regionSize = reader.next();
+    if (regionOffset < 0 || regionSize < 0 ||
+        (size_t)regionOffset > connection.ringSize ||
+        (size_t)regionSize > connection.ringSize - regionOffset)
+      throw std::runtime_error("Invalid region");
+    int64_t regionEnd = regionOffset + regionSize;
+    auto model = reader.nextString();
+    auto sessionIt = sessions.find(model);
+    if (sessionIt == sessions.end())
+      throw std::runtime_error("Unknown model: " + model);
+    auto &session = *sessionIt->second;
+
+    // The inputs must match the signature of the model and the bounds of its
+    // dimensions before the model reads them.
+    auto signature = session.getInputSignature();
+    if (signature.empty())
+      throw std::runtime_error(
+          "Model does not export the signature of its inputs: " + model);
+    int64_t numInputs = reader.next();
+    if (numInputs != (int64_t)signature.size())
+      throw std::runtime_error("Model " + model + " takes " +
+                               std::to_string(signature.size()) +
+                               " inputs, got " + std::to_string(numInputs));
+
+    // The model reads the inputs in place, from buffers it does not own.
+    std::vector<std::unique_ptr<DynMemRef>> ins;
+    for (int64_t i = 0; i < numInputs; i++) {
+      int64_t offset = reader.next();
+      auto tensor = reader.nextTensor();
+      checkInput(tensor, signature[i], i);
+      session.checkInputBounds(i, tensor.dims);
+      if (offset < regionOffset || offset > regionEnd ||
+          !fitsIn(tensor, regionEnd - offset))
+        throw std::runtime_error(
+            "Input " + std::to_string(i) + " is outside of its region");
+      auto *input = new DynMemRef(tensor.dims.size());
+      input->data = nullptr;
+      input->alignedData = connection.ring + offset;
+      input->offset = 0;
+      std::copy(tensor.dims.begin(), tensor.dims.end(), input->sizes);
+      auto strides = input->computeStridesFromSizes();
+      std::copy(strides.begin(), strides.end(), input->strides);
+      ins.emplace_back(input);
+    }
+
+    auto outs = session.run(std::move(ins));
+    auto &elementSizes = session.getOutputElementSizes();
+    if (elementSizes.size() != outs.size())
+      throw std::runtime_error(
+          "Model does not export the signature of its outputs: " + model);
+
+    // Outputs are written back into the region of the request when they fit,
+    // and are sent with the response otherwise. Outputs computed in place
+    // into the inputs are first moved out of the ring, so that writing the
+    // other outputs does not overwrite them.
+    response = {id, 0, (int64_t)outs.size()};
+    std::vector<char> inlineData;
+    std::vector<std::vector<char>> ringOutputs(outs.size());
+    std::vector<ServedTensor> tensors(outs.size());
+    for (size_t i = 0; i < outs.size(); i++) {
+      auto &tensor = tensors[i];
+      tensor.elementSize = elementSizes[i];
+      tensor.dims.assign(outs[i]->sizes, outs[i]->sizes + outs[i]->rank);
+      tensor.data =
+          (char *)outs[i]->alignedData + outs[i]->offset * tensor.elementSize;
+      if (tensor.data >= connection.ring &&
+          tensor.data < connection.ring + connection.ringSize) {
+        ringOutputs[i].assign(
+            tensor.data, tensor.data + tensor.sizeInBytes());
+        tensor.data = ringOutputs[i].data();
+      }
+    }
+    size_t cursor = regionOffset;
+    for (auto &tensor : tensors) {
+      size_t size = tensor.sizeInBytes();
+      auto *data = tensor.data;
+      size_t offset = alignTensor(cursor);
+      if (offset <= (size_t)regionEnd && size <= regionEnd - offset) {
+        memcpy(connection.ring + offset, data, size);
+        cursor = offset + size;
+        appendTensor(response, offset, tensor);
+      } else {
+        inlineData.insert(inlineData.end(), data, data + size);
+        appendTensor(response, -1, tensor);
+      }
+    }
+    appendBytes(response, inlineData.data(), inlineData.size());
+  } catch (const std::exception &error) {
+    response = {id, 1};
+    appendBytes(response, error.what(), strlen(error.what()));
+  }
+  return response;
+}
+
+void InferenceServer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    _stopping = true;
+    _queueCondition.notify_all();
+  }
+  // Unblock the threads waiting on the sockets.
+  shutdown(_listenSocket, SHUT_RDWR);
+  std::lock_guard<std::mutex> lock(_connectionsMutex);
+  for (int socket : _connectionSockets)
+    shutdown(socket, SHUT_RDWR);
+}
+
+InferenceServer::~InferenceServer() {
+  stop();
+  for (auto &thread : _workers)
+    thread.join();
+  for (auto &connection : _connectionThreads)
+    connection.second.join();
+  // Requests left in the queue hold their connection, which is closed with
+  // the connections mutex.
+  _queue.clear();
+  close(_listenSocket);
+  unlink(_socketPath.c_str());
+}
+
+InferenceClient::InferenceClient(const std::string &socketPath) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path too long: " + socketPath);
+  strcpy(address.sun_path, socketPath.c_str());
+  _socket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (_socket < 0)
+    throwSystemError("Cannot create socket");
+  if (connect(_socket, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(_socket);
+    throwSystemError("Cannot connect to " + socketPath);
+  }
+
+  // The server sends the size of the ring along with its file descriptor.
+  int64_t ringSize = 0;
+  iovec data = {&ringSize, sizeof(ringSize)};
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr header = {};
+  header.msg_iov = &data;
+  header.msg_iovlen = 1;
+  header.msg_control = control;
+  header.msg_controllen = sizeof(control);
+  cmsghdr *fdMessage = nullptr;
+  if (recvmsg(_socket, &header, 0) == sizeof(ringSize))
+    fdMessage = CMSG_FIRSTHDR(&header);
+  if (!fdMessage || fdMessage->cmsg_type != SCM_RIGHTS) {
+    close(_socket);
+    throw std::runtime_error("No ring received from " + socketPath);
+  }
+  int fd;
+  memcpy(&fd, CMSG_DATA(fdMessage), sizeof(int));
+  _ringSize = ringSize;
+  try {
+    _ring = mapRing(fd, _ringSize);
+  } catch (const std::exception &) {
+    close(fd);
+    close(_socket);
+    throw;
+  }
+  close(fd);
+}
+
+char *InferenceClient::reserve(size_t size) {
+  size = alignTensor(std::max<size_t>(size, 1));
+  // An unsubmitted region is replaced by the new one.
+  if (!_regions.empty() && _regions.back().id < 0) {
+    _head = _regions.back().offset;
+    _regions.pop_back();
+  }
+  if (_regions.empty())
+    _head = 0;
+
+  // The live regions span from the oldest one to the head, possibly
+  // wrapping around the end of the ring.
+  size_t tail = _regions.empty() ? 0 : _regions.front().offset;
+  size_t offset;
+  if (_regions.empty() || _head > tail) {
+    if (size <= _ringSize - _head)
+      offset = _head;
+    else if (size <= tail)
+      offset = 0;
+    else
+      return nullptr;
+  } else if (size <= tail - _head) {
+    offset = _head;
+  } else {
+    return nullptr;
+  }
+  _regions.emplace_back(Region{-1, offset, size, false});
+  _head = offset + size;
+  return _ring + offset;
+}
+
+int64_t InferenceClient::submit(
+    const std::string &model, const std::vector<ServedTensor> &inputs) {
+  if (_regions.empty() || _regions.back().id >= 0)
+    throw std::runtime_error("No region reserved for the request");
+  auto &region = _regions.back();
+  region.id = _nextId++;
+  std::vector<int64_t> message = {
+      region.id, (int64_t)region.offset, (int64_t)region.size};
+  appendBytes(message, model.data(), model.size());
+  message.emplace_back(inputs.size());
+  for (auto &input : inputs)
+    appendTensor(message, input.data - _ring, input);
+  if (!writeMessage(_socket, message))
+    throwSystemError("Cannot send the request");
+  return region.id;
+}
+
+ServedResponse InferenceClient::receive() {
+  ServedResponse response;
+  std::vector<int64_t> message;
+  if (!readMessage(_socket, message))
+    throw std::runtime_error("Connection closed by the server");
+  MessageReader reader(message);
+  response.id = reader.next();
+  if (reader.next() != 0) {
+    response.error = reader.nextString();
+    return response;
+  }
+  std::vector<int64_t> offsets;
+  int64_t numOutputs = reader.next();
+  for (int64_t i = 0; i < numOutputs; i++) {
+    offsets.emplace_back(reader.next());
+    response.outputs.emplace_back(reader.nextTensor());
+  }
+  size_t inlineSize;
+  const char *inlineBytes = reader.nextBytes(inlineSize);
+  response.inlineData.resize(
+      (inlineSize + sizeof(int64_t) - 1) / sizeof(int64_t));
+  if (inlineSize > 0)
+    memcpy(response.inlineData.data(), inlineBytes, inlineSize);
+  size_t inlineOffset = 0;
+  for (int64_t i = 0; i < numOutputs; i++) {
+    auto &output = response.outputs[i];
+    if (offsets[i] >= 0) {
+      output.data = _ring + offsets[i];
+    } else {
+      output.data = (char *)response.inlineData.data() + inlineOffset;
+      inlineOffset += output.sizeInBytes();
+    }
+  }
+  return response;
+}
+
+void InferenceClient::release(int64_t id) {
+  for (auto &region : _regions)
+    if (region.id == id)
+      region.released = true;
+  while (!_regions.empty() && _regions.front().released)
+    _regions.pop_front();
+}
+
+ServedResponse InferenceClient::run(const std::string &model,
+    const std::vector<ServedTensor> &inputs, size_t outputSize) {
+  size_t size = outputSize;
+  for (auto &input : inputs)
+    size += alignTensor(input.sizeInBytes());
+  char *region = reserve(size);
+  if (!region)
+    throw std::runtime_error("No room left in the ring");
+  std::vector<ServedTensor> ringInputs;
+  for (auto &input : inputs) {
+    ringInputs.emplace_back(input);
+    ringInputs.back().data = region;
+    memcpy(region, input.data, input.sizeInBytes());
+    region += alignTensor(input.sizeInBytes());
+  }
+  submit(model, ringInputs);
+  return receive();
+}
+
+InferenceClient::~InferenceClient() {
+  if (_ring)
+    munmap(_ring, _ringSize);
+  close(_socket);
+}
+} // namespace onnx_mlir
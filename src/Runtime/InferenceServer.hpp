@@ -0,0 +1,197 @@
+//===--------- InferenceServer.hpp - InferenceServer Declaration ----------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of InferenceServer class, which serves
+// compiled models to co-located clients over a Unix domain socket, and of
+// InferenceClient class, which connects to it.
+//
+// The tensors of the requests and responses travel through a ring of shared
+// memory that the server maps for every connection and passes to the client
+// with the socket. The client writes the inputs of a request into a region
+// of the ring, which the model reads in place, and the server writes the
+// outputs back into the same region when they fit. Only the descriptions of
+// the tensors go through the socket:
+//
+//  request:  id, region offset, region size, model name, number of inputs,
+//            and the ring offset, element size, rank and dimensions of every
+//            input;
+//  response: id, status, then either an error message or the number of
+//            outputs, the ring offset (-1 when sent with the response),
+//            element size, rank and dimensions of every output, followed by
+//            the size and the bytes of the outputs sent with the response.
+//
+// Every message is a sequence of int64_t words preceded by its number of
+// words; strings are their length followed by their bytes padded to a word.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/Runtime/ExecusionSession.hpp"
+#include "src/Runtime/ThreadingConfig.hpp"
+
+namespace onnx_mlir {
+
+// A tensor of a request or response: its data, the size of its elements in
+// bytes and its dimensions, in row major order.
+struct ServedTensor {
+  char *data = nullptr;
+  int64_t elementSize = 0;
+  std::vector<int64_t> dims;
+
+  int64_t sizeInBytes() const;
+};
+
+class InferenceServer {
+public:
+  // Load the models, given by name, once per worker. Workers are pinned to
+  // the core groups of the threading configuration, one worker per group,
+  // or are as many as the cores when no group is configured. Every
+  // connection gets a ring of `ringSize` bytes.
+  InferenceServer(const std::map<std::string, std::string> &models,
+      std::string socketPath, size_t ringSize = 64 << 20,
+      ThreadingConfig config = ThreadingConfig::fromEnvironment());
+
+  // Accept connections and serve their requests until stop is called.
+  void serve();
+
+  // Stop accepting connections and serving requests; may be called from any
+  // thread.
+  void stop();
+
+  size_t numWorkers() const { return _workers.size(); }
+
+  ~InferenceServer();
+
+protected:
+  // A connected client and the ring shared with it. The connection is closed
+  // once neither its thread nor a worker holds it anymore.
+  struct Connection {
+    InferenceServer *server = nullptr;
+    int socket = -1;
+    char *ring = nullptr;
+    size_t ringSize = 0;
+    // Serializes the responses written by the workers.
+    std::mutex writeMutex;
+
+    ~Connection();
+  };
+
+  // A request read from a connection, waiting for a worker.
+  struct Request {
+    std::shared_ptr<Connection> connection;
+    std::vector<int64_t> message;
+  };
+
+  void serveConnection(std::shared_ptr<Connection> connection, int64_t id);
+
+  // Join the threads of the connections that ended.
+  void joinFinishedConnections();
+
+  void runWorker(size_t worker, std::vector<int> cores);
+
+  // Run a request on the sessions of a worker and build its response, which
+  // is an error if the inputs do not match the signature of the model.
+  std::vector<int64_t> process(const Request &request,
+      std::map<std::string, std::unique_ptr<ExecutionSession>> &sessions);
+
+  std::string _socketPath;
+  int _listenSocket = -1;
+  size_t _ringSize;
+
+  // Sessions of every worker, by model name. A session is only run by its
+  // worker.
+  std::vector<std::map<std::string, std::unique_ptr<ExecutionSession>>>
+      _sessions;
+  std::vector<std::thread> _workers;
+
+  // Requests waiting for a worker, in arrival order.
+  std::mutex _queueMutex;
+  std::condition_variable _queueCondition;
+  std::deque<Request> _queue;
+
+  // Set by stop, under the queue mutex so that no worker misses it.
+  std::atomic<bool> _stopping{false};
+
+  // Sockets of the connections open, and the threads of the connections by
+  // id, along with the ids of those whose thread ended and is to be joined.
+  std::mutex _connectionsMutex;
+  std::vector<int> _connectionSockets;
+  std::map<int64_t, std::thread> _connectionThreads;
+  std::vector<int64_t> _finishedConnections;
+  int64_t _nextConnectionId = 0;
+};
+
+// A response of the server. The outputs written in the ring remain valid
+// until the request is released; the others are held by the response.
+struct ServedResponse {
+  int64_t id = -1;
+  std::string error;
+  std::vector<ServedTensor> outputs;
+  std::vector<int64_t> inlineData;
+};
+
+class InferenceClient {
+public:
+  explicit InferenceClient(const std::string &socketPath);
+
+  // A client owns its connection and ring, so it cannot be copied.
+  InferenceClient(const InferenceClient &) = delete;
+  InferenceClient &operator=(const InferenceClient &) = delete;
+
+  // Reserve a region of `size` bytes of the ring for the next request, in
+  // which the caller writes its inputs and the server its outputs. Returns
+  // nullptr if the ring has no room left until requests are released.
+  char *reserve(size_t size);
+
+  // Submit a request running `model` on inputs written in the region last
+  // reserved, and return its id. Several requests may be in flight.
+  int64_t submit(
+      const std::string &model, const std::vector<ServedTensor> &inputs);
+
+  // Wait for the next response; requests may complete out of order.
+  ServedResponse receive();
+
+  // Give the region of a request back to the ring once its response was
+  // read.
+  void release(int64_t id);
+
+  // Copy the inputs into a region of the ring with room for `outputSize`
+  // bytes of outputs, and wait for the response, while no other request is
+  // in flight. The request must be released by the caller.
+  ServedResponse run(const std::string &model,
+      const std::vector<ServedTensor> &inputs, size_t outputSize);
+
+  ~InferenceClient();
+
+protected:
+  // A region of the ring, in allocation order; its id is -1 until the
+  // request is submitted.
+  struct Region {
+    int64_t id;
+    size_t offset;
+    size_t size;
+    bool released;
+  };
+
+  int _socket = -1;
+  char *_ring = nullptr;
+  size_t _ringSize = 0;
+  int64_t _nextId = 0;
+  std::deque<Region> _regions;
+  size_t _head = 0;
+};
+} // namespace onnx_mlir
@@ -0,0 +1,105 @@
+//===------------- Kernels.cpp - Runtime Kernel Library -------------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementations of the kernels of the runtime kernel
+// library, as templates over their element type and tile sizes, and their
+// instantiations exported to the generated code.
+//
+// The kernels are written so that the compiler vectorizes them: their tile
+// sizes are compile time constants, and their inner loops are branch free.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+
+#include "Kernels.h"
+
+namespace {
+
+// Transpose by square tiles of Tile x Tile elements, so that both the rows
+// read and the rows written by a tile stay in the cache.
+template <typename T, int64_t Tile>
+inline void transpose2D(const T *in, T *out, int64_t rows, int64_t cols) {
+  static_assert(Tile > 0, "tile size must be positive");
+  for (int64_t i0 = 0; i0 < rows; i0 += Tile) {
+    int64_t iEnd = std::min(i0 + Tile, rows);
+    for (int64_t j0 = 0; j0 < cols; j0 += Tile) {
+      int64_t jEnd = std::min(j0 + Tile, cols);
+      if (iEnd - i0 == Tile && jEnd - j0 == Tile) {
+        // Full tiles have constant trip counts.
+        for (int64_t i = 0; i < Tile; ++i)
+          for (int64_t j = 0; j < Tile; ++j)
+            out[(j0 + j) * rows + i0 + i] = in[(i0 + i) * cols + j0 + j];
+        continue;
+      }
+      for (int64_t i = i0; i < iEnd; ++i)
+        for (int64_t j = j0; j < jEnd; ++j)
+          out[j * rows + i] = in[i * cols + j];
+    }
+  }
+}
+
+// Exponential of a float: exp(x) = 2^n * exp(r), with n = round(x / ln(2))
+// and |r| <= ln(2) / 2, exp(r) being approximated by its Taylor polynomial.
+// Like std::exp, it returns NaN for NaN, infinity when the result overflows
+// and 0 when it underflows, and denormals for results below FLT_MIN.
+inline float expF32(float x) {
+  constexpr float log2e = 1.44269504088896341f;
+  constexpr float ln2Hi = 0.693359375f;
+  constexpr float ln2Lo = -2.12194440e-4f;
+  // Beyond these bounds, the result is infinity or rounds to 0, so n fits
+  // in [-150, 128]. The constant comes first so that NaN is clamped too.
+  float clamped = std::min(89.f, std::max(-104.f, x));
+  float n = static_cast<float>(static_cast<int32_t>(
+      clamped * log2e + (clamped >= 0 ? 0.5f : -0.5f)));
+  float r = clamped - n * ln2Hi - n * ln2Lo;
+  float p = 1.f / 720;
+  p = p * r + 1.f / 120;
+  p = p * r + 1.f / 24;
+  p = p * r + 1.f / 6;
+  p = p * r + 0.5f;
+  p = p * r + 1.f;
+  p = p * r + 1.f;
+  // Scale by 2^n in two steps, by powers of two that are normal floats, so
+  // that the product overflows to infinity or rounds to a denormal.
+  int32_t n1 = static_cast<int32_t>(n) >> 1;
+  int32_t n2 = static_cast<int32_t>(n) - n1;
+  float scale1, scale2;
+  int32_t bits1 = (n1 + 127) << 23;
+  int32_t bits2 = (n2 + 127) << 23;
+  std::memcpy(&scale1, &bits1, sizeof(scale1));
+  std::memcpy(&scale2, &bits2, sizeof(scale2));
+  p = p * scale1 * scale2;
+  return x != x ? x : p;
+}
+
+} // namespace
+
+void omKernelTranspose2DF32(
+    const float *in, float *out, int64_t rows, int64_t cols) {
+  transpose2D<float, 8>(in, out, rows, cols);
+}
+
+void omKernelTranspose2DF64(
+    const double *in, double *out, int64_t rows, int64_t cols) {
+  transpose2D<double, 4>(in, out, rows, cols);
+}
+
+void omKernelTranspose2DI32(
+    const int32_t *in, int32_t *out, int64_t rows, int64_t cols) {
+  transpose2D<int32_t, 8>(in, out, rows, cols);
+}
+
+void omKernelTranspose2DI64(
+    const int64_t *in, int64_t *out, int64_t rows, int64_t cols) {
+  transpose2D<int64_t, 4>(in, out, rows, cols);
+}
+
+void omKernelExpF32(const float *in, float *out, int64_t n) {
+  for (int64_t i = 0; i < n; ++i)
+    out[i] = expF32(in[i]);
+}
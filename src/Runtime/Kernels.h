@@ -0,0 +1,45 @@
+//===-------------- Kernels.h - Runtime Kernel Library --------------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the declarations of the kernels of the runtime kernel
+// library. They are hand-written C++ templates, instantiated for common tile
+// sizes and element types, which the lowering of some operations calls
+// through krnl.call_kernel instead of generating loop nests. The library is
+// also compiled to LLVM bitcode, which the compiler links into the models
+// calling its kernels so that they are inlined and specialized.
+//
+// Buffers are passed as pointers to their first element, in row major order.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Transpose the rows x cols matrix `in` into the cols x rows matrix `out`.
+void omKernelTranspose2DF32(
+    const float *in, float *out, int64_t rows, int64_t cols);
+void omKernelTranspose2DF64(
+    const double *in, double *out, int64_t rows, int64_t cols);
+void omKernelTranspose2DI32(
+    const int32_t *in, int32_t *out, int64_t rows, int64_t cols);
+void omKernelTranspose2DI64(
+    const int64_t *in, int64_t *out, int64_t rows, int64_t cols);
+
+// Compute the exponential of the `n` elements of `in` into `out`.
+void omKernelExpF32(const float *in, float *out, int64_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,85 @@
+//===---------- ModelRegistry.cpp - ModelRegistry Implementation ----------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of ModelRegistry class, which serves named
+// models and swaps in new versions of them without stopping the service.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdexcept>
+
+#include "ModelRegistry.hpp"
+
+namespace onnx_mlir {
+
+std::vector<std::unique_ptr<DynMemRef>> ServedModel::run(
+    std::vector<std::unique_ptr<DynMemRef>> ins) {
+  // The model allocates its buffers at every run, so runs only share the
+  // state of the session.
+  if (!_session->hasKVCaches())
+    return _session->run(std::move(ins));
+  std::lock_guard<std::mutex> lock(_runMutex);
+  return _session->run(std::move(ins));
+}
+
+void ModelRegistry::load(const std::string &name,
+    const std::string &sharedLibPath, const std::string &entryPointName,
+    bool donateInputs) {
+  std::lock_guard<std::mutex> loadLock(_loadMutex);
+
+  // Opening the path of a library still open would return that library
+  // instead of the new version.
+  auto &library = _libraries[sharedLibPath];
+  if (!library.expired())
+    throw std::runtime_error("Library " + sharedLibPath + " is still open");
+
+  // The new version is ready before it serves any request.
+  auto session = std::make_unique<ExecutionSession>(
+      sharedLibPath, entryPointName, donateInputs);
+  session->warmup();
+  auto model = std::make_shared<ServedModel>(std::move(session));
+  library = model;
+
+  // The previous version is released outside of the lock, since closing its
+  // library may take a while.
+  std::shared_ptr<ServedModel> previous;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    previous = std::move(_models[name]);
+    _models[name] = std::move(model);
+  }
+}
+
+std::future<void> ModelRegistry::loadAsync(const std::string &name,
+    const std::string &sharedLibPath, const std::string &entryPointName,
+    bool donateInputs) {
+  return std::async(std::launch::async,
+      [this, name, sharedLibPath, entryPointName, donateInputs]() {
+        load(name, sharedLibPath, entryPointName, donateInputs);
+      });
+}
+
+std::shared_ptr<ServedModel> ModelRegistry::get(
+    const std::string &name) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto model = _models.find(name);
+  if (model == _models.end())
+    throw std::runtime_error("No model loaded as " + name);
+  return model->second;
+}
+
+void ModelRegistry::unload(const std::string &name) {
+  std::shared_ptr<ServedModel> previous;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto model = _models.find(name);
+    if (model == _models.end())
+      return;
+    previous = std::move(model->second);
+    _models.erase(model);
+  }
+}
+} // namespace onnx_mlir
@@ -0,0 +1,87 @@
+//===----------- ModelRegistry.hpp - ModelRegistry Declaration ------------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of ModelRegistry class, which serves named
+// models and swaps in new versions of them without stopping the service.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/Runtime/ExecusionSession.hpp"
+
+namespace onnx_mlir {
+
+// A version of a model served by the registry. The requests sharing a version
+// run it concurrently, unless its session keeps state across runs, such as
+// key/value caches, in which case they run it one at a time.
+class ServedModel {
+public:
+  explicit ServedModel(std::unique_ptr<ExecutionSession> session)
+      : _session(std::move(session)) {}
+
+  // Run the model, once the requests ahead of this one are done with it if
+  // the session keeps state across runs.
+  std::vector<std::unique_ptr<DynMemRef>> run(
+      std::vector<std::unique_ptr<DynMemRef>> ins);
+
+  // The session of the model, for the queries that do not run it.
+  const ExecutionSession &getSession() const { return *_session; }
+
+protected:
+  // Serializes the runs of sessions keeping state across runs.
+  std::mutex _runMutex;
+  std::unique_ptr<ExecutionSession> _session;
+};
+
+class ModelRegistry {
+public:
+  // Load and warm up a model library, then make it the version served under
+  // `name`. Requests already holding the previous version finish on it, and
+  // its library is closed once the last of them releases it. Since a library
+  // that is still open cannot be loaded again, every version must be
+  // deployed under its own path.
+  void load(const std::string &name, const std::string &sharedLibPath,
+      const std::string &entryPointName = "_dyn_entry_point_main_graph",
+      bool donateInputs = false);
+
+  // Load a model in the background, while the current version keeps serving.
+  std::future<void> loadAsync(const std::string &name,
+      const std::string &sharedLibPath,
+      const std::string &entryPointName = "_dyn_entry_point_main_graph",
+      bool donateInputs = false);
+
+  // The version of the model currently served under `name`, which remains
+  // valid for as long as the caller holds it.
+  std::shared_ptr<ServedModel> get(const std::string &name) const;
+
+  // Run the version of the model currently served under `name`.
+  std::vector<std::unique_ptr<DynMemRef>> run(
+      const std::string &name, std::vector<std::unique_ptr<DynMemRef>> ins) {
+    return get(name)->run(std::move(ins));
+  }
+
+  // Stop serving the model; it is closed once no request holds it anymore.
+  void unload(const std::string &name);
+
+protected:
+  // Guards the models served.
+  mutable std::mutex _mutex;
+  std::map<std::string, std::shared_ptr<ServedModel>> _models;
+
+  // Serializes the loads, and tracks the libraries still open, whether they
+  // are served or only held by requests.
+  std::mutex _loadMutex;
+  std::map<std::string, std::weak_ptr<ServedModel>> _libraries;
+};
+} // namespace onnx_mlir
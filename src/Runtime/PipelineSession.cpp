@@ -0,0 +1,106 @@
+//===-------- PipelineSession.cpp - PipelineSession Implementation --------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of PipelineSession class, which runs the
+// stages of a model compiled with --pipeline-stages concurrently.
+//
+//===----------------------------------------------------------------------===//
+
+#include <sstream>
+#include <stdexcept>
+
+#include "PipelineSession.hpp"
+
+namespace onnx_mlir {
+
+PipelineSession::PipelineSession(
+    std::string sharedLibPath, ThreadingConfig config) {
+  // Partitioned models export the number of their stages.
+  void *handle = dlopen(sharedLibPath.c_str(), RTLD_LAZY);
+  if (!handle) {
+    std::stringstream errStr;
+    errStr << "Cannot open library: " << dlerror() << std::endl;
+    throw std::runtime_error(errStr.str());
+  }
+  auto *pipelineStages = (int64_t *)dlsym(handle, "pipelineStages");
+  dlerror();
+  int64_t numStages = pipelineStages ? *pipelineStages : 0;
+  dlclose(handle);
+  if (numStages < 1)
+    throw std::runtime_error(
+        "Library was not compiled with --pipeline-stages: " + sharedLibPath);
+
+  // The values passed between stages are owned by the pipeline, so every
+  // stage but the first may overwrite its inputs. The first stage only
+  // overwrites the inputs owning their buffer, and copies the others, which
+  // still belong to the caller.
+  for (int64_t i = 0; i < numStages; i++)
+    _stages.emplace_back(std::make_unique<ExecutionSession>(sharedLibPath,
+        "_dyn_entry_point_main_graph_stage" + std::to_string(i),
+        /*donateInputs=*/i > 0));
+  for (int64_t i = 0; i <= numStages; i++)
+    _queues.emplace_back(std::make_unique<SPSCQueue<std::unique_ptr<Request>>>(
+        config.queueDepth, config.spinDuration));
+
+  for (size_t i = 0; i < _stages.size(); i++)
+    _threads.emplace_back(&PipelineSession::runStage, this, i,
+        i < config.coreGroups.size() ? config.coreGroups[i]
+                                     : std::vector<int>());
+}
+
+void PipelineSession::runStage(size_t stage, std::vector<int> cores) {
+  if (!cores.empty())
+    ThreadingConfig::pinCurrentThread(cores);
+  auto &in = *_queues[stage];
+  auto &out = *_queues[stage + 1];
+  while (auto request = in.pop()) {
+    if (!request->error) {
+      try {
+        request->values = _stages[stage]->run(std::move(request->values));
+      } catch (...) {
+        request->values.clear();
+        request->error = std::current_exception();
+      }
+    }
+    out.push(std::move(request));
+  }
+  // Forward the stop request to the next stage.
+  if (stage + 1 < _stages.size())
+    out.push(nullptr);
+}
+
+void PipelineSession::push(std::vector<std::unique_ptr<DynMemRef>> ins) {
+  auto request = std::make_unique<Request>();
+  request->values = std::move(ins);
+  std::lock_guard<std::mutex> lock(_pushMutex);
+  _queues.front()->push(std::move(request));
+}
+
+std::vector<std::unique_ptr<DynMemRef>> PipelineSession::pop() {
+  std::unique_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(_popMutex);
+    request = _queues.back()->pop();
+  }
+  if (request->error)
+    std::rethrow_exception(request->error);
+  return std::move(request->values);
+}
+
+PipelineSession::~PipelineSession() {
+  _queues.front()->push(nullptr);
+  // Drain the completed requests that were not popped, so that the last
+  // stage never waits for room in its output queue.
+  std::thread drain([this]() {
+    while (_queues.back()->pop())
+      ;
+  });
+  for (auto &thread : _threads)
+    thread.join();
+  _queues.back()->push(nullptr);
+  drain.join();
+}
+} // namespace onnx_mlir
@@ -0,0 +1,74 @@
+//===--------- PipelineSession.hpp - PipelineSession Declaration ----------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of PipelineSession class, which runs the
+// stages of a model compiled with --pipeline-stages concurrently.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/Runtime/ExecusionSession.hpp"
+#include "src/Runtime/SPSCQueue.hpp"
+#include "src/Runtime/ThreadingConfig.hpp"
+
+namespace onnx_mlir {
+
+class PipelineSession {
+public:
+  // Every stage runs on its own thread, pinned to the cores of its group when
+  // core groups are configured. By default, the configuration is read from
+  // the environment.
+  PipelineSession(std::string sharedLibPath,
+      ThreadingConfig config = ThreadingConfig::fromEnvironment());
+
+  // Submit a request to the first stage; the inputs are consumed by the call.
+  // Inputs that do not own their buffer are copied before the first stage
+  // runs, since the stages overwrite their inputs. Concurrent calls are
+  // serialized, as the queue of the first stage has a single producer.
+  void push(std::vector<std::unique_ptr<DynMemRef>> ins);
+
+  // Wait for the outputs of the oldest request submitted. Requests complete
+  // in submission order; an error raised by a stage is rethrown here.
+  // Concurrent calls are serialized, as the queue of the completed requests
+  // has a single consumer.
+  std::vector<std::unique_ptr<DynMemRef>> pop();
+
+  size_t numStages() const { return _stages.size(); }
+
+  ~PipelineSession();
+
+protected:
+  // A request flowing through the stages: the values live between two
+  // stages, or the error that stopped it.
+  struct Request {
+    std::vector<std::unique_ptr<DynMemRef>> values;
+    std::exception_ptr error;
+  };
+
+  void runStage(size_t stage, std::vector<int> cores);
+
+  std::vector<std::unique_ptr<ExecutionSession>> _stages;
+
+  // Queue i feeds stage i, the last queue holds the completed requests. A
+  // null request stops the stages.
+  std::vector<std::unique_ptr<SPSCQueue<std::unique_ptr<Request>>>> _queues;
+
+  std::vector<std::thread> _threads;
+
+  // Serialize the producers of the first queue and the consumers of the
+  // last one.
+  std::mutex _pushMutex;
+  std::mutex _popMutex;
+};
+} // namespace onnx_mlir
@@ -16,22 +16,32 @@ namespace onnx_mlir {
 std::vector<py::array> PyExecutionSession::pyRun(
     std::vector<py::array> inputsPyArray) {
   assert(_entryPointFunc && "Entry point not loaded.");
+  // The buffers of the model are planned for inputs within their bounds.
+  for (size_t i = 0; i < inputsPyArray.size(); i++) {
+    const auto &inputPyArray = inputsPyArray[i];
+    checkInputBounds(i, std::vector<int64_t>(inputPyArray.shape(),
+                            inputPyArray.shape() + inputPyArray.ndim()));
+  }
+
   auto *wrappedInput = createOrderedDynMemRefDict();
+  std::vector<void *> copiedInputs;
   int inputIdx = 0;
   for (auto inputPyArray : inputsPyArray) {
     auto *inputDynMemRef = createDynMemRef(inputPyArray.ndim());
     assert(inputPyArray.flags() && py::array::c_style &&
            "Expect contiguous python array.");
 
-    if (inputPyArray.writeable()) {
+    if (inputPyArray.writeable() && !inputsNeedCopy()) {
       inputDynMemRef->data = inputPyArray.mutable_data();
       inputDynMemRef->alignedData = inputPyArray.mutable_data();
     } else {
-      // If data is not writable, copy them to a writable buffer.
+      // If data is not writable, or if the model may overwrite it while the
+      // caller did not donate it, copy them to a writable buffer.
       auto *copiedData = (float *)malloc(inputPyArray.nbytes());
       memcpy(copiedData, inputPyArray.data(), inputPyArray.nbytes());
       inputDynMemRef->data = copiedData;
       inputDynMemRef->alignedData = copiedData;
+      copiedInputs.emplace_back(copiedData);
     }
 
     for (int i = 0; i < inputPyArray.ndim(); i++) {
@@ -39,6 +49,21 @@ std::vector<py::array> PyExecutionSession::pyRun(
       inputDynMemRef->strides[i] = inputPyArray.strides(i);
     }
 
+    // The model appends to its key/value caches in place, so their pasts are
+    // copied into buffers reserved for the capacity of the caches. The Python
+    // session does not keep caches between runs.
+    for (auto &cache : _kvCaches)
+      if (cache.pastIndex == inputIdx) {
+        inputDynMemRef->offset = 0;
+        auto *buffer = createKVCacheBuffer(*inputDynMemRef, cache);
+        // The data of the replaced input is owned by the array or by the
+        // copied inputs.
+        inputDynMemRef->data = nullptr;
+        delete inputDynMemRef;
+        inputDynMemRef = buffer;
+        copiedInputs.emplace_back(inputDynMemRef->data);
+      }
+
     setDynMemRef(wrappedInput, inputIdx++, inputDynMemRef);
   }
 
@@ -48,10 +73,20 @@ std::vector<py::array> PyExecutionSession::pyRun(
     auto *dynMemRef = getDynMemRef(wrappedOutput, i);
     auto shape = std::vector<int64_t>(
         dynMemRef->sizes, dynMemRef->sizes + dynMemRef->rank);
+    // Outputs appended in place to a key/value cache are strided for its
+    // capacity.
+    std::vector<int64_t> strides;
+    for (int d = 0; d < dynMemRef->rank; d++)
+      strides.emplace_back(dynMemRef->strides[d] * sizeof(float));
     outputPyArrays.emplace_back(
-        py::array(py::dtype("float32"), shape, dynMemRef->data));
+        py::array(py::dtype("float32"), shape, strides, dynMemRef->data));
   }
 
+  // Output arrays own a copy of their data, so the copied inputs, including
+  // any that outputs were computed in place into, can be released.
+  for (auto *copiedData : copiedInputs)
+    free(copiedData);
+
   return outputPyArrays;
 }
 } // namespace onnx_mlir
\ No newline at end of file
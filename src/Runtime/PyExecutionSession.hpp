@@ -15,14 +15,17 @@
 
 namespace py = pybind11;
 
+#include "src/Compiler.hpp"
 #include "src/Runtime/ExecusionSession.hpp"
 
 namespace onnx_mlir {
 
 class PyExecutionSession : public onnx_mlir::ExecutionSession {
 public:
-  PyExecutionSession(std::string sharedLibPath, std::string entryPointName)
-      : onnx_mlir::ExecutionSession(sharedLibPath, entryPointName){};
+  PyExecutionSession(std::string sharedLibPath, std::string entryPointName,
+      bool donateInputs = false)
+      : onnx_mlir::ExecutionSession(
+            sharedLibPath, entryPointName, donateInputs){};
 
   std::vector<py::array> pyRun(std::vector<py::array> inputsPyArray);
 };
@@ -30,6 +33,35 @@ public:
 
 PYBIND11_MODULE(PyRuntime, m) {
   py::class_<onnx_mlir::PyExecutionSession>(m, "ExecutionSession")
-      .def(py::init<const std::string &, const std::string &>())
-      .def("run", &onnx_mlir::PyExecutionSession::pyRun);
+      .def(py::init<const std::string &, const std::string &, bool>(),
+          py::arg("shared_lib_path"), py::arg("entry_point_name"),
+          py::arg("donate_inputs") = false)
+      .def("run", &onnx_mlir::PyExecutionSession::pyRun)
+      .def("warmup", &onnx_mlir::PyExecutionSession::warmup,
+          py::arg("run_inference") = true)
+      .def("get_memory_footprint",
+          &onnx_mlir::PyExecutionSession::getMemoryFootprint);
+  m.def(
+      "compile_model",
+      [](py::bytes model, const std::string &outputBaseName,
+          bool donateInputs, std::vector<std::string> kvCache,
+          int64_t kvCacheCapacity, std::vector<std::string> dimBounds) {
+        std::string data = model;
+        onnx_mlir::CompileOptions options;
+        options.donateInputs = donateInputs;
+        options.kvCache = kvCache;
+        options.kvCacheCapacity = kvCacheCapacity;
+        options.dimBounds = dimBounds;
+        // Compilation does not touch Python objects.
+        py::gil_scoped_release release;
+        return onnx_mlir::compileModel(
+            data.data(), data.size(), outputBaseName, options);
+      },
+      "Compile a serialized ONNX model into <output_base_name>.so and return "
+      "the path of the library.",
+      py::arg("model"), py::arg("output_base_name"),
+      py::arg("donate_inputs") = false,
+      py::arg("kv_cache") = std::vector<std::string>(),
+      py::arg("kv_cache_capacity") = 2048,
+      py::arg("dim_bounds") = std::vector<std::string>());
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+//===-------- RuntimeBitcode.cpp - Link the Runtime as LLVM Bitcode -------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of the functions linking the runtime into
+// the LLVM modules of the compiled models.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdlib>
+#include <mutex>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "src/ExternalUtil.hpp"
+#include "src/Runtime/RuntimeBitcode.hpp"
+
+namespace onnx_mlir {
+
+llvm::Optional<std::string> getRuntimeBitcodePath() {
+  // The bitcode sits next to the runtime libraries, both in the build tree and
+  // where they are installed.
+  llvm::SmallVector<std::string, 2> dirs;
+  if (const char *runtimeDir = std::getenv("RUNTIME_DIR"))
+    dirs.emplace_back(runtimeDir);
+  dirs.emplace_back(kRuntimeBitcodeDir);
+  for (auto &dir : dirs) {
+    auto path = dir + "/runtime.bc";
+    if (llvm::sys::fs::exists(path))
+      return path;
+  }
+
+  // Models are then linked against the runtime libraries instead.
+  static std::once_flag warned;
+  std::call_once(warned, [&]() {
+    llvm::errs() << "warning: runtime.bc not found in "
+                 << llvm::join(dirs, ", ")
+                 << "; the runtime functions called by models will not be "
+                    "inlined\n";
+  });
+  return llvm::None;
+}
+
+llvm::Error linkRuntimeBitcode(llvm::Module &module) {
+  auto path = getRuntimeBitcodePath();
+  if (!path)
+    return llvm::Error::success();
+
+  llvm::SMDiagnostic diagnostic;
+  auto runtime = llvm::parseIRFile(*path, diagnostic, module.getContext());
+  if (!runtime)
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+        "cannot read " + *path + ": " + diagnostic.getMessage());
+
+  // Only the functions the model uses are copied, and they become private to
+  // the model, so that those inlined everywhere are dropped.
+  bool failed = llvm::Linker::linkModules(module, std::move(runtime),
+      llvm::Linker::Flags::LinkOnlyNeeded,
+      [](llvm::Module &module, const llvm::StringSet<> &linkedNames) {
+        for (auto &name : linkedNames) {
+          auto *global = module.getNamedValue(name.getKey());
+          if (!global || global->isDeclaration())
+            continue;
+          if (auto *object = llvm::dyn_cast<llvm::GlobalObject>(global))
+            object->setComdat(nullptr);
+          global->setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+      });
+  if (failed)
+    return llvm::createStringError(
+        llvm::inconvertibleErrorCode(), "cannot link " + *path);
+  return llvm::Error::success();
+}
+
+} // namespace onnx_mlir
@@ -0,0 +1,37 @@
+//===-------- RuntimeBitcode.hpp - Link the Runtime as LLVM Bitcode -------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of the functions linking the runtime into
+// the LLVM modules of the compiled models.
+//
+// The runtime, i.e. the DynMemRef helpers, the loader of the embedded
+// constant pool and the kernel library, is also compiled to a single LLVM
+// bitcode file. The functions a model calls are copied from it into the model
+// before the model is optimized, so that they are inlined and specialized
+// rather than called through the static runtime libraries.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+
+namespace onnx_mlir {
+
+// Return the path of the runtime bitcode, looked up in the RUNTIME_DIR
+// directory if set and then in the library directory of the build tree, or
+// llvm::None with a warning if it is in neither.
+llvm::Optional<std::string> getRuntimeBitcodePath();
+
+// Link into `module` the functions and globals of the runtime bitcode it
+// uses, with internal linkage. Does nothing if there is no runtime bitcode.
+llvm::Error linkRuntimeBitcode(llvm::Module &module);
+
+} // namespace onnx_mlir
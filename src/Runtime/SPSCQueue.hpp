@@ -0,0 +1,77 @@
+//===------------- SPSCQueue.hpp - Single Producer Single Consumer --------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains a bounded lock-free queue between one producer thread
+// and one consumer thread, used to pass requests between pipeline stages.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace onnx_mlir {
+
+template <typename T>
+class SPSCQueue {
+public:
+  // The capacity is rounded up to a power of two. A thread waiting on the
+  // queue busy-spins for `spinDuration`, then sleeps between polls.
+  explicit SPSCQueue(size_t capacity,
+      std::chrono::microseconds spinDuration = std::chrono::microseconds(50))
+      : _spinDuration(spinDuration) {
+    size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+    _slots.resize(size);
+    _mask = size - 1;
+  }
+
+  // Append an element, waiting while the queue is full.
+  void push(T value) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    wait([&]() {
+      return tail - _head.load(std::memory_order_acquire) <= _mask;
+    });
+    _slots[tail & _mask] = std::move(value);
+    _tail.store(tail + 1, std::memory_order_release);
+  }
+
+  // Remove the oldest element, waiting while the queue is empty.
+  T pop() {
+    size_t head = _head.load(std::memory_order_relaxed);
+    wait([&]() { return _tail.load(std::memory_order_acquire) != head; });
+    T value = std::move(_slots[head & _mask]);
+    _head.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+private:
+  template <typename Ready>
+  void wait(Ready ready) {
+    if (ready())
+      return;
+    auto spinEnd = std::chrono::steady_clock::now() + _spinDuration;
+    while (!ready()) {
+      if (std::chrono::steady_clock::now() >= spinEnd)
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  }
+
+  std::vector<T> _slots;
+  size_t _mask;
+  std::chrono::microseconds _spinDuration;
+
+  // The indices written by the consumer and by the producer are kept on
+  // separate cache lines.
+  alignas(64) std::atomic<size_t> _head{0};
+  alignas(64) std::atomic<size_t> _tail{0};
+};
+} // namespace onnx_mlir
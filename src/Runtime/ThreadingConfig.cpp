@@ -0,0 +1,102 @@
+//===------ ThreadingConfig.cpp - Runtime Threading Configuration ---------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of ThreadingConfig struct, which controls
+// the threads started by the runtime: where they run and how they wait.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ThreadingConfig.hpp"
+
+namespace onnx_mlir {
+
+namespace {
+
+// Parse a list of cores given as comma separated cores or ranges of cores,
+// e.g. "0-3,8", keeping only the cores the process is allowed to run on.
+std::vector<int> parseCoreList(const std::string &list) {
+  std::vector<int> cores;
+#ifdef __linux__
+  cpu_set_t allowed;
+  bool hasAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+#endif
+  std::istringstream listStream(list);
+  std::string range;
+  while (std::getline(listStream, range, ',')) {
+    int first, last;
+    char dash;
+    std::istringstream rangeStream(range);
+    if (!(rangeStream >> first))
+      continue;
+    last = (rangeStream >> dash >> last) ? last : first;
+    for (int core = first; core <= last; core++) {
+#ifdef __linux__
+      if (hasAllowed && (core >= CPU_SETSIZE || !CPU_ISSET(core, &allowed)))
+        continue;
+#endif
+      cores.emplace_back(core);
+    }
+  }
+  return cores;
+}
+} // namespace
+
+ThreadingConfig ThreadingConfig::fromEnvironment() {
+  ThreadingConfig config;
+  if (const char *coreGroups = std::getenv("ONNX_MLIR_CORE_GROUPS")) {
+    if (std::string(coreGroups) == "numa") {
+      config.coreGroups = getNUMANodeCores();
+    } else {
+      std::istringstream groupsStream(coreGroups);
+      std::string group;
+      while (std::getline(groupsStream, group, ':'))
+        config.coreGroups.emplace_back(parseCoreList(group));
+    }
+  }
+  if (const char *spin = std::getenv("ONNX_MLIR_SPIN_US"))
+    config.spinDuration = std::chrono::microseconds(std::atoll(spin));
+  if (const char *depth = std::getenv("ONNX_MLIR_QUEUE_DEPTH"))
+    config.queueDepth = std::max(std::atoll(depth), 1LL);
+  return config;
+}
+
+std::vector<std::vector<int>> ThreadingConfig::getNUMANodeCores() {
+  std::vector<std::vector<int>> nodeCores;
+  for (int node = 0;; node++) {
+    std::ifstream cpuList("/sys/devices/system/node/node" +
+                          std::to_string(node) + "/cpulist");
+    if (!cpuList)
+      break;
+    std::string list;
+    std::getline(cpuList, list);
+    nodeCores.emplace_back(parseCoreList(list));
+  }
+  return nodeCores;
+}
+
+void ThreadingConfig::pinCurrentThread(const std::vector<int> &cores) {
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  for (int core : cores)
+    if (core >= 0 && core < CPU_SETSIZE)
+      CPU_SET(core, &cpuSet);
+  if (CPU_COUNT(&cpuSet) > 0)
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+#endif
+}
+} // namespace onnx_mlir
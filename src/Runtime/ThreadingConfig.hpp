@@ -0,0 +1,53 @@
+//===--------- ThreadingConfig.hpp - Runtime Threading Configuration ------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of ThreadingConfig struct, which controls
+// the threads started by the runtime: where they run and how they wait.
+//
+// The configuration applies to the classes that start threads: the stages of
+// PipelineSession, the workers of InferenceServer and the threads of
+// BatchScorer. Compiled models do not start threads of their own, so an
+// ExecutionSession runs a model entirely on the thread calling run, which
+// the caller places.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace onnx_mlir {
+
+struct ThreadingConfig {
+  // Cores every thread is pinned to, one group per thread; threads without a
+  // group are not pinned. Cores the process is not allowed to run on, e.g.
+  // outside of the cpuset of its container, are ignored.
+  std::vector<std::vector<int>> coreGroups;
+
+  // Time a thread waiting for work busy-spins before sleeping. Spinning cuts
+  // the latency of every request, at the cost of a core per waiting thread.
+  std::chrono::microseconds spinDuration{50};
+
+  // Number of requests that can wait between two threads.
+  size_t queueDepth = 4;
+
+  // The configuration set by the environment variables:
+  //  - ONNX_MLIR_CORE_GROUPS: core groups separated by ':', each a comma
+  //    separated list of cores or ranges of cores, e.g. "0-3,8:4-7,9"; or
+  //    "numa" for one group per NUMA node;
+  //  - ONNX_MLIR_SPIN_US: spin duration in microseconds;
+  //  - ONNX_MLIR_QUEUE_DEPTH: queue depth.
+  static ThreadingConfig fromEnvironment();
+
+  // The cores of every NUMA node the process is allowed to run on.
+  static std::vector<std::vector<int>> getNUMANodeCores();
+
+  // Pin the calling thread to the allowed cores of a group.
+  static void pinCurrentThread(const std::vector<int> &cores);
+};
+} // namespace onnx_mlir
@@ -6,7 +6,9 @@
 //
 // This file contains implementation of a utility called BinaryDecoder, which
 // decodes a sequence of binary data within a binary file specified by an
-// offset and a length into a typed array and print to stdout.
+// offset and a length into a typed array and print to stdout. With --analyze,
+// it instead reports statistics on the constants packed in the file (see
+// ConstantPoolAnalyzer.hpp).
 //
 //===----------------------------------------------------------------------===//
 
@@ -16,6 +18,9 @@
 
 #include "onnx/onnx_pb.h"
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+
+#include "ConstantPoolAnalyzer.hpp"
 
 #if defined(_WIN32)
 
@@ -32,10 +37,19 @@ llvm::cl::opt<std::string> Filename(
     llvm::cl::Positional, llvm::cl::desc("<input file>"), llvm::cl::Required);
 llvm::cl::opt<int64_t> Start("s",
     llvm::cl::desc("Specify the index of the starting byte"),
-    llvm::cl::value_desc("start"), llvm::cl::Required);
+    llvm::cl::value_desc("start"));
 llvm::cl::opt<int64_t> Size("n",
     llvm::cl::desc("Specify the number of bytes of data to decode"),
-    llvm::cl::value_desc("size"), llvm::cl::Required);
+    llvm::cl::value_desc("size"));
+llvm::cl::opt<std::string> Analyze("analyze",
+    llvm::cl::desc("Analyze the constants packed in the file, whose layout "
+                   "is given by the JSON index written by "
+                   "--pack-krnl-constants='write-index=true'"),
+    llvm::cl::value_desc("index"));
+llvm::cl::opt<unsigned> HistogramBins("histogram-bins",
+    llvm::cl::desc("Specify the number of bins of the histograms of the "
+                   "constants analyzed"),
+    llvm::cl::init(16));
 llvm::cl::opt<bool> Remove(
     "rm", llvm::cl::desc(
               "Whether to remove the file being decoded after inspection."));
@@ -67,6 +81,20 @@ int printBuffer(std::vector<char> buffer) {
 
 int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv);
+  if (!Analyze.empty()) {
+    int result = analyzeConstantPool(Filename, Analyze,
+        std::max(1U, HistogramBins.getValue()), llvm::outs());
+    if (Remove) {
+      llvm::sys::fs::remove(Filename);
+      llvm::sys::fs::remove(Analyze);
+    }
+    return result;
+  }
+  if (!Start.getNumOccurrences() || !Size.getNumOccurrences()) {
+    llvm::errs() << "Both -s and -n are required to decode data.\n";
+    return -1;
+  }
+
   std::vector<char> buffer(Size);
   std::ifstream file(Filename, std::ios::in | std::ios::binary);
   if (!file)
@@ -0,0 +1,321 @@
+//===---- ConstantPoolAnalyzer.cpp - Analyze packed constant files --------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the constant pool analyzer of
+// BinaryDecoder, which reports statistics on every constant of a file packed
+// by the pack-krnl-constants pass.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include <llvm/ADT/Optional.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include "ConstantPoolAnalyzer.hpp"
+
+namespace {
+
+// A constant of the pool, as described by the index.
+struct Constant {
+  std::string name;
+  uint64_t offset;
+  uint64_t size;
+  std::string elementType;
+  std::vector<int64_t> shape;
+};
+
+// A constant mapped from the pool.
+class MappedConstant {
+public:
+  MappedConstant(int fd, const Constant &constant, std::error_code &error) {
+    // Mappings start at a multiple of the mapping alignment.
+    uint64_t alignment = llvm::sys::fs::mapped_file_region::alignment();
+    uint64_t begin = constant.offset / alignment * alignment;
+    _skip = constant.offset - begin;
+    _size = constant.size;
+    if (_size > 0)
+      _region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+          llvm::sys::fs::convertFDToNativeFile(fd),
+          llvm::sys::fs::mapped_file_region::readonly, _skip + _size, begin,
+          error);
+  }
+
+  const char *data() const {
+    return _region ? _region->const_data() + _skip : nullptr;
+  }
+  uint64_t size() const { return _size; }
+
+private:
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> _region;
+  uint64_t _skip = 0;
+  uint64_t _size = 0;
+};
+
+// Statistics of the values of a constant.
+struct ValueStats {
+  uint64_t numElements = 0;
+  uint64_t numZeros = 0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  double sum = 0;
+  std::vector<uint64_t> histogram;
+  // Error of quantizing the values to int8 with a symmetric scale.
+  double scale = 0;
+  double maxError = 0;
+  double sumSquares = 0;
+  double sumSquaredErrors = 0;
+};
+
+template <typename T>
+void computeValueStats(const char *data, uint64_t size, unsigned numBins,
+    bool quantize, ValueStats &stats) {
+  stats.numElements = size / sizeof(T);
+  auto element = [&](uint64_t i) {
+    T value;
+    std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+    return (double)value;
+  };
+
+  for (uint64_t i = 0; i < stats.numElements; ++i) {
+    double value = element(i);
+    stats.numZeros += value == 0;
+    stats.min = std::min(stats.min, value);
+    stats.max = std::max(stats.max, value);
+    stats.sum += value;
+  }
+  if (stats.numElements == 0)
+    return;
+
+  // The histogram and the quantization error depend on the range.
+  stats.histogram.assign(numBins, 0);
+  double width = (stats.max - stats.min) / numBins;
+  stats.scale = std::max(std::fabs(stats.min), std::fabs(stats.max)) / 127;
+  for (uint64_t i = 0; i < stats.numElements; ++i) {
+    double value = element(i);
+    unsigned bin =
+        width > 0 ? std::min<unsigned>((value - stats.min) / width, numBins - 1)
+                  : 0;
+    stats.histogram[bin]++;
+    if (!quantize || stats.scale == 0)
+      continue;
+    double quantized =
+        std::max(-127.0, std::min(127.0, std::round(value / stats.scale))) *
+        stats.scale;
+    double error = value - quantized;
+    stats.maxError = std::max(stats.maxError, std::fabs(error));
+    stats.sumSquares += value * value;
+    stats.sumSquaredErrors += error * error;
+  }
+}
+
+// Compute the statistics of the values of a constant, or return false if its
+// element type is not supported.
+bool computeValueStats(const std::string &elementType, const char *data,
+    uint64_t size, unsigned numBins, ValueStats &stats) {
+  if (elementType == "f32")
+    computeValueStats<float>(data, size, numBins, true, stats);
+  else if (elementType == "f64")
+    computeValueStats<double>(data, size, numBins, true, stats);
+  else if (elementType == "i8")
+    computeValueStats<int8_t>(data, size, numBins, false, stats);
+  else if (elementType == "i16")
+    computeValueStats<int16_t>(data, size, numBins, true, stats);
+  else if (elementType == "i32")
+    computeValueStats<int32_t>(data, size, numBins, true, stats);
+  else if (elementType == "i64")
+    computeValueStats<int64_t>(data, size, numBins, true, stats);
+  else
+    return false;
+  return true;
+}
+
+// Shannon entropy of the bytes of a constant, in bits per byte.
+double computeByteEntropy(const char *data, uint64_t size) {
+  uint64_t counts[256] = {};
+  for (uint64_t i = 0; i < size; ++i)
+    counts[(unsigned char)data[i]]++;
+  double entropy = 0;
+  for (auto count : counts)
+    if (count > 0) {
+      double p = (double)count / size;
+      entropy -= p * std::log2(p);
+    }
+  return entropy;
+}
+
+// 64-bit FNV-1a hash of the bytes of a constant.
+uint64_t hashBytes(const char *data, uint64_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint64_t i = 0; i < size; ++i)
+    hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+  return hash;
+}
+
+llvm::Optional<std::vector<Constant>> readIndex(
+    const std::string &indexPath, bool &isLE) {
+  auto buffer = llvm::MemoryBuffer::getFile(indexPath);
+  if (!buffer) {
+    llvm::errs() << "Cannot read " << indexPath << ": "
+                 << buffer.getError().message() << "\n";
+    return llvm::None;
+  }
+  auto index = llvm::json::parse((*buffer)->getBuffer());
+  if (!index) {
+    llvm::errs() << "Cannot parse " << indexPath << ": "
+                 << llvm::toString(index.takeError()) << "\n";
+    return llvm::None;
+  }
+
+  std::vector<Constant> constants;
+  auto *layout = index->getAsObject();
+  auto *entries = layout ? layout->getArray("constants") : nullptr;
+  if (!entries) {
+    llvm::errs() << "Missing constants in " << indexPath << "\n";
+    return llvm::None;
+  }
+  isLE = layout->getBoolean("is_le").getValueOr(true);
+  for (const auto &entry : *entries) {
+    auto *object = entry.getAsObject();
+    auto name = object ? object->getString("name") : llvm::None;
+    auto offset = object ? object->getInteger("offset") : llvm::None;
+    auto size = object ? object->getInteger("size_in_bytes") : llvm::None;
+    auto type = object ? object->getString("element_type") : llvm::None;
+    auto *shape = object ? object->getArray("shape") : nullptr;
+    if (!name || !offset || !size || !type || !shape || *offset < 0 ||
+        *size < 0) {
+      llvm::errs() << "Invalid constant in " << indexPath << "\n";
+      return llvm::None;
+    }
+    Constant constant{name->str(), (uint64_t)*offset, (uint64_t)*size,
+        type->str(), {}};
+    for (const auto &dim : *shape)
+      constant.shape.emplace_back(dim.getAsInteger().getValueOr(-1));
+    constants.emplace_back(std::move(constant));
+  }
+  return constants;
+}
+} // namespace
+
+int analyzeConstantPool(const std::string &poolPath,
+    const std::string &indexPath, unsigned numBins, llvm::raw_ostream &os) {
+  bool isLE;
+  auto constants = readIndex(indexPath, isLE);
+  if (!constants)
+    return 1;
+  if (isLE != (llvm::support::endian::system_endianness() ==
+                  llvm::support::endianness::little)) {
+    llvm::errs() << "Constants of " << poolPath
+                 << " do not have the endianness of this host\n";
+    return 1;
+  }
+
+  int fd;
+  uint64_t poolSize;
+  if (auto error = llvm::sys::fs::openFileForRead(poolPath, fd)) {
+    llvm::errs() << "Cannot open " << poolPath << ": " << error.message()
+                 << "\n";
+    return 1;
+  }
+  if (auto error = llvm::sys::fs::file_size(poolPath, poolSize)) {
+    llvm::errs() << "Cannot stat " << poolPath << ": " << error.message()
+                 << "\n";
+    return 1;
+  }
+
+  // Constants with the same size and hash, checked byte by byte.
+  std::map<std::pair<uint64_t, uint64_t>, std::vector<size_t>> hashes;
+  uint64_t totalBytes = 0, duplicateBytes = 0, totalElements = 0,
+           totalZeros = 0;
+  double compressedBytes = 0;
+
+  for (size_t c = 0; c < constants->size(); ++c) {
+    const auto &constant = (*constants)[c];
+    if (constant.offset + constant.size > poolSize) {
+      llvm::errs() << constant.name << " lies outside of " << poolPath << "\n";
+      return 1;
+    }
+    std::error_code error;
+    MappedConstant mapped(fd, constant, error);
+    if (error) {
+      llvm::errs() << "Cannot map " << constant.name << ": "
+                   << error.message() << "\n";
+      return 1;
+    }
+    const char *data = mapped.data();
+    uint64_t size = mapped.size();
+
+    os << constant.name << ": " << constant.elementType << " [";
+    for (size_t d = 0; d < constant.shape.size(); ++d)
+      os << (d ? ", " : "") << constant.shape[d];
+    os << "], " << size << " bytes at offset " << constant.offset << "\n";
+
+    ValueStats stats;
+    if (computeValueStats(constant.elementType, data, size, numBins, stats) &&
+        stats.numElements > 0) {
+      os << "  zeros: " << stats.numZeros << " of " << stats.numElements
+         << llvm::format(
+                " (%.2f%%)", 100.0 * stats.numZeros / stats.numElements)
+         << "\n";
+      os << llvm::format("  range: [%g, %g], mean %g\n", stats.min, stats.max,
+          stats.sum / stats.numElements);
+      os << "  histogram:";
+      for (auto count : stats.histogram)
+        os << " " << count;
+      os << "\n";
+      if (stats.scale > 0 && stats.sumSquares > 0) {
+        os << llvm::format("  int8: scale %g, max error %g, rms error %g",
+            stats.scale, stats.maxError,
+            std::sqrt(stats.sumSquaredErrors / stats.numElements));
+        if (stats.sumSquaredErrors > 0)
+          os << llvm::format(", SQNR %.1f dB",
+              10 * std::log10(stats.sumSquares / stats.sumSquaredErrors));
+        else
+          os << ", lossless";
+        os << "\n";
+      }
+      totalElements += stats.numElements;
+      totalZeros += stats.numZeros;
+    }
+
+    double entropy = computeByteEntropy(data, size);
+    os << llvm::format("  entropy: %.2f bits/byte, compressible to %.1f%%\n",
+        entropy, 100 * entropy / 8);
+    compressedBytes += size * entropy / 8;
+    totalBytes += size;
+
+    auto &sameHash = hashes[{size, hashBytes(data, size)}];
+    for (size_t other : sameHash) {
+      MappedConstant otherMapped(fd, (*constants)[other], error);
+      if (!error && std::memcmp(otherMapped.data(), data, size) == 0) {
+        os << "  duplicate of " << (*constants)[other].name << "\n";
+        duplicateBytes += size;
+        break;
+      }
+    }
+    sameHash.emplace_back(c);
+  }
+  llvm::sys::fs::closeFile(fd);
+
+  os << "total: " << constants->size() << " constants, " << totalBytes
+     << " bytes, " << duplicateBytes << " duplicate bytes";
+  if (totalElements > 0)
+    os << llvm::format(", %.2f%% zeros", 100.0 * totalZeros / totalElements);
+  if (totalBytes > 0)
+    os << llvm::format(
+        ", compressible to %.1f%%", 100 * compressedBytes / totalBytes);
+  os << "\n";
+  return 0;
+}
@@ -0,0 +1,28 @@
+//===---- ConstantPoolAnalyzer.hpp - Analyze packed constant files --------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the declaration of the constant pool analyzer of
+// BinaryDecoder, which reports statistics on every constant of a file packed
+// by the pack-krnl-constants pass, to decide how to compress or quantize the
+// weights of a model.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+
+#include <llvm/Support/raw_ostream.h>
+
+// Analyze the constants packed in `poolPath`, laid out as described by the
+// JSON index `indexPath` written by pack-krnl-constants with write-index. For
+// every constant, report its size, its zeros, the range, mean and histogram
+// of its values, the entropy of its bytes, the error of quantizing it to
+// int8, and whether it duplicates an earlier constant; then the totals.
+// Constants are mapped one at a time, so that large pools are streamed.
+// Return 0 on success.
+int analyzeConstantPool(const std::string &poolPath,
+    const std::string &indexPath, unsigned numBins, llvm::raw_ostream &os);
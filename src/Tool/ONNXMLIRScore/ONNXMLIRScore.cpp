@@ -0,0 +1,77 @@
+//===------- ONNXMLIRScore.cpp - Score a dataset with a compiled model ----===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementation of a utility called onnx-mlir-score, which
+// runs a model compiled by onnx-mlir offline over shards of input files,
+// .npy or raw, and writes every output of the model to a raw file.
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+
+#include "src/Runtime/BatchScorer.hpp"
+
+llvm::cl::opt<std::string> ModelPath(llvm::cl::Positional,
+    llvm::cl::desc("<model.so>"), llvm::cl::Required);
+llvm::cl::list<std::string> Shards(llvm::cl::Positional,
+    llvm::cl::desc("<input0[,input1...]>..."), llvm::cl::OneOrMore);
+llvm::cl::opt<int64_t> BatchSize("batch-size",
+    llvm::cl::desc("Specify the number of samples per batch, for models "
+                   "whose batch dimension is dynamic"),
+    llvm::cl::value_desc("size"), llvm::cl::init(64));
+llvm::cl::opt<std::string> OutputPrefix("o",
+    llvm::cl::desc("Specify the prefix of the output files, output i being "
+                   "written to <prefix>i.bin"),
+    llvm::cl::value_desc("prefix"), llvm::cl::init("output"));
+
+int main(int argc, char *argv[]) {
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+      "Scores shards of input files with a model compiled by onnx-mlir.\n"
+      "Every shard lists one file per input of the model, separated by "
+      "commas.\n");
+
+  std::vector<std::vector<std::string>> shards;
+  for (const auto &shard : Shards) {
+    llvm::SmallVector<llvm::StringRef, 4> files;
+    llvm::StringRef(shard).split(files, ',');
+    shards.emplace_back(files.begin(), files.end());
+  }
+
+  try {
+    onnx_mlir::BatchScorer scorer(ModelPath, BatchSize);
+    std::vector<std::string> outputPaths;
+    for (size_t i = 0; i < scorer.getOutputElementSizes().size(); i++)
+      outputPaths.emplace_back(OutputPrefix + std::to_string(i) + ".bin");
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t numSamples = scorer.score(shards, outputPaths);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "Scored " << numSamples << " samples in " << elapsed.count()
+              << " s" << std::endl;
+
+    // The raw output files are described by the dimensions of a sample.
+    const auto &sampleDims = scorer.getOutputSampleDims();
+    for (size_t i = 0; i < outputPaths.size(); i++) {
+      std::cout << outputPaths[i] << ": "
+                << scorer.getOutputElementSizes()[i] << " byte elements, ("
+                << "samples";
+      for (auto dim : sampleDims[i])
+        std::cout << ", " << dim;
+      std::cout << ")" << std::endl;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
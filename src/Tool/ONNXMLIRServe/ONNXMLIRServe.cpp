@@ -0,0 +1,66 @@
+//===------ ONNXMLIRServe.cpp - Serve compiled models to local clients ----===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementation of a utility called onnx-mlir-serve, which
+// loads models compiled by onnx-mlir and serves them to the clients running on
+// the same host through a Unix domain socket, until it is interrupted.
+//
+//===----------------------------------------------------------------------===//
+
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <llvm/Support/CommandLine.h>
+
+#include "src/Runtime/InferenceServer.hpp"
+
+llvm::cl::list<std::string> Models(llvm::cl::Positional,
+    llvm::cl::desc("<name=model.so>..."), llvm::cl::OneOrMore);
+llvm::cl::opt<std::string> SocketPath("socket",
+    llvm::cl::desc("Specify the path of the socket to listen on"),
+    llvm::cl::value_desc("path"), llvm::cl::Required);
+llvm::cl::opt<size_t> RingSize("ring-size",
+    llvm::cl::desc("Specify the size in MiB of the ring of shared memory "
+                   "given to every client"),
+    llvm::cl::value_desc("size"), llvm::cl::init(64));
+
+int main(int argc, char *argv[]) {
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv, "Serves models compiled by onnx-mlir to local clients.\n");
+
+  std::map<std::string, std::string> models;
+  for (const auto &model : Models) {
+    auto separator = model.find('=');
+    if (separator == std::string::npos || separator == 0) {
+      std::cerr << "Expected name=model.so, got " << model << std::endl;
+      return 1;
+    }
+    models[model.substr(0, separator)] = model.substr(separator + 1);
+  }
+
+  // Block the termination signals in every thread, so that they are only
+  // received by the main thread, which then stops the server.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  onnx_mlir::InferenceServer server(models, SocketPath, RingSize << 20);
+  std::cout << "Serving " << models.size() << " model(s) with "
+            << server.numWorkers() << " worker(s) on " << SocketPath
+            << std::endl;
+  std::thread serving([&server] { server.serve(); });
+
+  int signal;
+  sigwait(&signals, &signal);
+  server.stop();
+  serving.join();
+  return 0;
+}
@@ -18,6 +18,7 @@
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
 #include "src/Dialect/Krnl/KrnlOps.hpp"
 #include "src/Pass/Passes.hpp"
+#include "src/Pass/Remarks.hpp"
 
 using namespace mlir;
 
@@ -59,6 +60,13 @@ bool checkOpResultIsUsedByGetRef(AllocOp *allocOp) {
  *    %0 = krnl.getref %mem <offset> : memref<<dims>x<type>>
  *
  *  For now, to enable testing, offset will always be 0.
+ *
+ *  A MemRef with dynamic dimensions whose sizes are bounded at compile time
+ *  (see --dim-bounds) is allocated at its maximum size, and viewed with its
+ *  actual sizes:
+ *    %mem = alloc() : memref<<max size>xi8>
+ *    %ref = krnl.getref %mem <offset> : memref<<max elements>x<type>>
+ *    %0 = krnl.reinterpret %ref, <sizes> : memref<<dims>x<type>>
  */
 
 class KrnlEnableMemoryPool : public OpRewritePattern<AllocOp> {
@@ -71,12 +79,10 @@ public:
 
     auto memRefType = convertToMemRefType(allocOp.getResult().getType());
 
-    // For now we only support constant tensors.
-    // TODO: Enable this pass for MemRef with dyanmic shapes.
     // If alloc operation is not returned then it is a candidate for
-    // being included in the memory pool.
-    if (!hasAllConstantDimensions(memRefType) ||
-        checkOpResultIsReturned(&allocOp))
+    // being included in the memory pool. MemRefs with dynamic dimensions
+    // are only supported when the dimensions are bounded.
+    if (checkOpResultIsReturned(&allocOp))
       return failure();
 
     // Check the result of this alloc is not already used by a krnl.getref.
@@ -84,11 +90,10 @@ public:
       return failure();
 
     // Compute total size.
-    auto memRefShape = memRefType.getShape();
-    int64_t totalSize = 1;
-    for (int i = 0; i < memRefShape.size(); i++)
-      totalSize *= memRefShape[i];
-    totalSize *= getMemRefEltSizeInBytes(memRefType);
+    auto sizeInBytes = getSizeInBytesUpperBound(allocOp.getResult());
+    if (!sizeInBytes)
+      return failure();
+    int64_t totalSize = *sizeInBytes;
 
     // Emit new alloc.
     SmallVector<int64_t, 1> memPoolShape;
@@ -105,10 +110,24 @@ public:
     // Get reference to local MemRef.
     auto zero = rewriter.create<ConstantOp>(
         loc, rewriter.getIntegerAttr(rewriter.getIntegerType(64), 0));
-    auto poolMemRef =
-        rewriter.create<KrnlGetRefOp>(loc, memRefType, newAlloc, zero);
+    if (hasAllConstantDimensions(memRefType)) {
+      auto poolMemRef =
+          rewriter.create<KrnlGetRefOp>(loc, memRefType, newAlloc, zero);
+      rewriter.replaceOp(allocOp, poolMemRef.getResult());
+      return success();
+    }
 
-    rewriter.replaceOp(allocOp, poolMemRef.getResult());
+    // View the pool as a flat MemRef of the element type, reinterpreted with
+    // the sizes of the dynamic dimensions.
+    auto flatMemRefType = MemRefType::get(
+        {totalSize / getMemRefEltSizeInBytes(memRefType)},
+        memRefType.getElementType());
+    auto poolMemRef =
+        rewriter.create<KrnlGetRefOp>(loc, flatMemRefType, newAlloc, zero);
+    auto view = rewriter.create<KrnlReinterpretOp>(loc, memRefType,
+        poolMemRef.getResult(), allocOp.getOperands(), /*axis=*/nullptr,
+        /*capacity=*/nullptr);
+    rewriter.replaceOp(allocOp, view.getResult());
 
     return success();
   }
@@ -120,8 +139,10 @@ public:
 
   LogicalResult matchAndRewrite(
       DeallocOp deallocOp, PatternRewriter &rewriter) const override {
-    if (auto getRefOp = llvm::dyn_cast<KrnlGetRefOp>(
-            deallocOp.getOperand().getDefiningOp())) {
+    auto *defOp = deallocOp.getOperand().getDefiningOp();
+    if (auto reinterpretOp = llvm::dyn_cast_or_null<KrnlReinterpretOp>(defOp))
+      defOp = reinterpretOp.memref().getDefiningOp();
+    if (auto getRefOp = llvm::dyn_cast_or_null<KrnlGetRefOp>(defOp)) {
       rewriter.eraseOp(deallocOp);
       return success();
     }
@@ -141,6 +162,26 @@ public:
   void runOnFunction() override {
     auto function = getFunction();
 
+    // Report which of the tensors of the function are allocated from the
+    // memory pool, before the pool allocations are introduced.
+    function.walk([&](AllocOp allocOp) {
+      if (checkOpResultIsUsedByGetRef(&allocOp))
+        return;
+      auto sizeInBytes = getSizeInBytesUpperBound(allocOp.getResult());
+      if (!sizeInBytes)
+        emitOptimizationRemark(allocOp, "enable-memory-pool",
+            "MemoryPool", RemarkKind::Missed,
+            "the tensor has unbounded dynamic dimensions");
+      else if (checkOpResultIsReturned(&allocOp))
+        emitOptimizationRemark(allocOp, "enable-memory-pool",
+            "MemoryPool", RemarkKind::Missed,
+            "the tensor is returned by the function");
+      else
+        emitOptimizationRemark(allocOp, "enable-memory-pool",
+            "MemoryPool", RemarkKind::Applied,
+            Twine(*sizeInBytes) + " bytes allocated from the memory pool");
+    });
+
     ConversionTarget target(getContext());
     OwningRewritePatternList patterns;
     patterns.insert<KrnlEnableMemoryPool>(&getContext());
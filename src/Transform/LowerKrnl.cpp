@@ -16,6 +16,7 @@
 
 #include "src/Dialect/Krnl/KrnlOps.hpp"
 #include "src/Pass/Passes.hpp"
+#include "src/Pass/Remarks.hpp"
 
 using namespace mlir;
 
@@ -223,9 +224,11 @@ void KrnlToAffineLoweringPass::runOnFunction() {
 
   // Operations that should be converted to LLVM IRs directly.
   target.addLegalOp<KrnlMemcpyOp>();
+  target.addLegalOp<KrnlCallKernelOp>();
   target.addLegalOp<KrnlEntryPointOp>();
   target.addLegalOp<KrnlGlobalOp>();
   target.addLegalOp<KrnlGetRefOp>();
+  target.addLegalOp<KrnlReinterpretOp>();
   target.addLegalOp<KrnlIterateOp>();
 
   OwningRewritePatternList patterns;
@@ -289,11 +292,14 @@ void KrnlToAffineLoweringPass::runOnFunction() {
         auto blockOp = cast<KrnlBlockOp>(user);
         SmallVector<AffineForOp, 2> tiledLoops;
         SmallVector<AffineForOp, 1> loopsToTile = {forOp};
-        if (failed(tilePerfectlyNested(loopsToTile,
-                cast<KrnlBlockOp>(user).tile_sizeAttr().getInt(),
-                &tiledLoops))) {
+        auto tileSize = blockOp.tile_sizeAttr().getInt();
+        if (failed(tilePerfectlyNested(loopsToTile, tileSize, &tiledLoops))) {
+          emitOptimizationRemark(blockOp, "lower-krnl", "Tiling",
+              RemarkKind::Missed, "the loop is not perfectly nested");
           return signalPassFailure();
         }
+        emitOptimizationRemark(blockOp, "lower-krnl", "Tiling",
+            RemarkKind::Applied, "loop tiled by " + Twine(tileSize));
         assert(tiledLoops.size() == 2);
         assert(blockOp.getNumResults() == 2);
         // Record the tiled loop references, and their corresponding tiled for
@@ -152,6 +152,68 @@ private:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlReinterpretOpLowering
+//===----------------------------------------------------------------------===//
+
+class KrnlReinterpretOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlReinterpretOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(
+            KrnlReinterpretOp::getOperationName(), context, lowering_) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto loc = op->getLoc();
+    KrnlReinterpretOpOperandAdaptor operandAdaptor(operands);
+
+    auto memRefTy = op->getResult(0).getType().cast<mlir::MemRefType>();
+    auto llvmMemRefType =
+        typeConverter.convertType(memRefTy).cast<LLVM::LLVMType>();
+    auto shape = memRefTy.getShape();
+    auto rank = shape.size();
+
+    // The result shares the buffer of the input MemRef.
+    MemRefDescriptor source(operandAdaptor.memref());
+    auto result = MemRefDescriptor::undef(rewriter, loc, llvmMemRefType);
+    result.setAllocatedPtr(rewriter, loc, source.allocatedPtr(rewriter, loc));
+    result.setAlignedPtr(rewriter, loc, source.alignedPtr(rewriter, loc));
+    result.setOffset(rewriter, loc, source.offset(rewriter, loc));
+
+    // Fill in the sizes, and the strides of an identity layout, in which the
+    // size of the capacity axis, if any, is replaced by the capacity.
+    auto reinterpretOp = llvm::cast<KrnlReinterpretOp>(op);
+    int64_t capacityAxis = -1, capacity = 0;
+    if (reinterpretOp.axisAttr() && reinterpretOp.capacityAttr()) {
+      capacityAxis = reinterpretOp.axisAttr().getValue().getSExtValue();
+      capacity = reinterpretOp.capacityAttr().getValue().getSExtValue();
+    }
+    auto sizes = operandAdaptor.sizes();
+    SmallVector<Value, 4> dimSizes;
+    int dynamicIndex = 0;
+    for (int i = 0; i < rank; ++i)
+      dimSizes.emplace_back(shape[i] < 0
+                                ? sizes[dynamicIndex++]
+                                : createIndexConstant(rewriter, loc, shape[i]));
+    Value stride = createIndexConstant(rewriter, loc, 1);
+    for (int i = rank - 1; i >= 0; --i) {
+      result.setSize(rewriter, loc, i, dimSizes[i]);
+      result.setStride(rewriter, loc, i, stride);
+      if (i == 0)
+        continue;
+      Value extent = i == capacityAxis
+                         ? createIndexConstant(rewriter, loc, capacity)
+                         : dimSizes[i];
+      stride =
+          rewriter.create<LLVM::MulOp>(loc, getIndexType(), stride, extent);
+    }
+
+    rewriter.replaceOp(op, {result});
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // KRNL to LLVM: KrnlGlobalOpLowering
 //===----------------------------------------------------------------------===//
@@ -263,13 +325,17 @@ public:
       auto one = rewriter.create<LLVM::ConstantOp>(
           loc, llvmI64Ty, rewriter.getI64IntegerAttr(1));
 
-      auto base = module.lookupSymbol<LLVM::GlobalOp>("packedConst");
-      assert(base && "Cannot find symbol packedConst.");
-
-      Value constPackBasePtrAddr =
-          rewriter.create<LLVM::AddressOfOp>(loc, base);
-      Value constPackBasePtr = rewriter.create<LLVM::LoadOp>(
-          loc, base.getType(), constPackBasePtrAddr);
+      // The constant pack is loaded by every entry point for the thread it
+      // runs on, since concurrent entry points may read different replicas.
+      auto getThreadConstPoolRef = getOrInsertExternFunc(
+          KrnlPackedConstantOp::getThreadConstPoolMethodName(), module,
+          LLVM::LLVMType::getFunctionTy(llvmI8PtrTy, {}, /*isVarArg=*/false),
+          rewriter);
+      Value constPackBasePtr =
+          rewriter
+              .create<CallOp>(loc, getThreadConstPoolRef, llvmI8PtrTy,
+                  ArrayRef<Value>({}))
+              .getResult(0);
       auto offset = rewriter.create<LLVM::ConstantOp>(loc, llvmI64Ty,
           rewriter.getI64IntegerAttr(
               krnlGlobalOp.offsetAttr().getValue().getSExtValue()));
@@ -357,6 +423,57 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlCallKernelOpLowering
+//===----------------------------------------------------------------------===//
+
+class KrnlCallKernelOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlCallKernelOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(
+            KrnlCallKernelOp::getOperationName(), context, lowering_) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto loc = op->getLoc();
+    auto *llvmDialect =
+        op->getContext()->getRegisteredDialect<LLVM::LLVMDialect>();
+    assert(llvmDialect && "expected llvm dialect to be registered");
+
+    // MemRefs are passed as pointers to their first element.
+    SmallVector<Value, 4> args;
+    SmallVector<LLVM::LLVMType, 4> argTypes;
+    for (int i = 0; i < operands.size(); ++i) {
+      Value arg = operands[i];
+      if (op->getOperand(i).getType().isa<MemRefType>()) {
+        MemRefDescriptor memRef(operands[i]);
+        arg = rewriter.create<LLVM::GEPOp>(loc, memRef.getElementType(),
+            memRef.alignedPtr(rewriter, loc),
+            ArrayRef<Value>({memRef.offset(rewriter, loc)}));
+      }
+      args.emplace_back(arg);
+      argTypes.emplace_back(arg.getType().cast<LLVM::LLVMType>());
+    }
+
+    // Declare the kernel, which is defined by the runtime kernel library.
+    auto name = llvm::cast<KrnlCallKernelOp>(op).name();
+    auto module = op->getParentOfType<ModuleOp>();
+    auto llvmVoidTy = LLVM::LLVMType::getVoidTy(llvmDialect);
+    if (!module.lookupSymbol<LLVM::LLVMFuncOp>(name)) {
+      PatternRewriter::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointToStart(module.getBody());
+      rewriter.create<LLVM::LLVMFuncOp>(module.getLoc(), name,
+          LLVM::LLVMType::getFunctionTy(llvmVoidTy, argTypes, false));
+    }
+
+    rewriter.create<CallOp>(loc,
+        SymbolRefAttr::get(name, op->getContext()), llvmVoidTy, args);
+    rewriter.eraseOp(op);
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // KRNL to LLVM: KrnlEntryPointOp
 //===----------------------------------------------------------------------===//
@@ -411,6 +528,59 @@ public:
     auto opaquePtrTy = LLVMType::getInt8PtrTy(llvmDialect);
     auto int32Ty = LLVMType::getInt32Ty(llvmDialect);
 
+    // Record that the model may write into its input buffers. The symbols
+    // describing the model are emitted once for all its entry points.
+    if (module.getAttr(ONNXEntryPointOp::getDonateInputsAttrName()) &&
+        !module.lookupSymbol(KrnlEntryPointOp::getInputsDonatedSymbolName())) {
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointToStart(module.getBody());
+      rewriter.create<LLVM::GlobalOp>(loc, LLVMType::getInt8Ty(llvmDialect),
+          /*isConstant=*/true, LLVM::Linkage::External,
+          KrnlEntryPointOp::getInputsDonatedSymbolName(),
+          rewriter.getI8IntegerAttr(1));
+    }
+
+    // Export the configuration of the key/value caches owned by the execution
+    // session.
+    auto kvCache =
+        module.getAttrOfType<ArrayAttr>(ONNXEntryPointOp::getKVCacheAttrName());
+    if (kvCache &&
+        !module.lookupSymbol(KrnlEntryPointOp::getKVCacheSymbolName())) {
+      SmallVector<int64_t, 10> config;
+      config.emplace_back(module
+                              .getAttrOfType<IntegerAttr>(
+                                  ONNXEntryPointOp::getKVCacheCapacityAttrName())
+                              .getInt());
+      config.emplace_back(kvCache.size());
+      for (auto entry : kvCache.getValue())
+        for (auto value : entry.cast<ArrayAttr>().getValue())
+          config.emplace_back(value.cast<IntegerAttr>().getInt());
+
+      auto int64Ty = LLVMType::getInt64Ty(llvmDialect);
+      auto configType = RankedTensorType::get(
+          {(int64_t)config.size()}, rewriter.getIntegerType(64));
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointToStart(module.getBody());
+      rewriter.create<LLVM::GlobalOp>(loc,
+          LLVMType::getArrayTy(int64Ty, config.size()),
+          /*isConstant=*/true, LLVM::Linkage::External,
+          KrnlEntryPointOp::getKVCacheSymbolName(),
+          DenseElementsAttr::get(configType, llvm::makeArrayRef(config)));
+    }
+
+    // Export the number of pipeline stages the model is partitioned into.
+    auto pipelineStages = module.getAttrOfType<IntegerAttr>(
+        ONNXEntryPointOp::getPipelineStagesAttrName());
+    if (pipelineStages &&
+        !module.lookupSymbol(KrnlEntryPointOp::getPipelineStagesSymbolName())) {
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointToStart(module.getBody());
+      rewriter.create<LLVM::GlobalOp>(loc, LLVMType::getInt64Ty(llvmDialect),
+          /*isConstant=*/true, LLVM::Linkage::External,
+          KrnlEntryPointOp::getPipelineStagesSymbolName(),
+          rewriter.getI64IntegerAttr(pipelineStages.getInt()));
+    }
+
     // Rewrite Krnl Entry Point Operation to an LLVM function with a dynamic
     // signature. The signature is dynamic because it remains the same no matter
     // what the model input/output schema look like. Such dynamic signature
@@ -728,40 +898,35 @@ public:
     assert(llvmDialect && "expected llvm dialect to be registered");
 
     auto packedConstOp = llvm::dyn_cast<KrnlPackedConstantOp>(op);
-    LLVM::GlobalOp globalBase;
     // Some frequently used types.
     auto llvmI8PtrTy = LLVM::LLVMType::getInt8PtrTy(llvmDialect);
     auto llvmI64Ty = LLVM::LLVMType::getInt64Ty(llvmDialect);
-    {
-      OpBuilder::InsertionGuard insertGuard(rewriter);
-      rewriter.setInsertionPointToStart(module.getBody());
 
-      globalBase = rewriter.create<LLVM::GlobalOp>(loc, llvmI8PtrTy,
-          /*isConstant=*/false, LLVM::Linkage::Internal, "packedConst",
-          nullptr);
-    }
-
-    auto mainFunc = module.lookupSymbol<FuncOp>("main_graph");
-    assert(mainFunc);
-
-    rewriter.setInsertionPoint(
-        &mainFunc.getBody().front(), mainFunc.getBody().front().begin());
-
-    //  - Initialize the global constant base.
-    Value basePtrAddr = rewriter.create<LLVM::AddressOfOp>(loc, globalBase);
     auto getEmbeddedConstPoolRef = getOrInsertExternFunc(
         KrnlPackedConstantOp::getEmbeddedDataLoaderMethodName(), module,
         LLVM::LLVMType::getFunctionTy(
             llvmI8PtrTy, {llvmI64Ty}, /*isVarArg=*/false),
         rewriter);
-    auto constPackSize = rewriter.create<LLVM::ConstantOp>(loc,
-        LLVM::LLVMType::getInt64Ty(llvmDialect),
-        packedConstOp.size_in_bytesAttr());
-    Value alloc = rewriter
-                      .create<CallOp>(loc, getEmbeddedConstPoolRef, llvmI8PtrTy,
-                          ArrayRef<Value>({constPackSize}))
-                      .getResult(0);
-    rewriter.create<LLVM::StoreOp>(loc, alloc, basePtrAddr);
+
+    // Every function of the model, the main graph or each of its pipeline
+    // stages, is called through its own entry point. Functions outlined from
+    // single operations are only called from these functions, on the same
+    // thread.
+    for (auto func : module.getOps<FuncOp>()) {
+      if (func.getAttr(ONNXEntryPointOp::getOutlinedOpAttrName()))
+        continue;
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPoint(
+          &func.getBody().front(), func.getBody().front().begin());
+
+      //  - Load the constant pack for the current thread, which the
+      //    constants then read through getThreadConstPool.
+      auto constPackSize = rewriter.create<LLVM::ConstantOp>(loc,
+          LLVM::LLVMType::getInt64Ty(llvmDialect),
+          packedConstOp.size_in_bytesAttr());
+      rewriter.create<CallOp>(loc, getEmbeddedConstPoolRef, llvmI8PtrTy,
+          ArrayRef<Value>({constPackSize}));
+    }
     {
       OpBuilder::InsertionGuard insertGuard(rewriter);
       rewriter.setInsertionPointToStart(module.getBody());
@@ -827,7 +992,115 @@ struct KrnlToLLVMLoweringPass
 };
 } // end anonymous namespace
 
+/// Return the character NumPy uses for the kind of elements of type `type`,
+/// or 0 if it has none.
+static int64_t getElementKind(Type type) {
+  if (type.isInteger(1))
+    return 'b';
+  if (type.isa<IntegerType>())
+    return 'i';
+  if (type.isa<FloatType>())
+    return 'f';
+  return 0;
+}
+
+/// Export the element sizes and shapes of the inputs and outputs of every
+/// entry point, so that the runtime can build inputs for the model and read
+/// its outputs on its own.
+static void emitSignatures(ModuleOp module) {
+  auto *llvmDialect =
+      module.getContext()->getRegisteredDialect<LLVM::LLVMDialect>();
+  auto int64Ty = LLVM::LLVMType::getInt64Ty(llvmDialect);
+  OpBuilder builder(module.getContext());
+  builder.setInsertionPointToStart(module.getBody());
+  module.walk([&](KrnlEntryPointOp entryPointOp) {
+    auto funcName = entryPointOp
+                        .getAttrOfType<SymbolRefAttr>(
+                            KrnlEntryPointOp::getEntryPointFuncAttrName())
+                        .getLeafReference();
+    auto func = module.lookupSymbol<FuncOp>(funcName);
+    if (!func)
+      return;
+    auto emitSignature = [&](TypeRange types, StringRef symbolPrefix) {
+      SmallVector<int64_t, 16> signature = {(int64_t)types.size()};
+      for (auto type : types) {
+        auto memRefType = type.dyn_cast<MemRefType>();
+        if (!memRefType)
+          return false;
+        signature.emplace_back(getMemRefEltSizeInBytes(memRefType));
+        signature.emplace_back(getElementKind(memRefType.getElementType()));
+        signature.emplace_back(memRefType.getRank());
+        for (auto dim : memRefType.getShape())
+          signature.emplace_back(dim < 0 ? -1 : dim);
+      }
+      auto signatureType = RankedTensorType::get(
+          {(int64_t)signature.size()}, builder.getIntegerType(64));
+      builder.create<LLVM::GlobalOp>(entryPointOp.getLoc(),
+          LLVM::LLVMType::getArrayTy(int64Ty, signature.size()),
+          /*isConstant=*/true, LLVM::Linkage::External,
+          (symbolPrefix + funcName).str(),
+          DenseElementsAttr::get(signatureType, llvm::makeArrayRef(signature)));
+      return true;
+    };
+    if (!emitSignature(func.getType().getInputs(),
+            KrnlEntryPointOp::getInputSignatureSymbolPrefix()) ||
+        !emitSignature(func.getType().getResults(),
+            KrnlEntryPointOp::getOutputSignatureSymbolPrefix()))
+      return;
+
+    // The upper bounds of the dimensions of the inputs let the runtime reject
+    // inputs larger than the buffers planned for them.
+    bool bounded = false;
+    SmallVector<int64_t, 16> bounds = {func.getNumArguments()};
+    for (int i = 0; i < func.getNumArguments(); ++i) {
+      auto memRefType = func.getType().getInput(i).cast<MemRefType>();
+      bounds.emplace_back(memRefType.getRank());
+      for (int d = 0; d < memRefType.getRank(); ++d) {
+        auto bound = getDimUpperBound(func.getArgument(i), d);
+        bounds.emplace_back(bound ? *bound : -1);
+        bounded |= bound && memRefType.isDynamicDim(d);
+      }
+    }
+    if (!bounded)
+      return;
+    auto boundsType = RankedTensorType::get(
+        {(int64_t)bounds.size()}, builder.getIntegerType(64));
+    builder.create<LLVM::GlobalOp>(entryPointOp.getLoc(),
+        LLVM::LLVMType::getArrayTy(int64Ty, bounds.size()),
+        /*isConstant=*/true, LLVM::Linkage::External,
+        (KrnlEntryPointOp::getInputBoundsSymbolPrefix() + funcName).str(),
+        DenseElementsAttr::get(boundsType, llvm::makeArrayRef(bounds)));
+  });
+}
+
+/// Export the memory footprint of the model computed by the memory footprint
+/// pass as a null-terminated string.
+static void emitMemoryFootprint(ModuleOp module) {
+  auto footprintAttr = module.getAttrOfType<StringAttr>(
+      KrnlEntryPointOp::getMemoryFootprintAttrName());
+  if (!footprintAttr)
+    return;
+  auto *llvmDialect =
+      module.getContext()->getRegisteredDialect<LLVM::LLVMDialect>();
+  std::string footprint = footprintAttr.getValue().str();
+  footprint.push_back('\0');
+  OpBuilder builder(module.getContext());
+  builder.setInsertionPointToStart(module.getBody());
+  builder.create<LLVM::GlobalOp>(module.getLoc(),
+      LLVM::LLVMType::getArrayTy(
+          LLVM::LLVMType::getInt8Ty(llvmDialect), footprint.size()),
+      /*isConstant=*/true, LLVM::Linkage::External,
+      KrnlEntryPointOp::getMemoryFootprintSymbolName(),
+      builder.getStringAttr(footprint));
+  module.removeAttr(KrnlEntryPointOp::getMemoryFootprintAttrName());
+}
+
 void KrnlToLLVMLoweringPass::runOnOperation() {
+  // Record the signatures while the types of the entry point functions still
+  // carry the shapes of the inputs and outputs.
+  emitSignatures(getOperation());
+  emitMemoryFootprint(getOperation());
+
   // Define the target for this lowering i.e. the LLVM dialect.
   ConversionTarget target(getContext());
   target.addLegalDialect<LLVM::LLVMDialect>();
@@ -847,7 +1120,9 @@ void KrnlToLLVMLoweringPass::runOnOperation() {
 
   patterns.insert<KrnlGlobalOpLowering, KrnlPackedConstOpLowering>(
       &getContext(), typeConverter);
-  patterns.insert<KrnlGetRefOpLowering>(&getContext(), typeConverter);
+  patterns.insert<KrnlGetRefOpLowering, KrnlReinterpretOpLowering>(
+      &getContext(), typeConverter);
+  patterns.insert<KrnlCallKernelOpLowering>(&getContext(), typeConverter);
 
   // Lower from the `krnl` dialect i.e. the Reshape operation.
   patterns.insert<KrnlMemcpyOpLowering, KrnlEntryPointOpLowering>(
@@ -0,0 +1,200 @@
+//===-------- MemoryFootprint.cpp - Compute the memory footprint ----------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a module level pass that computes the memory a model
+// needs at inference time, so that it can be placed on a host before it is
+// loaded. The footprint is recorded as a JSON string in a module attribute,
+// exported as a symbol of the compiled model and written next to it by the
+// onnx-mlir driver:
+//
+//  {
+//    "constant_pool_bytes": <size of the constants>,
+//    "entry_points": [{
+//      "name": <entry point function>,
+//      "inputs": [{"shape": [...], "element_size": <bytes>,
+//                  "max_bytes": <bytes>}, ...],
+//      "outputs": [...],
+//      "activation_bytes": <peak size of the buffers allocated in a run>,
+//      "total_bytes": <constants, inputs and activations>
+//    }, ...]
+//  }
+//
+// The sizes of buffers with dynamic dimensions are worst cases computed from
+// the bounds of the dynamic dimensions of the inputs (see --dim-bounds), and
+// are null when a dimension is unbounded. The outputs are allocated during
+// the run and included in the activations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/Support/JSON.h"
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ * Helper function converting an optional size into a JSON value, null when
+ * the size is unbounded.
+ */
+llvm::json::Value sizeToJSON(Optional<int64_t> size) {
+  if (!size)
+    return nullptr;
+  return *size;
+}
+
+/*!
+ * Helper function describing the buffers of a list of types.
+ */
+llvm::json::Array describeBuffers(
+    TypeRange types, llvm::function_ref<Optional<int64_t>(int)> getMaxBytes) {
+  llvm::json::Array buffers;
+  for (int i = 0; i < types.size(); ++i) {
+    auto memRefType = types[i].dyn_cast<MemRefType>();
+    if (!memRefType)
+      continue;
+    llvm::json::Array shape;
+    for (auto dim : memRefType.getShape())
+      shape.push_back(dim < 0 ? -1 : dim);
+    buffers.push_back(llvm::json::Object{{"shape", std::move(shape)},
+        {"element_size", (int64_t)getMemRefEltSizeInBytes(memRefType)},
+        {"max_bytes", sizeToJSON(getMaxBytes(i))}});
+  }
+  return buffers;
+}
+
+/*!
+ *  Module pass that computes the memory footprint of a model.
+ */
+class MemoryFootprintPass
+    : public PassWrapper<MemoryFootprintPass, OperationPass<ModuleOp>> {
+public:
+  void runOnOperation() override {
+    auto module = getOperation();
+
+    // Once packed, the constants are loaded as a whole.
+    int64_t constantPoolSize = 0;
+    bool packed = false;
+    module.walk([&](KrnlPackedConstantOp packedConstOp) {
+      constantPoolSize += packedConstOp.size_in_bytes();
+      packed = true;
+    });
+    if (!packed)
+      module.walk([&](KrnlGlobalOp globalOp) {
+        constantPoolSize += *getSizeInBytesUpperBound(globalOp.getResult());
+      });
+
+    llvm::json::Array entryPoints;
+    module.walk([&](KrnlEntryPointOp entryPointOp) {
+      auto func = module.lookupSymbol<FuncOp>(
+          entryPointOp
+              .getAttrOfType<SymbolRefAttr>(
+                  KrnlEntryPointOp::getEntryPointFuncAttrName())
+              .getLeafReference());
+      if (!func || func.getBlocks().size() != 1)
+        return;
+
+      Optional<int64_t> totalSize = constantPoolSize;
+      auto addToTotal = [&](Optional<int64_t> size) {
+        if (totalSize && size)
+          totalSize = *totalSize + *size;
+        else
+          totalSize = llvm::None;
+      };
+      auto inputs = describeBuffers(func.getType().getInputs(), [&](int i) {
+        auto size = getSizeInBytesUpperBound(func.getArgument(i));
+        addToTotal(size);
+        return size;
+      });
+      // The outputs are returned by the single terminator of the function.
+      auto returnOp = func.front().getTerminator();
+      auto outputs = describeBuffers(func.getType().getResults(), [&](int i) {
+        return getSizeInBytesUpperBound(returnOp->getOperand(i));
+      });
+      auto activationSize = getPeakAllocatedSize(module, func);
+      addToTotal(activationSize);
+
+      entryPoints.push_back(llvm::json::Object{{"name", func.getName().str()},
+          {"inputs", std::move(inputs)}, {"outputs", std::move(outputs)},
+          {"activation_bytes", sizeToJSON(activationSize)},
+          {"total_bytes", sizeToJSON(totalSize)}});
+    });
+
+    llvm::json::Object footprint{{"constant_pool_bytes", constantPoolSize},
+        {"entry_points", std::move(entryPoints)}};
+    std::string json;
+    llvm::raw_string_ostream os(json);
+    os << llvm::json::Value(std::move(footprint));
+    module.setAttr(KrnlEntryPointOp::getMemoryFootprintAttrName(),
+        StringAttr::get(os.str(), &getContext()));
+  }
+
+private:
+  /*!
+   * Return the peak size of the buffers allocated and not yet freed by a
+   * function, including the buffers it returns and those allocated by the
+   * functions it calls, or llvm::None if a buffer is unbounded. Buffers
+   * allocated in loops are counted once, since they are freed in the
+   * iteration that allocates them.
+   */
+  Optional<int64_t> getPeakAllocatedSize(ModuleOp module, FuncOp func) {
+    int64_t liveSize = 0;
+    int64_t peakSize = 0;
+    bool bounded = true;
+    llvm::DenseMap<Value, int64_t> bufferSizes;
+    func.walk([&](Operation *op) {
+      if (auto allocOp = dyn_cast<AllocOp>(op)) {
+        auto size = getSizeInBytesUpperBound(allocOp.getResult());
+        if (!size) {
+          bounded = false;
+          return;
+        }
+        bufferSizes[allocOp.getResult()] = *size;
+        liveSize += *size;
+      } else if (auto deallocOp = dyn_cast<DeallocOp>(op)) {
+        liveSize -= bufferSizes.lookup(deallocOp.memref());
+      } else if (auto callOp = dyn_cast<CallOp>(op)) {
+        auto callee = module.lookupSymbol<FuncOp>(callOp.getCallee());
+        auto calleeSize =
+            callee ? getPeakAllocatedSize(module, callee) : llvm::None;
+        if (!calleeSize) {
+          bounded = false;
+          return;
+        }
+        peakSize = std::max(peakSize, liveSize + *calleeSize);
+        // The results are allocated by the callee and freed by the caller.
+        for (auto result : callOp.getResults()) {
+          if (!result.getType().isa<MemRefType>())
+            continue;
+          auto size = getSizeInBytesUpperBound(result);
+          if (!size) {
+            bounded = false;
+            return;
+          }
+          bufferSizes[result] = *size;
+          liveSize += *size;
+        }
+      }
+      peakSize = std::max(peakSize, liveSize);
+    });
+    if (!bounded)
+      return llvm::None;
+    return peakSize;
+  }
+};
+} // end anonymous namespace
+
+/*!
+ * Create a memory footprint pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createMemoryFootprintPass() {
+  return std::make_unique<MemoryFootprintPass>();
+}
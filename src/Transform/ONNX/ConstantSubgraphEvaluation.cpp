@@ -0,0 +1,367 @@
+//===--- ConstantSubgraphEvaluation.cpp - Evaluate constant subgraphs -----===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a module level pass that evaluates at compile time the
+// operations whose inputs are all constants, and replaces their results by
+// constants.
+//
+// Unlike the rules of ConstProp.td, which fold a few operations one at a time,
+// the pass evaluates any operation that can be lowered. The operations of a
+// function whose inputs are constants form a subgraph that is outlined into a
+// module of its own, lowered to LLVM with the regular pipeline and run once by
+// the JIT. The values this subgraph computes for the rest of the function
+// become ONNX constants. If the subgraph cannot be evaluated as a whole, e.g.
+// because one of its operations has no lowering, the operations that can be
+// lowered are evaluated together, so that the JIT is created at most twice per
+// function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
+#include "mlir/Conversion/SCFToStandard/SCFToStandard.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Support/TargetSelect.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+#include "src/Pass/Remarks.hpp"
+#include "src/Runtime/RuntimeBitcode.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ * Helper function returning the size in bytes of an element of the types the
+ * pass can read back from the JIT, or 0 for other types.
+ */
+int64_t getSupportedElementSize(Type type) {
+  auto tensorType = type.dyn_cast<RankedTensorType>();
+  if (!tensorType || !tensorType.hasStaticShape())
+    return 0;
+  auto elementType = tensorType.getElementType();
+  if (elementType.isF32() || elementType.isF64())
+    return elementType.getIntOrFloatBitWidth() / 8;
+  if (auto intType = elementType.dyn_cast<IntegerType>()) {
+    auto width = intType.getWidth();
+    if (width == 8 || width == 16 || width == 32 || width == 64)
+      return width / 8;
+  }
+  return 0;
+}
+
+int64_t getSizeInBytes(Type type) {
+  auto tensorType = type.cast<RankedTensorType>();
+  return tensorType.getNumElements() * getSupportedElementSize(type);
+}
+
+/*!
+ * Helper function to check whether a value is a constant the pass can read.
+ */
+bool isConstant(Value value) {
+  auto constantOp = dyn_cast_or_null<ONNXConstantOp>(value.getDefiningOp());
+  return constantOp && constantOp.valueAttr() &&
+         constantOp.valueAttr().isa<DenseElementsAttr>() &&
+         getSupportedElementSize(value.getType());
+}
+
+/*!
+ *  Module pass that evaluates the constant subgraphs of the functions.
+ */
+class ConstantSubgraphEvaluationPass
+    : public PassWrapper<ConstantSubgraphEvaluationPass,
+          OperationPass<ModuleOp>> {
+public:
+  void runOnOperation() override {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    SmallVector<FuncOp, 4> funcs(getOperation().getOps<FuncOp>());
+    for (auto func : funcs) {
+      auto subgraph = collectConstantSubgraph(func);
+      if (subgraph.empty() || evaluate(subgraph.getArrayRef()))
+        continue;
+      // Keep the operations that can be lowered on their own and whose
+      // operands are constants or results of operations kept before, and
+      // evaluate them with a single JIT.
+      llvm::SetVector<Operation *> lowerable;
+      for (auto *op : subgraph) {
+        bool readyOperands =
+            llvm::all_of(op->getOperands(), [&](Value operand) {
+              return isConstant(operand) ||
+                     lowerable.count(operand.getDefiningOp());
+            });
+        if (readyOperands && canLower(op))
+          lowerable.insert(op);
+        else
+          emitOptimizationRemark(op, "constant-subgraph-eval",
+              "ConstantEvaluation", RemarkKind::Missed,
+              "the operation or one of its operands cannot be lowered");
+      }
+      if (lowerable.empty() || evaluate(lowerable.getArrayRef()))
+        continue;
+      for (auto *op : lowerable)
+        emitOptimizationRemark(op, "constant-subgraph-eval",
+            "ConstantEvaluation", RemarkKind::Missed,
+            "the subgraph of the operation cannot be evaluated");
+    }
+  }
+
+private:
+  /*!
+   * Collect, in order, the operations at the top level of a function whose
+   * operands are constants or results of operations collected before.
+   */
+  llvm::SetVector<Operation *> collectConstantSubgraph(FuncOp func) {
+    llvm::SetVector<Operation *> subgraph;
+    for (auto &op : func.getBody().getOps()) {
+      auto *onnxDialect = getContext().getRegisteredDialect<ONNXOpsDialect>();
+      if (isa<ONNXConstantOp>(op) || op.getNumOperands() == 0 ||
+          op.getNumRegions() != 0 || op.getDialect() != onnxDialect)
+        continue;
+      // Operations drawing random values must be run at every inference.
+      if (isa<ONNXRandomNormalLikeOp>(op) ||
+          isa<ONNXRandomUniformLikeOp>(op) || isa<ONNXMultinomialOp>(op))
+        continue;
+      bool constantInputs = llvm::all_of(op.getOperands(), [&](Value operand) {
+        return isConstant(operand) ||
+               subgraph.count(operand.getDefiningOp());
+      });
+      if (!constantInputs)
+        continue;
+      // Results that are larger than the operands, e.g. of Expand or Tile,
+      // are cheaper to compute at inference time than to store.
+      int64_t inputSize = 0;
+      int64_t outputSize = 0;
+      for (auto operand : op.getOperands())
+        inputSize += getSizeInBytes(operand.getType());
+      bool supportedResults = true;
+      for (auto result : op.getResults()) {
+        if (!getSupportedElementSize(result.getType())) {
+          supportedResults = false;
+          break;
+        }
+        outputSize += getSizeInBytes(result.getType());
+      }
+      if (supportedResults && outputSize <= inputSize)
+        subgraph.insert(&op);
+      else if (supportedResults)
+        emitOptimizationRemark(&op, "constant-subgraph-eval",
+            "ConstantEvaluation", RemarkKind::Missed,
+            "the results are larger than the operands");
+    }
+    return subgraph;
+  }
+
+  /*!
+   * Evaluate a subgraph and replace the values it computes for other
+   * operations by constants. Returns whether the subgraph could be evaluated.
+   */
+  bool evaluate(ArrayRef<Operation *> subgraph) {
+    llvm::SmallPtrSet<Operation *, 32> inSubgraph(
+        subgraph.begin(), subgraph.end());
+    SmallVector<Value, 8> outputs;
+    for (auto *op : subgraph)
+      for (auto result : op->getResults())
+        if (llvm::any_of(result.getUsers(), [&](Operation *user) {
+              return !inSubgraph.count(user);
+            }))
+          outputs.emplace_back(result);
+    if (outputs.empty())
+      return true;
+
+    SmallVector<DenseElementsAttr, 8> values;
+    {
+      // Operations that cannot be evaluated are left as they are, so their
+      // errors are not reported.
+      ScopedDiagnosticHandler silence(
+          &getContext(), [](Diagnostic &) { return success(); });
+      if (!run(subgraph, outputs, values))
+        return false;
+    }
+
+    for (int i = 0; i < outputs.size(); ++i) {
+      OpBuilder builder(outputs[i].getDefiningOp());
+      auto constantOp = builder.create<ONNXConstantOp>(
+          outputs[i].getLoc(), outputs[i].getType(), nullptr, values[i]);
+      outputs[i].replaceAllUsesWith(constantOp.getResult());
+    }
+
+    // Erase the subgraph, and the constants only it used.
+    llvm::SetVector<Operation *> inputs;
+    for (auto *op : llvm::reverse(subgraph)) {
+      emitOptimizationRemark(op, "constant-subgraph-eval",
+          "ConstantEvaluation", RemarkKind::Applied,
+          "evaluated at compile time");
+      for (auto operand : op->getOperands())
+        if (isa<ONNXConstantOp>(operand.getDefiningOp()))
+          inputs.insert(operand.getDefiningOp());
+      op->erase();
+    }
+    for (auto *input : inputs)
+      if (input->use_empty())
+        input->erase();
+    return true;
+  }
+
+  /*!
+   * Check whether an operation can be lowered to LLVM on its own, without
+   * creating a JIT to run it.
+   */
+  bool canLower(Operation *op) {
+    ScopedDiagnosticHandler silence(
+        &getContext(), [](Diagnostic &) { return success(); });
+    SmallVector<Value, 4> results(op->getResults());
+    return static_cast<bool>(lower({op}, results));
+  }
+
+  /*!
+   * Outline a subgraph into a function of its own module returning the
+   * outputs, and lower this module to LLVM. The operands defined neither by
+   * constants nor in the subgraph become arguments of the function. Returns a
+   * null module if the subgraph cannot be lowered.
+   */
+  OwningModuleRef lower(
+      ArrayRef<Operation *> subgraph, ArrayRef<Value> outputs) {
+    auto loc = subgraph.front()->getLoc();
+    OwningModuleRef module(ModuleOp::create(loc));
+    // The kernel library can only be called if the runtime bitcode, which the
+    // JIT links into the module, is available.
+    auto kernelLibraryAttrName = KrnlCallKernelOp::getKernelLibraryAttrName();
+    if (getOperation().getAttr(kernelLibraryAttrName) &&
+        onnx_mlir::getRuntimeBitcodePath())
+      module->setAttr(kernelLibraryAttrName, UnitAttr::get(&getContext()));
+    llvm::SmallPtrSet<Operation *, 32> inSubgraph(
+        subgraph.begin(), subgraph.end());
+    llvm::SetVector<Value> arguments;
+    for (auto *op : subgraph)
+      for (auto operand : op->getOperands())
+        if (!isConstant(operand) && !inSubgraph.count(operand.getDefiningOp()))
+          arguments.insert(operand);
+    SmallVector<Type, 4> argumentTypes;
+    for (auto argument : arguments)
+      argumentTypes.emplace_back(argument.getType());
+    SmallVector<Type, 8> outputTypes;
+    for (auto output : outputs)
+      outputTypes.emplace_back(output.getType());
+    OpBuilder builder(&getContext());
+    auto func = FuncOp::create(loc, "constant_subgraph",
+        builder.getFunctionType(argumentTypes, outputTypes));
+    module->push_back(func);
+    auto *entryBlock = func.addEntryBlock();
+    builder.setInsertionPointToStart(entryBlock);
+
+    BlockAndValueMapping mapping;
+    for (auto argument : llvm::enumerate(arguments))
+      mapping.map(argument.value(), entryBlock->getArgument(argument.index()));
+    for (auto *op : subgraph) {
+      for (auto operand : op->getOperands())
+        if (!mapping.contains(operand))
+          builder.clone(*operand.getDefiningOp(), mapping);
+      builder.clone(*op, mapping);
+    }
+    SmallVector<Value, 8> results;
+    for (auto output : outputs)
+      results.emplace_back(mapping.lookup(output));
+    builder.create<ReturnOp>(loc, results);
+
+    // The constants stay in LLVM globals, rather than being packed into a
+    // constant pool loaded by the runtime.
+    PassManager pm(&getContext());
+    pm.addPass(createLowerToKrnlPass());
+    pm.addPass(createCanonicalizerPass());
+    pm.addPass(createLowerKrnlPass());
+    pm.addPass(createLowerAffinePass());
+    pm.addPass(createLowerToCFGPass());
+    pm.addPass(createKrnlLowerToLLVMPass());
+    if (failed(pm.run(*module)))
+      return nullptr;
+    return module;
+  }
+
+  /*!
+   * Lower a subgraph, run it with the JIT and read the outputs back.
+   */
+  bool run(ArrayRef<Operation *> subgraph, ArrayRef<Value> outputs,
+      SmallVectorImpl<DenseElementsAttr> &values) {
+    auto module = lower(subgraph, outputs);
+    if (!module)
+      return false;
+    SmallVector<Type, 8> outputTypes;
+    for (auto output : outputs)
+      outputTypes.emplace_back(output.getType());
+
+    // The runtime functions the module calls are linked from the runtime
+    // bitcode and optimized together with it.
+    auto optimize = makeOptimizingTransformer(
+        /*optLevel=*/3, /*sizeLevel=*/0, /*targetMachine=*/nullptr);
+    auto maybeEngine =
+        ExecutionEngine::create(*module, [&](llvm::Module *llvmModule) {
+          if (auto error = onnx_mlir::linkRuntimeBitcode(*llvmModule))
+            return error;
+          return optimize(llvmModule);
+        });
+    if (!maybeEngine) {
+      llvm::consumeError(maybeEngine.takeError());
+      return false;
+    }
+
+    // The function returns a memref descriptor per output, each holding the
+    // allocated and aligned pointers, the offset, the sizes and the strides,
+    // all of them 8 bytes wide.
+    int64_t numWords = 0;
+    for (auto type : outputTypes)
+      numWords += 3 + 2 * type.cast<RankedTensorType>().getRank();
+    SmallVector<int64_t, 32> descriptors(numWords);
+    SmallVector<void *, 1> args = {descriptors.data()};
+    if (auto error = (*maybeEngine)->invokePacked("constant_subgraph", args)) {
+      llvm::consumeError(std::move(error));
+      return false;
+    }
+
+    // The buffers of the outputs are not freed, since an output may be an
+    // LLVM global of the module.
+    int64_t *descriptor = descriptors.data();
+    for (auto type : outputTypes) {
+      auto tensorType = type.cast<RankedTensorType>();
+      int64_t rank = tensorType.getRank();
+      int64_t elementSize = getSupportedElementSize(type);
+      // Only contiguous buffers are read.
+      int64_t stride = 1;
+      for (int64_t d = rank - 1; d >= 0; --d) {
+        int64_t dimSize = tensorType.getDimSize(d);
+        if (dimSize != 1 && descriptor[3 + rank + d] != stride)
+          return false;
+        stride *= dimSize;
+      }
+      auto *data = (const char *)descriptor[1] + descriptor[2] * elementSize;
+      values.emplace_back(DenseElementsAttr::getFromRawBuffer(tensorType,
+          ArrayRef<char>(data, tensorType.getNumElements() * elementSize),
+          /*isSplatBuffer=*/false));
+      descriptor += 3 + 2 * rank;
+    }
+    return true;
+  }
+};
+} // end anonymous namespace
+
+/*!
+ * Create a constant subgraph evaluation pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createConstantSubgraphEvaluationPass() {
+  return std::make_unique<ConstantSubgraphEvaluationPass>();
+}
@@ -0,0 +1,193 @@
+//===-------- OutlineONNXOps.cpp - Outline operations into functions ------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a module level pass that outlines every operation of
+// the entry functions into a function of its own, named after the type of the
+// operation and the name of the ONNX node it was imported from, e.g.
+// `onnx_Conv_conv1`.
+//
+// Once lowered, the loop nests of an operation stay in its function, which is
+// an exported symbol of the compiled model. Standard profilers such as `perf`
+// then attribute the time spent in a model to its nodes without any debug
+// information. The outlined functions only compute their results: the entry
+// function keeps the ownership of their arguments and frees their results.
+// They are marked noinline, since the LLVM inliner would otherwise fold these
+// functions, each called once, back into the entry function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/SetVector.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+#include "src/Pass/Remarks.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ * Helper function replacing the characters of a name that cannot appear in
+ * a C symbol.
+ */
+std::string legalizeSymbolName(StringRef name) {
+  std::string symbolName = name.str();
+  for (auto &c : symbolName)
+    if (!isalnum(c) && c != '_')
+      c = '_';
+  return symbolName;
+}
+
+/*!
+ * Helper function to check whether a value can be passed to an outlined
+ * function, i.e. whether its type is lowered to a memref.
+ */
+bool isRankedTensor(Value value) {
+  return value.getType().isa<RankedTensorType>();
+}
+
+/*!
+ *  Module pass that outlines the operations of the entry functions.
+ */
+class OutlineONNXOpsPass
+    : public PassWrapper<OutlineONNXOpsPass, OperationPass<ModuleOp>> {
+public:
+  void runOnOperation() override {
+    auto module = getOperation();
+    SmallVector<FuncOp, 4> entryFuncs;
+    module.walk([&](ONNXEntryPointOp entryPointOp) {
+      auto funcAttr = entryPointOp.getAttrOfType<SymbolRefAttr>(
+          ONNXEntryPointOp::getEntryPointFuncAttrName());
+      if (auto func = module.lookupSymbol<FuncOp>(funcAttr.getLeafReference()))
+        entryFuncs.emplace_back(func);
+    });
+
+    for (auto func : entryFuncs) {
+      if (func.getBlocks().size() != 1)
+        continue;
+      SmallVector<Operation *, 32> ops;
+      for (auto &op : func.front().without_terminator())
+        if (isOutlinable(&op))
+          ops.emplace_back(&op);
+      for (auto *op : ops)
+        outline(module, op);
+    }
+  }
+
+private:
+  /*!
+   * Check whether an operation computes tensors that can be outlined. Control
+   * flow operations, whose regions use values of the function, constants and
+   * operations whose lowering returns one of their operands are left in the
+   * entry function.
+   */
+  bool isOutlinable(Operation *op) {
+    auto *onnxDialect = getContext().getRegisteredDialect<ONNXOpsDialect>();
+    if (op->getDialect() != onnxDialect || op->getNumRegions() != 0 ||
+        isa<ONNXConstantOp>(op) || isa<ONNXIdentityOp>(op))
+      return false;
+    // The key/value caches extend the inputs of the entry function in place.
+    auto module = op->getParentOfType<ModuleOp>();
+    if (isa<ONNXConcatOp>(op) &&
+        module.getAttr(ONNXEntryPointOp::getKVCacheAttrName()))
+      return false;
+    for (auto operand : op->getOperands())
+      if (!isRankedTensor(operand) && !operand.getType().isa<NoneType>())
+        return false;
+    for (auto result : op->getResults())
+      if (!isRankedTensor(result) && !result.getType().isa<NoneType>())
+        return false;
+    return true;
+  }
+
+  /*!
+   * Outline an operation into a new function taking its tensor operands and
+   * returning its used results, and replace it by a call to this function.
+   */
+  void outline(ModuleOp module, Operation *op) {
+    llvm::SetVector<Value> inputs;
+    for (auto operand : op->getOperands())
+      if (isRankedTensor(operand))
+        inputs.insert(operand);
+    SmallVector<Value, 4> outputs;
+    for (auto result : op->getResults())
+      if (isRankedTensor(result) && !result.use_empty())
+        outputs.emplace_back(result);
+    if (outputs.empty())
+      return;
+
+    SmallVector<Type, 4> inputTypes;
+    for (auto input : inputs)
+      inputTypes.emplace_back(input.getType());
+    SmallVector<Type, 4> outputTypes;
+    for (auto output : outputs)
+      outputTypes.emplace_back(output.getType());
+
+    OpBuilder builder(&getContext());
+    auto loc = op->getLoc();
+    auto func = FuncOp::create(loc, getFunctionName(module, op),
+        builder.getFunctionType(inputTypes, outputTypes));
+    func.setAttr(
+        ONNXEntryPointOp::getOutlinedOpAttrName(), builder.getUnitAttr());
+    func.setAttr("passthrough", builder.getStrArrayAttr({"noinline"}));
+    module.push_back(func);
+    auto *entryBlock = func.addEntryBlock();
+    builder.setInsertionPointToStart(entryBlock);
+
+    // Absent optional operands are not passed but recreated in the function.
+    BlockAndValueMapping mapping;
+    for (int i = 0; i < inputs.size(); ++i)
+      mapping.map(inputs[i], entryBlock->getArgument(i));
+    for (auto operand : op->getOperands())
+      if (!mapping.contains(operand))
+        builder.clone(*operand.getDefiningOp(), mapping);
+    builder.clone(*op, mapping);
+    SmallVector<Value, 4> results;
+    for (auto output : outputs)
+      results.emplace_back(mapping.lookup(output));
+    builder.create<ReturnOp>(loc, results);
+
+    builder.setInsertionPoint(op);
+    auto callOp = builder.create<CallOp>(loc, func, inputs.getArrayRef());
+    for (int i = 0; i < outputs.size(); ++i)
+      outputs[i].replaceAllUsesWith(callOp.getResult(i));
+    op->erase();
+  }
+
+  /*!
+   * Return a name for the function outlined from an operation that is not
+   * used by another symbol of the module.
+   */
+  std::string getFunctionName(ModuleOp module, Operation *op) {
+    auto opName = op->getName().getStringRef();
+    opName.consume_front("onnx.");
+    auto nodeName = getONNXNodeName(op->getLoc());
+    std::string name = "onnx_" + legalizeSymbolName(opName) + "_" +
+                       (nodeName.empty() ? std::to_string(counter++)
+                                         : legalizeSymbolName(nodeName));
+    if (!module.lookupSymbol(name))
+      return name;
+    for (int suffix = 1;; ++suffix) {
+      auto uniqueName = name + "_" + std::to_string(suffix);
+      if (!module.lookupSymbol(uniqueName))
+        return uniqueName;
+    }
+  }
+
+  int64_t counter = 0;
+};
+} // end anonymous namespace
+
+/*!
+ * Create an ONNX operation outlining pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createOutlineONNXOpsPass() {
+  return std::make_unique<OutlineONNXOpsPass>();
+}
@@ -0,0 +1,267 @@
+//===------ PipelinePartition.cpp - Partition a model into stages ---------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a module level pass that partitions the main graph of
+// a model into a given number of pipeline stages of balanced estimated cost.
+//
+// The operations of the main graph are split, in order, into consecutive
+// stages. Every stage becomes a function with its own entry point, taking the
+// values live at its start and returning the values live at its end: the
+// first stage takes the inputs of the model, and the last one returns its
+// outputs. A runtime pipeline can then run every stage on its own cores, so
+// that as many requests as there are stages are in flight at once. Constants
+// are not passed between stages but materialized in every stage using them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ * Helper function returning the number of elements of a value, counting
+ * dynamic dimensions as 1.
+ */
+int64_t getNumElements(Value value) {
+  auto type = value.getType().dyn_cast<RankedTensorType>();
+  if (!type)
+    return 1;
+  int64_t numElements = 1;
+  for (auto dim : type.getShape())
+    numElements *= std::max<int64_t>(dim, 1);
+  return numElements;
+}
+
+/*!
+ * Estimate the cost of a single operation as the number of elements it
+ * produces, multiplied by the number of multiply-accumulates per element for
+ * convolutions and matrix multiplications.
+ */
+int64_t estimateOpCost(Operation *op) {
+  int64_t cost = 0;
+  for (auto result : op->getResults())
+    cost += getNumElements(result);
+
+  if (auto convOp = dyn_cast<ONNXConvOp>(op)) {
+    // Every output element accumulates over a window of all the input
+    // channels of its group.
+    if (auto wType = convOp.W().getType().dyn_cast<RankedTensorType>())
+      cost *= getNumElements(convOp.W()) / std::max<int64_t>(
+                                              wType.getShape()[0], 1);
+  } else if (auto matMulOp = dyn_cast<ONNXMatMulOp>(op)) {
+    if (auto aType = matMulOp.A().getType().dyn_cast<RankedTensorType>())
+      cost *= std::max<int64_t>(aType.getShape().back(), 1);
+  } else if (auto gemmOp = dyn_cast<ONNXGemmOp>(op)) {
+    if (auto aType = gemmOp.A().getType().dyn_cast<RankedTensorType>())
+      cost *= std::max<int64_t>(
+          aType.getShape()[gemmOp.transA() == 0 ? 1 : 0], 1);
+  }
+  return cost;
+}
+
+/*!
+ * Estimate the cost of an operation of the main graph, including the
+ * operations nested in its regions.
+ */
+int64_t estimateCost(Operation *op) {
+  int64_t cost = 0;
+  op->walk([&](Operation *nestedOp) { cost += estimateOpCost(nestedOp); });
+  return std::max<int64_t>(cost, 1);
+}
+
+/*!
+ * Helper function to check whether an operation is a constant, which is
+ * materialized in every stage using it rather than passed between stages.
+ */
+bool isRematerializable(Operation *op) {
+  return isa<ONNXConstantOp>(op) || isa<ConstantOp>(op);
+}
+
+/*!
+ *  Module pass that partitions the main graph into pipeline stages.
+ */
+class PipelinePartitionPass
+    : public PassWrapper<PipelinePartitionPass, OperationPass<ModuleOp>> {
+public:
+  PipelinePartitionPass(int numStages) : numStages(numStages) {}
+
+  void runOnOperation() override {
+    auto module = getOperation();
+    auto mainFunc = module.lookupSymbol<FuncOp>("main_graph");
+    if (!mainFunc || numStages < 2 || mainFunc.getBlocks().size() != 1)
+      return;
+    ONNXEntryPointOp mainEntryPoint;
+    module.walk([&](ONNXEntryPointOp entryPointOp) {
+      auto funcAttr = entryPointOp.getAttrOfType<SymbolRefAttr>(
+          ONNXEntryPointOp::getEntryPointFuncAttrName());
+      if (funcAttr.getLeafReference() == mainFunc.getName())
+        mainEntryPoint = entryPointOp;
+    });
+    if (!mainEntryPoint)
+      return;
+
+    Block &body = mainFunc.front();
+    SmallVector<Operation *, 32> ops;
+    SmallVector<int64_t, 32> costs;
+    int64_t totalCost = 0;
+    for (auto &op : body.without_terminator()) {
+      if (isRematerializable(&op))
+        continue;
+      ops.emplace_back(&op);
+      costs.emplace_back(estimateCost(&op));
+      totalCost += costs.back();
+    }
+    if (ops.size() < numStages)
+      return;
+
+    // Assign the operations to stages in order. A stage is closed once the
+    // cost of the operations up to it reaches its share of the total cost,
+    // keeping at least one operation for every remaining stage.
+    llvm::DenseMap<Operation *, int> stageOf;
+    int stage = 0;
+    int stageSize = 0;
+    int64_t prefixCost = 0;
+    for (int i = 0; i < ops.size(); ++i) {
+      int remainingStages = numStages - 1 - stage;
+      bool shareReached = prefixCost * numStages >= (stage + 1) * totalCost;
+      if (stageSize > 0 && remainingStages > 0 &&
+          (shareReached || ops.size() - i == remainingStages)) {
+        ++stage;
+        stageSize = 0;
+      }
+      stageOf[ops[i]] = stage;
+      ++stageSize;
+      prefixCost += costs[i];
+    }
+
+    // The values passed from a stage to the next are the inputs of the model
+    // and the results of the operations of previous stages that are still
+    // used by a later stage or returned.
+    auto returnOp = body.getTerminator();
+    auto getLastUse = [&](Value value) {
+      int lastUse = -1;
+      for (auto *user : value.getUsers()) {
+        auto *userInBody = body.findAncestorOpInBlock(*user);
+        if (userInBody == returnOp)
+          return numStages;
+        if (stageOf.count(userInBody))
+          lastUse = std::max(lastUse, stageOf[userInBody]);
+      }
+      return lastUse;
+    };
+    SmallVector<SmallVector<Value, 8>, 4> liveOut(numStages);
+    auto addLiveValue = [&](Value value, int defStage) {
+      int lastUse = getLastUse(value);
+      for (int s = std::max(defStage, 0); s < std::min(lastUse, numStages); ++s)
+        liveOut[s].emplace_back(value);
+    };
+    for (auto arg : body.getArguments())
+      addLiveValue(arg, 0);
+    for (auto *op : ops)
+      for (auto result : op->getResults())
+        addLiveValue(result, stageOf[op]);
+
+    OpBuilder builder(&getContext());
+    SmallVector<Value, 8> stageInputs(
+        body.getArguments().begin(), body.getArguments().end());
+    for (int s = 0; s < numStages; ++s) {
+      SmallVector<Value, 8> stageOutputs;
+      if (s == numStages - 1)
+        stageOutputs.assign(
+            returnOp->getOperands().begin(), returnOp->getOperands().end());
+      else
+        stageOutputs.assign(liveOut[s].begin(), liveOut[s].end());
+      createStage(module, builder, body, s, stageInputs, stageOutputs,
+          [&](Operation *op) { return stageOf.lookup(op) == s; });
+      stageInputs = stageOutputs;
+    }
+
+    module.setAttr(ONNXEntryPointOp::getPipelineStagesAttrName(),
+        builder.getI64IntegerAttr(numStages));
+    mainEntryPoint.erase();
+    mainFunc.erase();
+  }
+
+private:
+  /*!
+   * Create the function of stage `s`, holding the operations of `body` that
+   * belong to it, and its entry point.
+   */
+  void createStage(ModuleOp module, OpBuilder &builder, Block &body, int s,
+      ArrayRef<Value> inputs, ArrayRef<Value> outputs,
+      llvm::function_ref<bool(Operation *)> inStage) {
+    SmallVector<Type, 8> inputTypes;
+    for (auto input : inputs)
+      inputTypes.emplace_back(input.getType());
+    SmallVector<Type, 8> outputTypes;
+    for (auto output : outputs)
+      outputTypes.emplace_back(output.getType());
+
+    auto loc = body.getParentOp()->getLoc();
+    auto stageFunc = FuncOp::create(loc, "main_graph_stage" + std::to_string(s),
+        builder.getFunctionType(inputTypes, outputTypes));
+    auto *entryBlock = stageFunc.addEntryBlock();
+    builder.setInsertionPointToStart(entryBlock);
+    // The first stage takes the inputs of the model along with their
+    // attributes, e.g. the bounds of their dimensions.
+    if (s == 0) {
+      auto mainFunc = cast<FuncOp>(body.getParentOp());
+      for (int i = 0; i < inputs.size(); ++i)
+        stageFunc.setArgAttrs(i, mainFunc.getArgAttrs(i));
+    }
+
+    BlockAndValueMapping mapping;
+    for (int i = 0; i < inputs.size(); ++i)
+      mapping.map(inputs[i], entryBlock->getArgument(i));
+
+    // Materialize the constants used by the stage before their first use.
+    auto mapConstant = [&](Value value) {
+      auto *defOp = value.getDefiningOp();
+      if (!mapping.contains(value) && defOp && defOp->getBlock() == &body &&
+          isRematerializable(defOp))
+        builder.clone(*defOp, mapping);
+    };
+    for (auto &op : body.without_terminator()) {
+      if (!inStage(&op))
+        continue;
+      op.walk([&](Operation *nestedOp) {
+        for (auto operand : nestedOp->getOperands())
+          mapConstant(operand);
+      });
+      builder.clone(op, mapping);
+    }
+
+    SmallVector<Value, 8> results;
+    for (auto output : outputs) {
+      mapConstant(output);
+      results.emplace_back(mapping.lookup(output));
+    }
+    builder.create<ReturnOp>(loc, results);
+
+    module.push_back(stageFunc);
+    module.push_back(ONNXEntryPointOp::create(
+        loc, stageFunc, inputs.size(), outputs.size()));
+  }
+
+  int numStages;
+};
+} // end anonymous namespace
+
+/*!
+ * Create a pipeline partition pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createPipelinePartitionPass(int numStages) {
+  return std::make_unique<PipelinePartitionPass>(numStages);
+}
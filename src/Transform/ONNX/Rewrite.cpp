@@ -13,6 +13,7 @@
 #include "mlir/IR/PatternMatch.h"
 
 #include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Remarks.hpp"
 
 using namespace mlir;
 
@@ -41,6 +42,16 @@ ArrayAttr createArrayAttrOfZeros(
   return rewriter.getI64ArrayAttr(vals);
 }
 
+// Create the ArrayAttr of zeros replacing the pads of a convolution whose
+// padding is materialized by a Pad operation, and report it.
+ArrayAttr createConvPadsOfZeros(
+    PatternRewriter &rewriter, Value conv, ArrayAttr origAttrs) {
+  emitOptimizationRemark(conv.getDefiningOp(), "canonicalize", "ConvPadding",
+      RemarkKind::Applied,
+      "the padding of the convolution is materialized by a Pad operation");
+  return createArrayAttrOfZeros(rewriter, origAttrs);
+}
+
 DenseElementsAttr createDenseFloatAttrOfValue(
     PatternRewriter &rewriter, Value origValue, float constantValue) {
   Type elementType = origValue.getType().cast<TensorType>().getElementType();
@@ -0,0 +1,316 @@
+//===------ SiblingMatMulFusion.cpp - Fuse sibling matrix products --------===//
+//
+// Copyright 2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a function level pass that fuses sibling MatMul or
+// Gemm operations, which multiply the same input by different constant
+// weights, into a single operation.
+//
+// Attention blocks compute their queries, keys and values, and gated MLPs
+// their two projections, as separate products of the same activation, each
+// of them reading the activation again. The weights of the siblings are
+// concatenated at compile time along their output columns into one wider
+// weight, so that a single larger product reads the activation once. Its
+// result is then split along its last axis into the results of the
+// siblings:
+//
+//   %q = "onnx.MatMul"(%x, %wq)       %w = "onnx.Constant"() (%wq|%wk|%wv)
+//   %k = "onnx.MatMul"(%x, %wk)  ->   %qkv = "onnx.MatMul"(%x, %w)
+//   %v = "onnx.MatMul"(%x, %wv)       %q, %k, %v = "onnx.Split"(%qkv)
+//
+// The biases of sibling Gemm operations are concatenated in the same way.
+//
+// The lowering of the Split copies the fused result out into the results of
+// the siblings, reading and writing every output element once more. The
+// siblings are therefore only fused when the reads of the input they save
+// outweigh these copies.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <vector>
+
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SetVector.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+#include "src/Pass/Remarks.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ * Helper function returning the value of a constant operand, or nullptr if
+ * the operand is not a dense constant.
+ */
+DenseElementsAttr getConstantValue(Value value) {
+  auto constantOp = dyn_cast_or_null<ONNXConstantOp>(value.getDefiningOp());
+  if (!constantOp || !constantOp.valueAttr())
+    return nullptr;
+  return constantOp.valueAttr().dyn_cast<DenseElementsAttr>();
+}
+
+/*!
+ * Helper function concatenating constants of the same rank along an axis, by
+ * copying their raw buffers. Returns nullptr if the elements are not stored
+ * in whole bytes.
+ */
+DenseElementsAttr concatConstants(
+    ArrayRef<DenseElementsAttr> values, int64_t axis) {
+  auto firstType = values[0].getType();
+  auto elementType = firstType.getElementType();
+  if (!elementType.isIntOrFloat() || elementType.getIntOrFloatBitWidth() % 8)
+    return nullptr;
+  int64_t elementSize = elementType.getIntOrFloatBitWidth() / 8;
+  SmallVector<int64_t, 2> shape(
+      firstType.getShape().begin(), firstType.getShape().end());
+  shape[axis] = 0;
+  for (auto value : values)
+    shape[axis] += value.getType().getDimSize(axis);
+
+  // The elements of every value are interleaved by blocks of the dimensions
+  // from the axis on. A splat value stores a single element.
+  int64_t outerSize = 1;
+  for (int64_t i = 0; i < axis; ++i)
+    outerSize *= shape[i];
+  auto type = RankedTensorType::get(shape, elementType);
+  std::vector<char> result(type.getNumElements() * elementSize);
+  char *out = result.data();
+  for (int64_t outer = 0; outer < outerSize; ++outer)
+    for (auto value : values) {
+      auto rawData = value.getRawData();
+      int64_t blockSize =
+          value.getType().getNumElements() / outerSize * elementSize;
+      if (value.isSplat()) {
+        for (int64_t i = 0; i < blockSize; i += elementSize)
+          std::memcpy(out + i, rawData.data(), elementSize);
+      } else {
+        std::memcpy(out, rawData.data() + outer * blockSize, blockSize);
+      }
+      out += blockSize;
+    }
+  return DenseElementsAttr::getFromRawBuffer(
+      type, result, /*isSplatBuffer=*/false);
+}
+
+/*!
+ *  Function pass that fuses sibling MatMul and Gemm operations.
+ */
+class SiblingMatMulFusionPass
+    : public PassWrapper<SiblingMatMulFusionPass, FunctionPass> {
+public:
+  void runOnFunction() override {
+    // Gather the candidates by input, in order.
+    llvm::MapVector<Value, SmallVector<Operation *, 4>> siblings;
+    getFunction().walk([&](Operation *op) {
+      if (getWeightColumns(op) > 0)
+        siblings[op->getOperand(0)].emplace_back(op);
+    });
+
+    for (auto &entry : siblings) {
+      auto &candidates = entry.second;
+      while (!candidates.empty()) {
+        SmallVector<Operation *, 4> group;
+        SmallVector<Operation *, 4> others;
+        for (auto *op : candidates)
+          (areFusible(candidates.front(), op) ? group : others)
+              .emplace_back(op);
+        if (group.size() > 1 && isProfitable(group))
+          fuse(group);
+        candidates = others;
+      }
+    }
+  }
+
+private:
+  /*!
+   * Return the number of output columns of a MatMul or Gemm operation with
+   * a constant 2D weight, or 0 if the operation cannot be fused.
+   */
+  int64_t getWeightColumns(Operation *op) {
+    if (!isa<ONNXMatMulOp>(op) && !isa<ONNXGemmOp>(op))
+      return 0;
+    auto resultType = op->getResult(0).getType().dyn_cast<RankedTensorType>();
+    auto weight = getConstantValue(op->getOperand(1));
+    if (!resultType || resultType.getRank() < 1 || !weight ||
+        weight.getType().getRank() != 2 ||
+        !op->getOperand(0).getType().isa<RankedTensorType>())
+      return 0;
+    int64_t columns = resultType.getShape().back();
+    if (columns < 0)
+      return 0;
+
+    // The bias of a Gemm must be a vector over the output columns.
+    if (auto gemmOp = dyn_cast<ONNXGemmOp>(op)) {
+      if (gemmOp.C().getType().isa<NoneType>())
+        return columns;
+      auto bias = getConstantValue(gemmOp.C());
+      if (!bias || bias.getType().getNumElements() != columns ||
+          bias.getType().getShape().back() != columns)
+        return 0;
+    }
+    return columns;
+  }
+
+  /*!
+   * Check whether two candidates can be computed by a single operation.
+   */
+  bool areFusible(Operation *first, Operation *op) {
+    if (op->getName() != first->getName() ||
+        op->getBlock() != first->getBlock())
+      return false;
+    if (auto gemmOp = dyn_cast<ONNXGemmOp>(op)) {
+      auto firstGemmOp = cast<ONNXGemmOp>(first);
+      if (gemmOp.alpha().convertToFloat() !=
+              firstGemmOp.alpha().convertToFloat() ||
+          gemmOp.beta().convertToFloat() !=
+              firstGemmOp.beta().convertToFloat() ||
+          gemmOp.transA() != firstGemmOp.transA() ||
+          gemmOp.transB() != firstGemmOp.transB())
+        return false;
+    }
+
+    // The weights share their reduction dimension, and the results all but
+    // their last dimension.
+    auto firstType = first->getResult(0).getType().cast<RankedTensorType>();
+    auto type = op->getResult(0).getType().cast<RankedTensorType>();
+    int64_t reductionAxis = getColumnAxis(first) == 1 ? 0 : 1;
+    return getConstantValue(op->getOperand(1)).getType().getDimSize(
+               reductionAxis) == getConstantValue(first->getOperand(1))
+                                     .getType()
+                                     .getDimSize(reductionAxis) &&
+           type.getElementType() == firstType.getElementType() &&
+           type.getShape().drop_back() == firstType.getShape().drop_back();
+  }
+
+  /*!
+   * Check whether fusing a group pays off. For every row of the input, the
+   * fused operation reads the K elements of the row once instead of once per
+   * sibling, while the Split reads and writes the sum of the output columns
+   * again.
+   */
+  bool isProfitable(ArrayRef<Operation *> group) {
+    auto *first = group.front();
+    int64_t reductionAxis = getColumnAxis(first) == 1 ? 0 : 1;
+    auto weightType = getConstantValue(first->getOperand(1)).getType();
+    int64_t savedReads =
+        (group.size() - 1) * weightType.getDimSize(reductionAxis);
+    int64_t columns = 0;
+    for (auto *op : group)
+      columns += getWeightColumns(op);
+    if (savedReads > 2 * columns)
+      return true;
+    for (auto *op : group)
+      emitOptimizationRemark(op, "fuse-sibling-matmuls",
+          "HorizontalFusion", RemarkKind::Missed,
+          "splitting the fused result would cost more than the reads of the "
+          "input it saves");
+    return false;
+  }
+
+  /*!
+   * Return the axis of the output columns in the weight of an operation.
+   */
+  int64_t getColumnAxis(Operation *op) {
+    auto gemmOp = dyn_cast<ONNXGemmOp>(op);
+    return gemmOp && gemmOp.transB() != 0 ? 0 : 1;
+  }
+
+  /*!
+   * Replace a group of fusible siblings by a single operation, inserted at
+   * the first of them, whose result is split into their results.
+   */
+  void fuse(ArrayRef<Operation *> group) {
+    auto *first = group.front();
+    for (auto *op : group)
+      if (op->isBeforeInBlock(first))
+        first = op;
+    OpBuilder builder(first);
+    auto loc = builder.getFusedLoc(llvm::to_vector<4>(
+        llvm::map_range(group, [](Operation *op) { return op->getLoc(); })));
+
+    SmallVector<DenseElementsAttr, 4> weights;
+    SmallVector<int64_t, 4> columns;
+    SmallVector<Type, 4> resultTypes;
+    for (auto *op : group) {
+      weights.emplace_back(getConstantValue(op->getOperand(1)));
+      columns.emplace_back(getWeightColumns(op));
+      resultTypes.emplace_back(op->getResult(0).getType());
+    }
+    auto weight = concatConstants(weights, getColumnAxis(first));
+    if (!weight)
+      return;
+    Value fusedWeight =
+        builder.create<ONNXConstantOp>(loc, weight.getType(), nullptr, weight);
+
+    // Absent biases of the Gemm siblings of a Gemm with a bias are zeros.
+    Value fusedBias;
+    if (isa<ONNXGemmOp>(first) &&
+        llvm::any_of(group, [](Operation *op) {
+          return !op->getOperand(2).getType().isa<NoneType>();
+        })) {
+      auto elementType =
+          resultTypes.front().cast<RankedTensorType>().getElementType();
+      SmallVector<DenseElementsAttr, 4> biases;
+      for (int i = 0; i < group.size(); ++i) {
+        auto biasType = RankedTensorType::get({columns[i]}, elementType);
+        auto bias = getConstantValue(group[i]->getOperand(2));
+        biases.emplace_back(bias ? bias.reshape(biasType)
+                                 : DenseElementsAttr::get(biasType,
+                                       builder.getZeroAttr(elementType)));
+      }
+      auto bias = concatConstants(biases, 0);
+      fusedBias =
+          builder.create<ONNXConstantOp>(loc, bias.getType(), nullptr, bias);
+    }
+
+    auto fusedOp = builder.clone(*first);
+    fusedOp->setLoc(loc);
+    fusedOp->setOperand(1, fusedWeight);
+    if (fusedBias)
+      fusedOp->setOperand(2, fusedBias);
+
+    auto firstType = resultTypes.front().cast<RankedTensorType>();
+    SmallVector<int64_t, 4> shape(
+        firstType.getShape().begin(), firstType.getShape().end());
+    shape.back() = 0;
+    for (auto n : columns)
+      shape.back() += n;
+    fusedOp->getResult(0).setType(
+        RankedTensorType::get(shape, firstType.getElementType()));
+    auto splitOp = builder.create<ONNXSplitOp>(loc, resultTypes,
+        fusedOp->getResult(0), builder.getI64IntegerAttr(shape.size() - 1),
+        builder.getI64ArrayAttr(columns));
+
+    // Replace the siblings, and erase the weights only they used.
+    llvm::SetVector<Operation *> constants;
+    for (int i = 0; i < group.size(); ++i) {
+      emitOptimizationRemark(group[i], "fuse-sibling-matmuls",
+          "HorizontalFusion", RemarkKind::Applied,
+          Twine("fused with ") + Twine(group.size() - 1) +
+              " sibling operations reading the same input");
+      group[i]->getResult(0).replaceAllUsesWith(splitOp.getResult(i));
+      for (auto operand : group[i]->getOperands().drop_front())
+        if (getConstantValue(operand))
+          constants.insert(operand.getDefiningOp());
+      group[i]->erase();
+    }
+    for (auto *constant : constants)
+      if (constant->use_empty())
+        constant->erase();
+  }
+};
+} // end anonymous namespace
+
+/*!
+ * Create a sibling MatMul fusion pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createSiblingMatMulFusionPass() {
+  return std::make_unique<SiblingMatMulFusionPass>();
+}
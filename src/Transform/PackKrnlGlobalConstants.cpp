@@ -12,12 +12,24 @@
 // run to obtain a compact representation of the program when emitting Krnl
 // dialect code. This pass should never be invoked on code meant to be run.
 //
+// When the packed constants are moved to a file, their layout can be written
+// next to it, to <file>.json, for tools analyzing the constants of a model:
+//
+//  {
+//    "size_in_bytes": <size of the file>,
+//    "is_le": <whether the constants are little endian>,
+//    "constants": [{"name": <global name>, "offset": <bytes>,
+//                   "size_in_bytes": <bytes>, "element_type": <e.g. "f32">,
+//                   "shape": [...]}, ...]
+//  }
+//
 //===----------------------------------------------------------------------===//
 #include <fstream>
 
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/Pass/Pass.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
 
 #include "src/Dialect/Krnl/KrnlOps.hpp"
 #include "src/Pass/Passes.hpp"
@@ -37,6 +49,9 @@ public:
   /// make sure that the options are initialized properly.
   PackKrnlGlobalConstantsPass() = default;
   PackKrnlGlobalConstantsPass(const PackKrnlGlobalConstantsPass &pass) {}
+  PackKrnlGlobalConstantsPass(bool writeIndex) {
+    this->writeIndex = writeIndex;
+  }
 
   void runOnOperation() override {
     auto module = getOperation();
@@ -44,6 +59,7 @@ public:
 
     // Packing constant arrays to packedConst.
     std::vector<char> packedConst;
+    llvm::json::Array index;
     module.walk([&](KrnlGlobalOp op) {
       assert(op.value());
       op.offsetAttr(builder.getI64IntegerAttr(packedConst.size()));
@@ -55,6 +71,14 @@ public:
 
       // TODO(tjingrant) verify we can actually use the raw data.
       std::vector<char> rawData = denseAttr.getRawData();
+      std::string elementType;
+      llvm::raw_string_ostream os(elementType);
+      os << denseAttr.getType().getElementType();
+      index.push_back(llvm::json::Object{{"name", op.name().str()},
+          {"offset", (int64_t)packedConst.size()},
+          {"size_in_bytes", (int64_t)rawData.size()},
+          {"element_type", os.str()},
+          {"shape", llvm::json::Array(denseAttr.getType().getShape())}});
       packedConst.insert(packedConst.end(), rawData.begin(), rawData.end());
     });
 
@@ -91,6 +115,19 @@ public:
       packedConstOp.file_nameAttr(builder.getStringAttr(pathStr));
       std::ofstream outfile(pathStr, std::ofstream::binary);
       outfile.write(packedConst.data(), packedConst.size());
+      if (writeIndex) {
+        llvm::json::Object layout{
+            {"size_in_bytes", (int64_t)packedConst.size()}, {"is_le", isLE},
+            {"constants", std::move(index)}};
+        std::error_code error;
+        llvm::raw_fd_ostream indexFile(pathStr + ".json", error);
+        if (error) {
+          module.emitError("cannot write " + pathStr + ".json: ")
+              << error.message();
+          return signalPassFailure();
+        }
+        indexFile << llvm::json::Value(std::move(layout)) << "\n";
+      }
     } else {
       auto shapeTy =
           RankedTensorType::get({static_cast<int64_t>(packedConst.size())},
@@ -116,11 +153,16 @@ public:
   Option<std::string> filename{*this, "filename",
       llvm::cl::desc(
           "Specify a file in which the packed constant is to be stored.")};
+  Option<bool> writeIndex{*this, "write-index",
+      llvm::cl::desc("Whether to write the offset, type and shape of every "
+                     "packed constant to <filename>.json."),
+      llvm::cl::init(false)};
 };
 } // namespace
 
-std::unique_ptr<Pass> mlir::createPackKrnlGlobalConstantsPass() {
-  return std::make_unique<PackKrnlGlobalConstantsPass>();
+std::unique_ptr<Pass> mlir::createPackKrnlGlobalConstantsPass(
+    bool writeIndex) {
+  return std::make_unique<PackKrnlGlobalConstantsPass>(writeIndex);
 }
 
 static PassRegistration<PackKrnlGlobalConstantsPass> pass("pack-krnl-constants",
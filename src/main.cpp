@@ -14,8 +14,6 @@ using namespace onnx_mlir;
 int main(int argc, char *argv[]) {
   registerDialects();
 
-  llvm::cl::OptionCategory OnnxMlirOptions(
-      "ONNX MLIR Options", "These are frontend options.");
   llvm::cl::opt<string> inputFilename(llvm::cl::Positional,
       llvm::cl::desc("<input file>"), llvm::cl::init("-"),
       llvm::cl::cat(OnnxMlirOptions));
@@ -33,9 +31,39 @@ int main(int argc, char *argv[]) {
           clEnumVal(EmitLLVMIR, "Lower model to LLVM IR (LLVM dialect)."),
           clEnumVal(EmitLib, "Lower model to LLVM IR, emit (to file) "
                              "LLVM bitcode for model, compile and link it to a "
-                             "shared library.")),
+                             "shared library."),
+          clEnumVal(EmitObj, "Lower model to LLVM IR and compile it to a "
+                             "relocatable object file embedding its "
+                             "constants, with prefixed symbols."),
+          clEnumVal(EmitStaticLib, "Lower model to LLVM IR and compile it to "
+                                   "a static library embedding its "
+                                   "constants, with prefixed symbols.")),
       llvm::cl::init(EmitLib), llvm::cl::cat(OnnxMlirOptions));
 
+  llvm::cl::opt<bool> donateInputs("donate-inputs",
+      llvm::cl::desc("Allow the model to overwrite its input buffers, which "
+                     "the caller then donates to the execution session."),
+      llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+  llvm::cl::list<string> kvCache("kv-cache",
+      llvm::cl::desc("Keep the key/value caches of an autoregressive model in "
+                     "the execution session between runs. Each cache is given "
+                     "as <past input>:<present output>:<concat axis>."),
+      llvm::cl::CommaSeparated, llvm::cl::cat(OnnxMlirOptions));
+
+  llvm::cl::opt<int64_t> kvCacheCapacity("kv-cache-capacity",
+      llvm::cl::desc("Number of entries along the concat axis reserved for "
+                     "each key/value cache."),
+      llvm::cl::init(2048), llvm::cl::cat(OnnxMlirOptions));
+
+  llvm::cl::list<string> dimBounds("dim-bounds",
+      llvm::cl::desc("Upper bounds of the dynamic dimensions of the inputs, "
+                     "used to plan the memory of the model. Each bound is "
+                     "given as <input>:<dimension>=<bound> or "
+                     "<dim_param>=<bound>. Inputs exceeding their bounds "
+                     "are rejected at run time."),
+      llvm::cl::CommaSeparated, llvm::cl::cat(OnnxMlirOptions));
+
   llvm::cl::HideUnrelatedOptions(OnnxMlirOptions);
   llvm::cl::ParseCommandLineOptions(
       argc, argv, "ONNX MLIR modular optimizer driver\n");
@@ -43,6 +71,13 @@ int main(int argc, char *argv[]) {
   mlir::MLIRContext context;
   mlir::OwningModuleRef module;
   processInputFile(inputFilename, emissionTarget, context, module);
+  if (donateInputs)
+    (*module).setAttr(mlir::ONNXEntryPointOp::getDonateInputsAttrName(),
+        mlir::UnitAttr::get(&context));
+  if (!kvCache.empty() && !setKVCacheAttrs(module, kvCache, kvCacheCapacity))
+    return 1;
+  if (!dimBounds.empty() && !setDimBoundsAttrs(module, dimBounds))
+    return 1;
 
   // Input file base name.
   string outputBaseName =
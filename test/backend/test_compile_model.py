@@ -0,0 +1,91 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+import os
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+import onnx
+from onnx import helper, TensorProto
+
+import test_config
+
+# Make lib folder under build directory visible in PYTHONPATH
+RUNTIME_DIR = os.path.join(test_config.ONNX_MLIR_BUILD_PATH, "lib")
+sys.path.append(RUNTIME_DIR)
+from PyRuntime import ExecutionSession, compile_model
+
+
+def make_add_model():
+    x = helper.make_tensor_value_info("x", TensorProto.FLOAT, [2, 3])
+    y = helper.make_tensor_value_info("y", TensorProto.FLOAT, [2, 3])
+    z = helper.make_tensor_value_info("z", TensorProto.FLOAT, [2, 3])
+    node = helper.make_node("Add", ["x", "y"], ["z"], name="add")
+    graph = helper.make_graph([node], "add", [x, y], [z])
+    return helper.make_model(graph)
+
+
+def make_if_model():
+    # The then branch has its own initializer named like the initializer of
+    # the main graph, which the else branch uses.
+    x = helper.make_tensor_value_info("x", TensorProto.FLOAT, [2, 3])
+    cond = helper.make_tensor_value_info("cond", TensorProto.BOOL, [])
+    w = helper.make_tensor_value_info("w", TensorProto.FLOAT, [2, 3])
+    z = helper.make_tensor_value_info("z", TensorProto.FLOAT, [2, 3])
+
+    def make_branch(name, initializers):
+        out = helper.make_tensor_value_info(name, TensorProto.FLOAT, [2, 3])
+        node = helper.make_node("Add", ["x", "w"], [name])
+        return helper.make_graph([node], name, [], [out], initializers)
+
+    inner_w = helper.make_tensor("w", TensorProto.FLOAT, [2, 3], [10] * 6)
+    outer_w = helper.make_tensor("w", TensorProto.FLOAT, [2, 3], [1] * 6)
+    node = helper.make_node("If", ["cond"], ["z"],
+                            then_branch=make_branch("then", [inner_w]),
+                            else_branch=make_branch("else", []))
+    graph = helper.make_graph([node], "if", [x, cond, w], [z], [outer_w])
+    return helper.make_model(graph)
+
+
+class CompileModelTest(unittest.TestCase):
+    # The in-process compiler produces a library that runs like the one of
+    # the onnx-mlir driver.
+    def test_compile_and_run(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            base_name = os.path.join(tmp, "add")
+            lib_path = compile_model(make_add_model().SerializeToString(),
+                                     base_name)
+            self.assertEqual(lib_path, base_name + ".so")
+            session = ExecutionSession(lib_path,
+                                       "_dyn_entry_point_main_graph")
+            x = np.arange(6, dtype=np.float32).reshape(2, 3)
+            y = np.full((2, 3), 10, dtype=np.float32)
+            outputs = session.run([x, y])
+            np.testing.assert_array_equal(outputs[0], x + y)
+
+    # The initializers of a subgraph shadow those of the main graph.
+    def test_subgraph_initializers(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            lib_path = compile_model(make_if_model().SerializeToString(),
+                                     os.path.join(tmp, "if"))
+            session = ExecutionSession(lib_path,
+                                       "_dyn_entry_point_main_graph")
+            x = np.arange(6, dtype=np.float32).reshape(2, 3)
+            for cond, w in [(True, 10), (False, 1)]:
+                outputs = session.run([x, np.array(cond)])
+                np.testing.assert_array_equal(outputs[0], x + w)
+
+    # Invalid models raise an exception instead of aborting the process.
+    def test_invalid_model(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            with self.assertRaises(RuntimeError):
+                compile_model(b"not an onnx model",
+                              os.path.join(tmp, "invalid"))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,19 @@
+// RUN: onnx-mlir-opt --lower-krnl --lower-all-llvm %s -split-input-file | FileCheck %s
+
+/// Kernels are declared and called with the pointers to the first element of
+/// the MemRefs.
+func @test_call_kernel(%arg0 : memref<2x3xf32>) -> memref<3x2xf32> {
+  %0 = alloc() : memref<3x2xf32>
+  %c2 = constant 2 : index
+  %c3 = constant 3 : index
+  "krnl.call_kernel"(%arg0, %0, %c2, %c3) {name = "omKernelTranspose2DF32"} : (memref<2x3xf32>, memref<3x2xf32>, index, index) -> ()
+  return %0 : memref<3x2xf32>
+
+  // CHECK: llvm.func @omKernelTranspose2DF32(!llvm<"float*">, !llvm<"float*">, !llvm.i64, !llvm.i64)
+  // CHECK-LABEL: llvm.func @test_call_kernel
+  // CHECK: [[IN_ALIGNED:%.+]] = llvm.extractvalue %{{.+}}[1] : !llvm<"{ float*, float*, i64, [2 x i64], [2 x i64] }">
+  // CHECK: [[IN_OFFSET:%.+]] = llvm.extractvalue %{{.+}}[2] : !llvm<"{ float*, float*, i64, [2 x i64], [2 x i64] }">
+  // CHECK: [[IN:%.+]] = llvm.getelementptr [[IN_ALIGNED]]{{\[}}[[IN_OFFSET]]{{\]}} : (!llvm<"float*">, !llvm.i64) -> !llvm<"float*">
+  // CHECK: [[OUT:%.+]] = llvm.getelementptr
+  // CHECK: llvm.call @omKernelTranspose2DF32([[IN]], [[OUT]], {{%.+}}, {{%.+}}) : (!llvm<"float*">, !llvm<"float*">, !llvm.i64, !llvm.i64) -> !llvm.void
+}
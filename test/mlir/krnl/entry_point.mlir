@@ -0,0 +1,31 @@
+// RUN: onnx-mlir-opt --lower-all-llvm %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The element size, element kind, rank and dimensions of every input and
+/// output are exported, so that the runtime can build inputs to warm the
+/// model up, check the files it reads them from, and read its outputs.
+module {
+  func @main_graph(%arg0 : memref<4x?xf32>, %arg1 : memref<i64>) -> memref<4x?xf32> {
+    return %arg0 : memref<4x?xf32>
+  }
+  "krnl.entry_point"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32} : () -> ()
+
+  // CHECK: llvm.mlir.global external constant @_input_signature_main_graph(dense<[2, 4, 102, 2, 4, -1, 8, 105, 0]> : tensor<9xi64>) : !llvm<"[9 x i64]">
+  // CHECK: llvm.mlir.global external constant @_output_signature_main_graph(dense<[1, 4, 102, 2, 4, -1]> : tensor<6xi64>) : !llvm<"[6 x i64]">
+  // CHECK: llvm.func @_dyn_entry_point_main_graph
+}
+
+// -----
+
+/// The bounds of the dimensions of the inputs are exported when a dynamic
+/// dimension is bounded, so that the runtime can reject larger inputs.
+module {
+  func @main_graph(%arg0 : memref<4x?xf32> {onnx.dim_bounds = [-1, 512]}, %arg1 : memref<?xi64>) -> memref<4x?xf32> {
+    return %arg0 : memref<4x?xf32>
+  }
+  "krnl.entry_point"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32} : () -> ()
+
+  // CHECK: llvm.mlir.global external constant @_input_signature_main_graph(dense<[2, 4, 102, 2, 4, -1, 8, 105, 1, -1]> : tensor<10xi64>) : !llvm<"[10 x i64]">
+  // CHECK: llvm.mlir.global external constant @_input_bounds_main_graph(dense<[2, 2, 4, 512, 1, -1]> : tensor<6xi64>) : !llvm<"[6 x i64]">
+}
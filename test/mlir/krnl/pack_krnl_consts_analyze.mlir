@@ -0,0 +1,20 @@
+// RUN: onnx-mlir-opt --pack-krnl-constants='elision-threshold=3 move-to-file=true filename=test-pack-consts-analyze.bin write-index=true' %s -split-input-file && binary-decoder test-pack-consts-analyze.bin --analyze=test-pack-consts-analyze.bin.json -rm | FileCheck %s
+
+// CHECK:      constant_0: f32 [1, 4], 16 bytes at offset 0
+// CHECK-NEXT:   zeros: 1 of 4 (25.00%)
+// CHECK-NEXT:   range: [0, 3], mean 1.5
+// CHECK-NEXT:   histogram: 1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1
+// CHECK-NEXT:   int8: scale 0.023622, max error 0.00787402, rms error 0.00556777, SQNR 50.5 dB
+// CHECK:      constant_1: f32 [1, 4], 16 bytes at offset 16
+// CHECK:        duplicate of constant_0
+// CHECK:      constant_2: i32 [1, 4], 16 bytes at offset 32
+// CHECK-NEXT:   zeros: 2 of 4 (50.00%)
+// CHECK-NEXT:   range: [-5, 5], mean 0
+// CHECK:      total: 3 constants, 48 bytes, 16 duplicate bytes, 33.33% zeros
+func @test_krnl_const_packing_analyze() -> memref<1x4xf32> {
+  %0 = "krnl.global"() {name = "constant_0", shape = [1, 4], value = dense<[[0., 1., 2., 3.]]> : tensor<1x4xf32>} : () -> memref<1x4xf32>
+  %1 = "krnl.global"() {name = "constant_1", shape = [1, 4], value = dense<[[0., 1., 2., 3.]]> : tensor<1x4xf32>} : () -> memref<1x4xf32>
+  %2 = "krnl.global"() {name = "constant_2", shape = [1, 4], value = dense<[[0, 0, 5, -5]]> : tensor<1x4xi32>} : () -> memref<1x4xi32>
+  %3 = "krnl.global"() {name = "constant_3", shape = [1], value = dense<[7.]> : tensor<1xf32>} : () -> memref<1xf32>
+  return %0 : memref<1x4xf32>
+}
@@ -0,0 +1,34 @@
+// RUN: onnx-mlir-opt --constant-subgraph-eval %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The chain of operations on the constant is evaluated, the operation using
+/// the input is kept.
+func @test_transpose_relu(%arg0 : tensor<3x2xf32>) -> tensor<3x2xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[1.0, -2.0, 3.0], [-4.0, 5.0, -6.0]]> : tensor<2x3xf32>} : () -> tensor<2x3xf32>
+  %1 = "onnx.Transpose"(%0) {perm = [1, 0]} : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %2 = "onnx.Relu"(%1) : (tensor<3x2xf32>) -> tensor<3x2xf32>
+  %3 = "onnx.Add"(%arg0, %2) : (tensor<3x2xf32>, tensor<3x2xf32>) -> tensor<3x2xf32>
+  "std.return"(%3) : (tensor<3x2xf32>) -> ()
+
+  // CHECK-LABEL: test_transpose_relu
+  // CHECK-NOT: "onnx.Transpose"
+  // CHECK-NOT: "onnx.Relu"
+  // CHECK: [[CST:%.+]] = "onnx.Constant"() {value = dense<{{\[}}[1.000000e+00, 0.000000e+00], [0.000000e+00, 5.000000e+00], [3.000000e+00, 0.000000e+00]]> : tensor<3x2xf32>} : () -> tensor<3x2xf32>
+  // CHECK: [[ADD:%.+]] = "onnx.Add"(%arg0, [[CST]]) : (tensor<3x2xf32>, tensor<3x2xf32>) -> tensor<3x2xf32>
+  // CHECK: return [[ADD]] : tensor<3x2xf32>
+}
+
+// -----
+
+/// A result larger than the inputs is computed at inference time.
+func @test_expand(%arg0 : tensor<4x4xf32>) -> tensor<4x4xf32> {
+  %0 = "onnx.Constant"() {value = dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>} : () -> tensor<4xf32>
+  %1 = "onnx.Constant"() {value = dense<[4, 4]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %2 = "onnx.Expand"(%0, %1) : (tensor<4xf32>, tensor<2xi64>) -> tensor<4x4xf32>
+  %3 = "onnx.Add"(%arg0, %2) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+  "std.return"(%3) : (tensor<4x4xf32>) -> ()
+
+  // CHECK-LABEL: test_expand
+  // CHECK: "onnx.Expand"
+}
@@ -67,3 +67,26 @@ func @test_enable_memory_pool_2(%arg0: tensor<10x10xf32>, %arg1: tensor<10x20xf3
   // CHECK: dealloc [[MEMPOOL0]] : memref<800xi8>
   // CHECK: return [[RES]] : memref<10x20xf32>
 }
+
+/// Intermediate values with bounded dynamic dimensions are allocated at their
+/// maximum size in the memory pool.
+func @test_enable_memory_pool_bounded(%arg0: tensor<?x10xf32> {onnx.dim_bounds = [64, -1]}) -> tensor<?x10xf32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<?x10xf32>) -> tensor<?x10xf32>
+  %1 = "onnx.Exp"(%0) : (tensor<?x10xf32>) -> tensor<?x10xf32>
+  return %1 : tensor<?x10xf32>
+
+  // CHECK-LABEL: test_enable_memory_pool_bounded
+  // CHECK: [[CONST0:%.+]] = constant 0 : i64
+  // CHECK: [[DIM0:%.+]] = dim %arg0, 0 : memref<?x10xf32>
+  // CHECK: [[MEMPOOL:%.+]] = alloc() : memref<2560xi8>
+  // CHECK: [[GETREF:%.+]] = "krnl.getref"([[MEMPOOL]], [[CONST0]]) : (memref<2560xi8>, i64) -> memref<640xf32>
+  // CHECK: [[VIEW:%.+]] = "krnl.reinterpret"([[GETREF]], [[DIM0]]) : (memref<640xf32>, index) -> memref<?x10xf32>
+  // CHECK: krnl.iterate
+  // CHECK: store {{%.+}}, [[VIEW]][%arg1, %arg2] : memref<?x10xf32>
+  // CHECK: [[DIM1:%.+]] = dim [[VIEW]], 0 : memref<?x10xf32>
+  // CHECK: [[RES:%.+]] = alloc([[DIM1]]) : memref<?x10xf32>
+  // CHECK: krnl.iterate
+  // CHECK: dealloc [[MEMPOOL]] : memref<2560xi8>
+  // CHECK-NOT: dealloc [[VIEW]]
+  // CHECK: return [[RES]] : memref<?x10xf32>
+}
@@ -2227,3 +2227,65 @@ func @test_split_unknown_dimension(%arg0 : tensor<?x?x64xf32>) -> (tensor<*xf32>
   // CHECK: }
   // CHECK: return [[RES_0]], [[RES_1]] : memref<?x2x64xf32>, memref<?x30x64xf32>
 }
+
+// -----
+
+func @test_lstm_sequence_lens(%arg0: tensor<4x3x2xf32>, %arg1: tensor<1x12x2xf32>, %arg2: tensor<1x12x3xf32>, %arg3: tensor<3xi32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %Y, %Y_h, %Y_c = "onnx.LSTM"(%arg0, %arg1, %arg2, %cst, %arg3, %cst, %cst, %cst) {hidden_size = 3 : i64} : (tensor<4x3x2xf32>, tensor<1x12x2xf32>, tensor<1x12x3xf32>, none, tensor<3xi32>, none, none, none) -> (none, tensor<*xf32>, none)
+  return %Y_h : tensor<*xf32>
+
+  // CHECK-LABEL: @test_lstm_sequence_lens
+
+  /// Compute the length of the longest sequence of the batch.
+  // CHECK: [[MAX_LEN:%.+]] = alloc() : memref<i32>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg4 = 0 to 3) {
+  // CHECK:   [[LEN:%.+]] = load %arg3[%arg4] : memref<3xi32>
+  // CHECK:   [[CUR_MAX:%.+]] = load [[MAX_LEN]][] : memref<i32>
+  // CHECK:   [[GREATER:%.+]] = cmpi "sgt", [[LEN]], [[CUR_MAX]] : i32
+  // CHECK:   [[NEXT_MAX:%.+]] = select [[GREATER]], [[LEN]], [[CUR_MAX]] : i32
+  // CHECK:   store [[NEXT_MAX]], [[MAX_LEN]][] : memref<i32>
+  // CHECK: }
+  // CHECK: [[LOAD_MAX:%.+]] = load [[MAX_LEN]][] : memref<i32>
+  // CHECK: [[MAX:%.+]] = index_cast [[LOAD_MAX]] : i32 to index
+  // CHECK: dealloc [[MAX_LEN]] : memref<i32>
+  // CHECK: [[SEQ_DIM:%.+]] = constant 4 : index
+  // CHECK: [[TOO_LONG:%.+]] = cmpi "sgt", [[MAX]], [[SEQ_DIM]] : index
+  // CHECK: [[BOUND:%.+]] = select [[TOO_LONG]], [[SEQ_DIM]], [[MAX]] : index
+
+  /// The sequence loop stops at the longest sequence.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg4 = 0 to [[BOUND]]) {
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 3, {{.*}} -> %arg6 = 0 to 3) {
+
+  /// The step is skipped for samples whose sequence has ended.
+  // CHECK:     [[SAMPLE_LEN:%.+]] = load %arg3[%arg5] : memref<3xi32>
+  // CHECK:     [[SAMPLE_LEN_INDEX:%.+]] = index_cast [[SAMPLE_LEN]] : i32 to index
+  // CHECK:     [[ACTIVE:%.+]] = cmpi "slt", %arg4, [[SAMPLE_LEN_INDEX]] : index
+  // CHECK:     scf.if [[ACTIVE]] {
+  // CHECK:       {{.*}} = load %arg0[%arg4, %arg5, {{.*}}] : memref<4x3x2xf32>
+}
+
+// -----
+
+func @test_lstm_reverse_sequence_lens(%arg0: tensor<4x3x2xf32>, %arg1: tensor<1x12x2xf32>, %arg2: tensor<1x12x3xf32>, %arg3: tensor<3xi32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %Y, %Y_h, %Y_c = "onnx.LSTM"(%arg0, %arg1, %arg2, %cst, %arg3, %cst, %cst, %cst) {hidden_size = 3 : i64, direction = "reverse"} : (tensor<4x3x2xf32>, tensor<1x12x2xf32>, tensor<1x12x3xf32>, none, tensor<3xi32>, none, none, none) -> (none, tensor<*xf32>, none)
+  return %Y_h : tensor<*xf32>
+
+  // CHECK-LABEL: @test_lstm_reverse_sequence_lens
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg4 = 0 to {{.*}}) {
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 3, {{.*}} -> %arg6 = 0 to 3) {
+
+  /// A sample is reversed within its length, clamped to the sequence dimension.
+  // CHECK:     [[SAMPLE_LEN:%.+]] = load %arg3[%arg5] : memref<3xi32>
+  // CHECK:     [[SAMPLE_LEN_INDEX:%.+]] = index_cast [[SAMPLE_LEN]] : i32 to index
+  // CHECK:     [[ACTIVE:%.+]] = cmpi "slt", %arg4, [[SAMPLE_LEN_INDEX]] : index
+  // CHECK:     scf.if [[ACTIVE]] {
+  // CHECK:       [[SEQ_DIM:%.+]] = constant 4 : index
+  // CHECK:       [[TOO_LONG:%.+]] = cmpi "sgt", [[SAMPLE_LEN_INDEX]], [[SEQ_DIM]] : index
+  // CHECK:       [[VALID_LEN:%.+]] = select [[TOO_LONG]], [[SEQ_DIM]], [[SAMPLE_LEN_INDEX]] : index
+  // CHECK:       [[ONE:%.+]] = constant 1 : index
+  // CHECK:       [[REMAINING:%.+]] = subi [[VALID_LEN]], %arg4 : index
+  // CHECK:       [[TIMESTEP:%.+]] = subi [[REMAINING]], [[ONE]] : index
+  // CHECK:       {{.*}} = load %arg0{{\[}}[[TIMESTEP]], %arg5, {{.*}}] : memref<4x3x2xf32>
+}
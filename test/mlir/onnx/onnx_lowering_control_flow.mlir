@@ -0,0 +1,88 @@
+// RUN: onnx-mlir-opt --shape-inference --lower-frontend %s -split-input-file | FileCheck %s
+
+// -----
+
+func @test_loop(%arg0 : tensor<i64>, %arg1 : tensor<i1>, %arg2 : tensor<4xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Loop"(%arg0, %arg1, %arg2) ({
+  ^bb0(%i : tensor<i64>, %cond : tensor<i1>, %x : tensor<4xf32>):
+    %1 = "onnx.Add"(%x, %x) : (tensor<4xf32>, tensor<4xf32>) -> tensor<*xf32>
+    "onnx.Yield"(%cond, %1) : (tensor<i1>, tensor<*xf32>) -> ()
+  }) : (tensor<i64>, tensor<i1>, tensor<4xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_loop
+  // CHECK: [[RES:%.+]] = alloc() : memref<4xf32>
+  // CHECK: [[COND:%.+]] = alloc() : memref<i1>
+  // CHECK: [[ITER:%.+]] = alloc() : memref<i64>
+  // CHECK: [[INIT_COND:%.+]] = load %arg1[] : memref<i1>
+  // CHECK: store [[INIT_COND]], [[COND]][] : memref<i1>
+  // CHECK: [[M:%.+]] = load %arg0[] : memref<i64>
+  // CHECK: [[TRIP_COUNT:%.+]] = index_cast [[M]] : i64 to index
+  // CHECK: [[SIZE:%.+]] = constant 16 : i64
+  // CHECK: "krnl.memcpy"([[RES]], %arg2, [[SIZE]]) : (memref<4xf32>, memref<4xf32>, i64) -> ()
+  // CHECK: [[ZERO:%.+]] = constant 0 : index
+  // CHECK: br [[HEADER:\^bb[0-9]+]]([[ZERO]] : index)
+
+  /// The header stores the iteration number and tests the exit condition.
+  // CHECK: [[HEADER]]([[IV:%.+]]: index):
+  // CHECK: [[IV_I64:%.+]] = index_cast [[IV]] : index to i64
+  // CHECK: store [[IV_I64]], [[ITER]][] : memref<i64>
+  // CHECK: [[GO:%.+]] = load [[COND]][] : memref<i1>
+  // CHECK: [[IN_RANGE:%.+]] = cmpi "slt", [[IV]], [[TRIP_COUNT]] : index
+  // CHECK: [[KEEP_GOING:%.+]] = and [[IN_RANGE]], [[GO]] : i1
+  // CHECK: cond_br [[KEEP_GOING]], [[BODY:\^bb[0-9]+]]([[ITER]], [[COND]], [[RES]] : memref<i64>, memref<i1>, memref<4xf32>), [[END:\^bb[0-9]+]]
+
+  /// The body updates the loop-carried buffer with the value it yields.
+  // CHECK: [[BODY]]({{.*}}: memref<i64>, {{.*}}: memref<i1>, [[X:%.+]]: memref<4xf32>):
+  // CHECK: [[ADD_RES:%.+]] = alloc() : memref<4xf32>
+  // CHECK: [[LOAD1:%.+]] = load [[X]][%arg{{.*}}] : memref<4xf32>
+  // CHECK: [[LOAD2:%.+]] = load [[X]][%arg{{.*}}] : memref<4xf32>
+  // CHECK: [[ADDF:%.+]] = addf [[LOAD1]], [[LOAD2]] : f32
+  // CHECK: store [[ADDF]], [[ADD_RES]][%arg{{.*}}] : memref<4xf32>
+  // CHECK-NOT: "krnl.memcpy"([[COND]]
+  // CHECK: "krnl.memcpy"([[RES]], [[ADD_RES]], [[SIZE]]) : (memref<4xf32>, memref<4xf32>, i64) -> ()
+  // CHECK: [[ONE:%.+]] = constant 1 : index
+  // CHECK: [[NEXT_IV:%.+]] = addi [[IV]], [[ONE]] : index
+  // CHECK: dealloc [[ADD_RES]] : memref<4xf32>
+  // CHECK: br [[HEADER]]([[NEXT_IV]] : index)
+
+  // CHECK: [[END]]:
+  // CHECK: dealloc [[ITER]] : memref<i64>
+  // CHECK: dealloc [[COND]] : memref<i1>
+  // CHECK-NOT: dealloc [[RES]] : memref<4xf32>
+  // CHECK: return [[RES]] : memref<4xf32>
+}
+
+// -----
+
+func @test_if(%arg0 : tensor<i1>, %arg1 : tensor<4xf32>) -> tensor<*xf32> {
+  %0 = "onnx.If"(%arg0) ({
+    "onnx.Yield"(%arg1) : (tensor<4xf32>) -> ()
+  }, {
+    %1 = "onnx.Relu"(%arg1) : (tensor<4xf32>) -> tensor<*xf32>
+    "onnx.Yield"(%1) : (tensor<*xf32>) -> ()
+  }) : (tensor<i1>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_if
+  // CHECK: [[RES:%.+]] = alloc() : memref<4xf32>
+  // CHECK: [[COND:%.+]] = load %arg0[] : memref<i1>
+  // CHECK: cond_br [[COND]], [[THEN:\^bb[0-9]+]], [[ELSE:\^bb[0-9]+]]
+
+  /// Both branches write the result buffer allocated before branching.
+  // CHECK: [[THEN]]:
+  // CHECK: [[RELU_RES:%.+]] = alloc() : memref<4xf32>
+  // CHECK: store {{.*}}, [[RELU_RES]][%arg{{.*}}] : memref<4xf32>
+  // CHECK: [[SIZE:%.+]] = constant 16 : i64
+  // CHECK: "krnl.memcpy"([[RES]], [[RELU_RES]], [[SIZE]]) : (memref<4xf32>, memref<4xf32>, i64) -> ()
+  // CHECK: dealloc [[RELU_RES]] : memref<4xf32>
+  // CHECK: br [[END:\^bb[0-9]+]]
+
+  // CHECK: [[ELSE]]:
+  // CHECK: "krnl.memcpy"([[RES]], %arg1, {{.*}}) : (memref<4xf32>, memref<4xf32>, i64) -> ()
+  // CHECK: br [[END]]
+
+  // CHECK: [[END]]:
+  // CHECK-NOT: dealloc [[RES]] : memref<4xf32>
+  // CHECK: return [[RES]] : memref<4xf32>
+}
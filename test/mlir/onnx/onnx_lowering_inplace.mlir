@@ -0,0 +1,71 @@
+// RUN: onnx-mlir-opt --shape-inference --lower-frontend %s -split-input-file | FileCheck %s
+
+// -----
+
+func @test_inplace_unary(%arg0 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Exp"(%arg0) : (tensor<10x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  %2 = "onnx.Tanh"(%1) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_inplace_unary
+  // CHECK: [[RET_RES:%.+]] = alloc() : memref<10x10xf32>
+  // CHECK: [[RES:%.+]] = alloc() : memref<10x10xf32>
+  // CHECK-NOT: alloc
+
+  /// Exp
+  // CHECK: [[LOAD1:%.+]] = affine.load %arg0[%arg1, %arg2] : memref<10x10xf32>
+  // CHECK: [[EXP:%.+]] = exp [[LOAD1]] : f32
+  // CHECK: affine.store [[EXP]], [[RES]][%arg1, %arg2] : memref<10x10xf32>
+
+  /// Relu, computed in place into the result of Exp.
+  // CHECK: [[LOAD2:%.+]] = affine.load [[RES]][%arg1, %arg2] : memref<10x10xf32>
+  // CHECK: affine.store {{.*}}, [[RES]][%arg1, %arg2] : memref<10x10xf32>
+
+  /// Tanh, whose result is returned and cannot reuse a deallocated buffer.
+  // CHECK: [[LOAD3:%.+]] = affine.load [[RES]][%arg1, %arg2] : memref<10x10xf32>
+  // CHECK: affine.store {{.*}}, [[RET_RES]][%arg1, %arg2] : memref<10x10xf32>
+
+  // CHECK: dealloc [[RES]] : memref<10x10xf32>
+  // CHECK-NOT: dealloc [[RET_RES]] : memref<10x10xf32>
+  // CHECK: return [[RET_RES]] : memref<10x10xf32>
+}
+
+// -----
+
+func @test_inplace_binary_not_last_use(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Mul"(%0, %0) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+  %2 = "onnx.Sub"(%1, %arg1) : (tensor<*xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_inplace_binary_not_last_use
+  // CHECK: [[RET_RES:%.+]] = alloc() : memref<10x10xf32>
+  // CHECK: [[MUL_RES:%.+]] = alloc() : memref<10x10xf32>
+  // CHECK: [[ADD_RES:%.+]] = alloc() : memref<10x10xf32>
+
+  /// Mul reads the result of Add twice, so it needs its own buffer.
+  // CHECK: [[MULF:%.+]] = mulf {{.*}} : f32
+  // CHECK: store [[MULF]], [[MUL_RES]][%arg2, %arg3] : memref<10x10xf32>
+
+  // CHECK: [[SUBF:%.+]] = subf {{.*}} : f32
+  // CHECK: store [[SUBF]], [[RET_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: return [[RET_RES]] : memref<10x10xf32>
+}
+
+// -----
+
+module attributes {onnx.donate_inputs} {
+  func @test_inplace_donated_input(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+    %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+    "std.return"(%0) : (tensor<*xf32>) -> ()
+  }
+
+  // CHECK-LABEL: test_inplace_donated_input
+  // CHECK-NOT: alloc
+  // CHECK: [[LOAD1:%.+]] = load %arg0[%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: [[LOAD2:%.+]] = load %arg1[%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: [[ADDF:%.+]] = addf [[LOAD1]], [[LOAD2]] : f32
+  // CHECK: store [[ADDF]], %arg0[%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: return %arg0 : memref<10x10xf32>
+}
@@ -0,0 +1,56 @@
+// RUN: onnx-mlir-opt --shape-inference --lower-frontend %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Matrices are transposed by the kernel library when the model is linked
+/// with it.
+module attributes {krnl.kernel_library} {
+  func @test_transpose_kernel(%arg0 : tensor<10x20xf32>) -> tensor<*xf32> {
+    %0 = "onnx.Transpose"(%arg0) : (tensor<10x20xf32>) -> tensor<*xf32>
+    "std.return"(%0) : (tensor<*xf32>) -> ()
+
+    // CHECK-LABEL: test_transpose_kernel
+    // CHECK: [[RES:%.+]] = alloc() : memref<20x10xf32>
+    // CHECK: [[DIM0:%.+]] = dim %arg0, 0 : memref<10x20xf32>
+    // CHECK: [[DIM1:%.+]] = dim %arg0, 1 : memref<10x20xf32>
+    // CHECK: "krnl.call_kernel"(%arg0, [[RES]], [[DIM0]], [[DIM1]]) {name = "omKernelTranspose2DF32"} : (memref<10x20xf32>, memref<20x10xf32>, index, index) -> ()
+    // CHECK-NOT: krnl.iterate
+    // CHECK: return [[RES]] : memref<20x10xf32>
+  }
+}
+
+// -----
+
+/// Element types without a kernel are transposed by loops.
+module attributes {krnl.kernel_library} {
+  func @test_transpose_no_kernel(%arg0 : tensor<10x20xi8>) -> tensor<*xi8> {
+    %0 = "onnx.Transpose"(%arg0) {perm = [1, 0]} : (tensor<10x20xi8>) -> tensor<*xi8>
+    "std.return"(%0) : (tensor<*xi8>) -> ()
+
+    // CHECK-LABEL: test_transpose_no_kernel
+    // CHECK-NOT: krnl.call_kernel
+    // CHECK: krnl.iterate
+  }
+}
+
+// -----
+
+/// The exponential of float tensors is computed by the kernel library.
+module attributes {krnl.kernel_library} {
+  func @test_exp_kernel(%arg0 : tensor<?x10xf32>) -> tensor<*xf32> {
+    %0 = "onnx.Exp"(%arg0) : (tensor<?x10xf32>) -> tensor<*xf32>
+    "std.return"(%0) : (tensor<*xf32>) -> ()
+
+    // CHECK-LABEL: test_exp_kernel
+    // CHECK: [[DIM:%.+]] = dim %arg0, 0 : memref<?x10xf32>
+    // CHECK: [[RES:%.+]] = alloc([[DIM]]) : memref<?x10xf32>
+    // CHECK: [[ONE:%.+]] = constant 1 : index
+    // CHECK: [[DIM0:%.+]] = dim %arg0, 0 : memref<?x10xf32>
+    // CHECK: [[SIZE0:%.+]] = muli [[ONE]], [[DIM0]] : index
+    // CHECK: [[DIM1:%.+]] = dim %arg0, 1 : memref<?x10xf32>
+    // CHECK: [[SIZE1:%.+]] = muli [[SIZE0]], [[DIM1]] : index
+    // CHECK: "krnl.call_kernel"(%arg0, [[RES]], [[SIZE1]]) {name = "omKernelExpF32"} : (memref<?x10xf32>, memref<?x10xf32>, index) -> ()
+    // CHECK-NOT: krnl.iterate
+    // CHECK: return [[RES]] : memref<?x10xf32>
+  }
+}
@@ -0,0 +1,118 @@
+// RUN: onnx-mlir-opt --shape-inference --lower-frontend %s -split-input-file | FileCheck %s
+
+// -----
+
+func @test_concat_dynamic_axis(%arg0 : tensor<1x4x?x16xf32>, %arg1 : tensor<1x4x1x16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Concat"(%arg0, %arg1) { axis = 2 } : (tensor<1x4x?x16xf32>, tensor<1x4x1x16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_concat_dynamic_axis
+  // CHECK: [[DIM0:%.+]] = dim %arg0, 2 : memref<1x4x?x16xf32>
+  // CHECK: [[DIM1:%.+]] = dim %arg1, 2 : memref<1x4x1x16xf32>
+  // CHECK: [[LEN:%.+]] = addi [[DIM0]], [[DIM1]] : index
+  // CHECK: [[RES:%.+]] = alloc([[LEN]]) : memref<1x4x?x16xf32>
+  // CHECK-NOT: scf.if
+
+  // CHECK: [[LOAD0:%.+]] = load %arg0[%arg2, %arg3, %arg4, %arg5] : memref<1x4x?x16xf32>
+  // CHECK: store [[LOAD0]], [[RES]][%arg2, %arg3, %arg4, %arg5] : memref<1x4x?x16xf32>
+
+  // CHECK: [[OFF:%.+]] = addi [[DIM0]], %arg4 : index
+  // CHECK: [[LOAD1:%.+]] = load %arg1[%arg2, %arg3, %arg4, %arg5] : memref<1x4x1x16xf32>
+  // CHECK: store [[LOAD1]], [[RES]][%arg2, %arg3, [[OFF]], %arg5] : memref<1x4x?x16xf32>
+  // CHECK: return [[RES]] : memref<1x4x?x16xf32>
+}
+
+// -----
+
+module attributes {onnx.kv_cache = [[0, 0, 2, 4]], onnx.kv_cache_capacity = 64 : i64} {
+  func @test_kv_cache_append(%arg0 : tensor<1x4x?x16xf32>, %arg1 : tensor<1x4x1x16xf32>) -> tensor<*xf32> {
+    %0 = "onnx.Concat"(%arg0, %arg1) { axis = 2 } : (tensor<1x4x?x16xf32>, tensor<1x4x1x16xf32>) -> tensor<*xf32>
+    "std.return"(%0) : (tensor<*xf32>) -> ()
+  }
+
+  // CHECK-LABEL: test_kv_cache_append
+  // CHECK: [[DIM0:%.+]] = dim %arg0, 2 : memref<1x4x?x16xf32>
+  // CHECK: [[DIM1:%.+]] = dim %arg1, 2 : memref<1x4x1x16xf32>
+  // CHECK: [[LEN:%.+]] = addi [[DIM0]], [[DIM1]] : index
+  // CHECK: [[CAPACITY:%.+]] = constant 64 : index
+  // CHECK: [[FITS:%.+]] = cmpi "sle", [[LEN]], [[CAPACITY]] : index
+  // CHECK: [[RES:%.+]] = scf.if [[FITS]] -> (memref<1x4x?x16xf32>) {
+
+  /// The past is extended in place into the buffer reserved by the session,
+  /// whose heads are strided for the capacity.
+  // CHECK: [[VIEW:%.+]] = "krnl.reinterpret"(%arg0, [[LEN]]) {axis = 2 : i64, capacity = 64 : i64} : (memref<1x4x?x16xf32>, index) -> memref<1x4x?x16xf32>
+  // CHECK: scf.yield [[VIEW]] : memref<1x4x?x16xf32>
+  // CHECK: } else {
+
+  /// The past is copied when the capacity is exceeded.
+  // CHECK: [[ALLOC:%.+]] = alloc([[LEN]]) : memref<1x4x?x16xf32>
+  // CHECK: [[LOAD0:%.+]] = load %arg0[%arg2, %arg3, %arg4, %arg5] : memref<1x4x?x16xf32>
+  // CHECK: store [[LOAD0]], [[ALLOC]][%arg2, %arg3, %arg4, %arg5] : memref<1x4x?x16xf32>
+  // CHECK: scf.yield [[ALLOC]] : memref<1x4x?x16xf32>
+  // CHECK: }
+
+  /// Only the new entries are appended.
+  // CHECK: [[OFF:%.+]] = addi [[DIM0]], %arg4 : index
+  // CHECK: [[LOAD1:%.+]] = load %arg1[%arg2, %arg3, %arg4, %arg5] : memref<1x4x1x16xf32>
+  // CHECK: store [[LOAD1]], [[RES]][%arg2, %arg3, [[OFF]], %arg5] : memref<1x4x?x16xf32>
+  // CHECK-NOT: dealloc
+  // CHECK: return [[RES]] : memref<1x4x?x16xf32>
+}
+
+// -----
+
+/// A strided cache is not appended in place when its result is reshaped,
+/// since the copy done by the reshape ignores the strides.
+module attributes {onnx.kv_cache = [[0, 0, 2, 4]], onnx.kv_cache_capacity = 64 : i64} {
+  func @test_kv_cache_append_reshaped(%arg0 : tensor<1x4x?x16xf32>, %arg1 : tensor<1x4x1x16xf32>, %arg2 : tensor<2xi64>) -> (tensor<*xf32>, tensor<*xf32>) {
+    %0 = "onnx.Concat"(%arg0, %arg1) { axis = 2 } : (tensor<1x4x?x16xf32>, tensor<1x4x1x16xf32>) -> tensor<*xf32>
+    %1 = "onnx.Reshape"(%0, %arg2) : (tensor<*xf32>, tensor<2xi64>) -> tensor<*xf32>
+    "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> ()
+  }
+
+  // CHECK-LABEL: test_kv_cache_append_reshaped
+  // CHECK-NOT: scf.if
+  // CHECK-NOT: krnl.reinterpret
+  // CHECK: krnl.memcpy
+}
+
+// -----
+
+/// Nor when its result is yielded by a branch of an If, whose lowering copies
+/// the yielded value into the result of the If.
+module attributes {onnx.kv_cache = [[0, 0, 2, 4]], onnx.kv_cache_capacity = 64 : i64} {
+  func @test_kv_cache_append_if(%arg0 : tensor<1x4x?x16xf32>, %arg1 : tensor<1x4x1x16xf32>, %arg2 : tensor<i1>) -> (tensor<*xf32>, tensor<*xf32>) {
+    %0 = "onnx.Concat"(%arg0, %arg1) { axis = 2 } : (tensor<1x4x?x16xf32>, tensor<1x4x1x16xf32>) -> tensor<*xf32>
+    %1 = "onnx.If"(%arg2) ({
+      "onnx.Yield"(%0) : (tensor<*xf32>) -> ()
+    }, {
+      "onnx.Yield"(%arg0) : (tensor<1x4x?x16xf32>) -> ()
+    }) : (tensor<i1>) -> tensor<*xf32>
+    "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> ()
+  }
+
+  // CHECK-LABEL: test_kv_cache_append_if
+  // CHECK-NOT: scf.if
+  // CHECK-NOT: krnl.reinterpret
+  // CHECK: "onnx.If"
+}
+
+// -----
+
+/// Nor when its past is carried into a Loop, whose lowering copies the
+/// initial value into the buffer of the loop-carried value.
+module attributes {onnx.kv_cache = [[0, 0, 2, 4]], onnx.kv_cache_capacity = 64 : i64} {
+  func @test_kv_cache_append_loop(%arg0 : tensor<1x4x?x16xf32>, %arg1 : tensor<1x4x1x16xf32>, %arg2 : tensor<i64>, %arg3 : tensor<i1>) -> (tensor<*xf32>, tensor<*xf32>) {
+    %0 = "onnx.Concat"(%arg0, %arg1) { axis = 2 } : (tensor<1x4x?x16xf32>, tensor<1x4x1x16xf32>) -> tensor<*xf32>
+    %1 = "onnx.Loop"(%arg2, %arg3, %arg0) ({
+    ^bb0(%i : tensor<i64>, %c : tensor<i1>, %v : tensor<1x4x?x16xf32>):
+      "onnx.Yield"(%c, %v) : (tensor<i1>, tensor<1x4x?x16xf32>) -> ()
+    }) : (tensor<i64>, tensor<i1>, tensor<1x4x?x16xf32>) -> tensor<*xf32>
+    "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> ()
+  }
+
+  // CHECK-LABEL: test_kv_cache_append_loop
+  // CHECK-NOT: scf.if
+  // CHECK-NOT: krnl.reinterpret
+  // CHECK: "onnx.Loop"
+}
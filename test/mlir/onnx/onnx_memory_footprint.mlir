@@ -0,0 +1,39 @@
+// RUN: onnx-mlir-opt --shape-inference --lower-frontend --enable-memory-pool --memory-footprint %s -split-input-file | FileCheck %s
+
+/// The activations include the memory pool and the returned tensor.
+module {
+  func @main_graph(%arg0: tensor<10x10xf32>) -> tensor<10x10xf32> {
+    %0 = "onnx.Add"(%arg0, %arg0) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32>
+    %1 = "onnx.Add"(%0, %arg0) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32>
+    "std.return"(%1) : (tensor<10x10xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK: module attributes {krnl.memory_footprint = "{\22constant_pool_bytes\22:0,\22entry_points\22:[{\22activation_bytes\22:800,\22inputs\22:[{\22element_size\22:4,\22max_bytes\22:400,\22shape\22:[10,10]}],\22name\22:\22main_graph\22,\22outputs\22:[{\22element_size\22:4,\22max_bytes\22:400,\22shape\22:[10,10]}],\22total_bytes\22:1200}]}"}
+
+// -----
+
+/// The sizes of dynamic tensors are bounded by the bounds of the inputs.
+module {
+  func @main_graph(%arg0: tensor<?x10xf32> {onnx.dim_bounds = [64, -1]}) -> tensor<?x10xf32> {
+    %0 = "onnx.Relu"(%arg0) : (tensor<?x10xf32>) -> tensor<?x10xf32>
+    "std.return"(%0) : (tensor<?x10xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK: module attributes {krnl.memory_footprint = "{\22constant_pool_bytes\22:0,\22entry_points\22:[{\22activation_bytes\22:2560,\22inputs\22:[{\22element_size\22:4,\22max_bytes\22:2560,\22shape\22:[-1,10]}],\22name\22:\22main_graph\22,\22outputs\22:[{\22element_size\22:4,\22max_bytes\22:2560,\22shape\22:[-1,10]}],\22total_bytes\22:5120}]}"}
+
+// -----
+
+/// Unbounded dynamic dimensions make the footprint unknown.
+module {
+  func @main_graph(%arg0: tensor<?x10xf32>) -> tensor<?x10xf32> {
+    %0 = "onnx.Relu"(%arg0) : (tensor<?x10xf32>) -> tensor<?x10xf32>
+    "std.return"(%0) : (tensor<?x10xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK: module attributes {krnl.memory_footprint = "{\22constant_pool_bytes\22:0,\22entry_points\22:[{\22activation_bytes\22:null,\22inputs\22:[{\22element_size\22:4,\22max_bytes\22:null,\22shape\22:[-1,10]}],\22name\22:\22main_graph\22,\22outputs\22:[{\22element_size\22:4,\22max_bytes\22:null,\22shape\22:[-1,10]}],\22total_bytes\22:null}]}"}
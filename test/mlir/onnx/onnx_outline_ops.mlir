@@ -0,0 +1,65 @@
+// RUN: onnx-mlir-opt --outline-onnx-ops %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Every operation is outlined into a function named after its node, the
+/// constants stay in the entry function.
+module {
+  func @main_graph(%arg0 : tensor<4x4xf32>) -> tensor<4x4xf32> {
+    %cst = "onnx.Constant"() {value = dense<1.0> : tensor<4x4xf32>} : () -> tensor<4x4xf32>
+    %0 = "onnx.MatMul"(%arg0, %cst) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32> loc("layer/matmul:0")
+    %1 = "onnx.Relu"(%0) : (tensor<4x4xf32>) -> tensor<4x4xf32> loc("relu")
+    %2 = "onnx.Add"(%1, %1) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    "std.return"(%2) : (tensor<4x4xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK-LABEL: func @main_graph
+// CHECK-SAME: ([[ARG0:%.+]]: tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[CST:%.+]] = "onnx.Constant"()
+// CHECK: [[MATMUL:%.+]] = call @onnx_MatMul_layer_matmul_0([[ARG0]], [[CST]]) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[RELU:%.+]] = call @onnx_Relu_relu([[MATMUL]]) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[ADD:%.+]] = call @onnx_Add_0([[RELU]]) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: return [[ADD]] : tensor<4x4xf32>
+
+// CHECK-LABEL: func @onnx_MatMul_layer_matmul_0
+// CHECK-SAME: ([[A:%.+]]: tensor<4x4xf32>, [[B:%.+]]: tensor<4x4xf32>) -> tensor<4x4xf32> attributes {onnx.outlined_op, passthrough = ["noinline"]}
+// CHECK: [[RES:%.+]] = "onnx.MatMul"([[A]], [[B]])
+// CHECK: return [[RES]] : tensor<4x4xf32>
+
+// CHECK-LABEL: func @onnx_Relu_relu
+// CHECK: "onnx.Relu"
+
+// CHECK-LABEL: func @onnx_Add_0
+// CHECK-SAME: ([[A:%.+]]: tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[RES:%.+]] = "onnx.Add"([[A]], [[A]])
+// CHECK: return [[RES]] : tensor<4x4xf32>
+
+// -----
+
+/// Absent optional operands are recreated in the outlined function, and
+/// nodes sharing a name get distinct functions.
+module {
+  func @main_graph(%arg0 : tensor<1x1x5x5xf32>, %arg1 : tensor<1x1x2x2xf32>) -> tensor<1x1x4x4xf32> {
+    %none = constant unit
+    %0 = "onnx.Conv"(%arg0, %arg1, %none) {auto_pad = "NOTSET", group = 1 : i64} : (tensor<1x1x5x5xf32>, tensor<1x1x2x2xf32>, none) -> tensor<1x1x4x4xf32> loc("conv")
+    %1 = "onnx.Relu"(%0) : (tensor<1x1x4x4xf32>) -> tensor<1x1x4x4xf32> loc("act")
+    %2 = "onnx.Relu"(%1) : (tensor<1x1x4x4xf32>) -> tensor<1x1x4x4xf32> loc("act")
+    "std.return"(%2) : (tensor<1x1x4x4xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK-LABEL: func @main_graph
+// CHECK: [[CONV:%.+]] = call @onnx_Conv_conv(%arg0, %arg1) : (tensor<1x1x5x5xf32>, tensor<1x1x2x2xf32>) -> tensor<1x1x4x4xf32>
+// CHECK: [[RELU:%.+]] = call @onnx_Relu_act([[CONV]])
+// CHECK: call @onnx_Relu_act_1([[RELU]])
+
+// CHECK-LABEL: func @onnx_Conv_conv
+// CHECK-SAME: ([[X:%.+]]: tensor<1x1x5x5xf32>, [[W:%.+]]: tensor<1x1x2x2xf32>)
+// CHECK: [[NONE:%.+]] = constant unit
+// CHECK: "onnx.Conv"([[X]], [[W]], [[NONE]])
+
+// CHECK-LABEL: func @onnx_Relu_act
+// CHECK-LABEL: func @onnx_Relu_act_1
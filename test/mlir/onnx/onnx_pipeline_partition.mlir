@@ -0,0 +1,59 @@
+// RUN: onnx-mlir-opt --pipeline-partition %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The MatMul is as costly as the two following operations, so it gets a
+/// stage of its own. The input of the model still used by the Add is passed
+/// to the second stage along with the result of the MatMul.
+module {
+  func @main_graph(%arg0 : tensor<4x4xf32>) -> tensor<4x4xf32> {
+    %cst = "onnx.Constant"() {value = dense<1.0> : tensor<4x4xf32>} : () -> tensor<4x4xf32>
+    %0 = "onnx.MatMul"(%arg0, %cst) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %1 = "onnx.Relu"(%0) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+    %2 = "onnx.Add"(%1, %arg0) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    "std.return"(%2) : (tensor<4x4xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK: module attributes {onnx.pipeline_stages = 2 : i64}
+// CHECK-NOT: @main_graph(
+
+// CHECK-LABEL: func @main_graph_stage0
+// CHECK-SAME: ([[ARG0:%.+]]: tensor<4x4xf32>) -> (tensor<4x4xf32>, tensor<4x4xf32>)
+// CHECK: [[CST:%.+]] = "onnx.Constant"()
+// CHECK: [[MATMUL:%.+]] = "onnx.MatMul"([[ARG0]], [[CST]])
+// CHECK: return [[ARG0]], [[MATMUL]] : tensor<4x4xf32>, tensor<4x4xf32>
+// CHECK: "onnx.EntryPoint"() {func = @main_graph_stage0, numInputs = 1 : i32, numOutputs = 2 : i32} : () -> ()
+
+// CHECK-LABEL: func @main_graph_stage1
+// CHECK-SAME: ([[ARG0:%.+]]: tensor<4x4xf32>, [[ARG1:%.+]]: tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[RELU:%.+]] = "onnx.Relu"([[ARG1]])
+// CHECK: [[ADD:%.+]] = "onnx.Add"([[RELU]], [[ARG0]])
+// CHECK: return [[ADD]] : tensor<4x4xf32>
+// CHECK: "onnx.EntryPoint"() {func = @main_graph_stage1, numInputs = 2 : i32, numOutputs = 1 : i32} : () -> ()
+
+// -----
+
+/// Constants are materialized in every stage that uses them.
+module {
+  func @main_graph(%arg0 : tensor<4x4xf32>) -> tensor<4x4xf32> {
+    %cst = "onnx.Constant"() {value = dense<1.0> : tensor<4x4xf32>} : () -> tensor<4x4xf32>
+    %0 = "onnx.Add"(%arg0, %cst) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %1 = "onnx.Mul"(%0, %cst) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    "std.return"(%1) : (tensor<4x4xf32>) -> ()
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32} : () -> ()
+}
+
+// CHECK-LABEL: func @main_graph_stage0
+// CHECK-SAME: ([[ARG0:%.+]]: tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[CST:%.+]] = "onnx.Constant"()
+// CHECK: [[ADD:%.+]] = "onnx.Add"([[ARG0]], [[CST]])
+// CHECK: return [[ADD]] : tensor<4x4xf32>
+
+// CHECK-LABEL: func @main_graph_stage1
+// CHECK-SAME: ([[ARG0:%.+]]: tensor<4x4xf32>) -> tensor<4x4xf32>
+// CHECK: [[CST:%.+]] = "onnx.Constant"()
+// CHECK: [[MUL:%.+]] = "onnx.Mul"([[ARG0]], [[CST]])
+// CHECK: return [[MUL]] : tensor<4x4xf32>
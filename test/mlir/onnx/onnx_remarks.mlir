@@ -0,0 +1,42 @@
+// RUN: onnx-mlir-opt --shape-inference --lower-frontend --enable-memory-pool %s -split-input-file 2>&1 >/dev/null | FileCheck %s
+
+/// The lowering and the memory pool report their decisions for every tensor
+/// of a module requesting remarks, with their fields attached as a note.
+module attributes {onnx.remarks} {
+  func @test_remarks(%arg0: tensor<10x10xf32>) -> tensor<10x10xf32> {
+    %0 = "onnx.Add"(%arg0, %arg0) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32> loc("add0")
+    %1 = "onnx.Add"(%0, %arg0) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32> loc("add1")
+    return %1 : tensor<10x10xf32>
+  }
+
+  // CHECK: remark: [lower-frontend] missed InPlace: no operand of the result type is last read here
+  // CHECK-NEXT: note: {{.*}}kind = "missed", name = "InPlace", pass = "lower-frontend"
+  // CHECK: remark: [lower-frontend] missed InPlace: the result is returned by the function
+  // CHECK-DAG: remark: [enable-memory-pool] applied MemoryPool: 400 bytes allocated from the memory pool
+  // CHECK-DAG: remark: [enable-memory-pool] missed MemoryPool: the tensor is returned by the function
+}
+
+// -----
+
+/// Tensors with dynamic dimensions are not allocated from the memory pool.
+module attributes {onnx.remarks} {
+  func @test_remarks_dynamic(%arg0: tensor<?x10xf32>) -> tensor<?x10xf32> {
+    %0 = "onnx.Relu"(%arg0) : (tensor<?x10xf32>) -> tensor<?x10xf32> loc("relu")
+    %1 = "onnx.Exp"(%0) : (tensor<?x10xf32>) -> tensor<?x10xf32> loc("exp")
+    %2 = "onnx.Neg"(%1) : (tensor<?x10xf32>) -> tensor<?x10xf32> loc("neg")
+    return %2 : tensor<?x10xf32>
+  }
+
+  // CHECK: remark: [enable-memory-pool] missed MemoryPool: the tensor has unbounded dynamic dimensions
+}
+
+// -----
+
+/// Modules that do not request remarks get none.
+func @test_no_remarks(%arg0: tensor<10x10xf32>) -> tensor<10x10xf32> {
+  %0 = "onnx.Add"(%arg0, %arg0) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32> loc("add0")
+  %1 = "onnx.Add"(%0, %arg0) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32> loc("add1")
+  return %1 : tensor<10x10xf32>
+
+  // CHECK-NOT: remark:
+}
@@ -0,0 +1,73 @@
+// RUN: onnx-mlir-opt --fuse-sibling-matmuls %s -split-input-file | FileCheck %s
+
+/// Sibling MatMul operations reading the same input are fused into one
+/// product by the concatenation of their weights, splat or not.
+func @test_fuse_matmuls(%arg0 : tensor<?x8xf32>) -> (tensor<?x1xf32>, tensor<?x1xf32>) {
+  %wq = "onnx.Constant"() {value = dense<1.0> : tensor<8x1xf32>} : () -> tensor<8x1xf32>
+  %wk = "onnx.Constant"() {value = dense<[[1.0], [2.0], [3.0], [4.0], [5.0], [6.0], [7.0], [8.0]]> : tensor<8x1xf32>} : () -> tensor<8x1xf32>
+  %0 = "onnx.MatMul"(%arg0, %wq) : (tensor<?x8xf32>, tensor<8x1xf32>) -> tensor<?x1xf32>
+  %1 = "onnx.MatMul"(%arg0, %wk) : (tensor<?x8xf32>, tensor<8x1xf32>) -> tensor<?x1xf32>
+  return %0, %1 : tensor<?x1xf32>, tensor<?x1xf32>
+
+  // CHECK-LABEL: test_fuse_matmuls
+  // CHECK-NOT: dense<1.000000e+00> : tensor<8x1xf32>
+  // CHECK: [[W:%.+]] = "onnx.Constant"() {value = dense<{{\[\[}}1.000000e+00, 1.000000e+00], [1.000000e+00, 2.000000e+00], [1.000000e+00, 3.000000e+00], [1.000000e+00, 4.000000e+00], [1.000000e+00, 5.000000e+00], [1.000000e+00, 6.000000e+00], [1.000000e+00, 7.000000e+00], [1.000000e+00, 8.000000e+00]]> : tensor<8x2xf32>} : () -> tensor<8x2xf32>
+  // CHECK: [[RES:%.+]] = "onnx.MatMul"(%arg0, [[W]]) : (tensor<?x8xf32>, tensor<8x2xf32>) -> tensor<?x2xf32>
+  // CHECK: [[SPLIT:%.+]]:2 = "onnx.Split"([[RES]]) {axis = 1 : i64, split = [1, 1]} : (tensor<?x2xf32>) -> (tensor<?x1xf32>, tensor<?x1xf32>)
+  // CHECK-NOT: "onnx.MatMul"
+  // CHECK: return [[SPLIT]]#0, [[SPLIT]]#1 : tensor<?x1xf32>, tensor<?x1xf32>
+}
+
+// -----
+
+/// The weights of Gemm operations with transB are concatenated along their
+/// rows, and an absent bias is replaced by zeros.
+func @test_fuse_gemms(%arg0 : tensor<4x8xf32>) -> (tensor<4x2xf32>, tensor<4x1xf32>) {
+  %none = constant unit
+  %w1 = "onnx.Constant"() {value = dense<1.0> : tensor<2x8xf32>} : () -> tensor<2x8xf32>
+  %b1 = "onnx.Constant"() {value = dense<[1.0, 2.0]> : tensor<2xf32>} : () -> tensor<2xf32>
+  %w2 = "onnx.Constant"() {value = dense<2.0> : tensor<1x8xf32>} : () -> tensor<1x8xf32>
+  %0 = "onnx.Gemm"(%arg0, %w1, %b1) {transB = 1 : i64} : (tensor<4x8xf32>, tensor<2x8xf32>, tensor<2xf32>) -> tensor<4x2xf32>
+  %1 = "onnx.Gemm"(%arg0, %w2, %none) {transB = 1 : i64} : (tensor<4x8xf32>, tensor<1x8xf32>, none) -> tensor<4x1xf32>
+  return %0, %1 : tensor<4x2xf32>, tensor<4x1xf32>
+
+  // CHECK-LABEL: test_fuse_gemms
+  // CHECK: [[W:%.+]] = "onnx.Constant"() {value = dense<{{\[\[}}1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00], [1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00, 1.000000e+00], [2.000000e+00, 2.000000e+00, 2.000000e+00, 2.000000e+00, 2.000000e+00, 2.000000e+00, 2.000000e+00, 2.000000e+00]]> : tensor<3x8xf32>} : () -> tensor<3x8xf32>
+  // CHECK: [[B:%.+]] = "onnx.Constant"() {value = dense<[1.000000e+00, 2.000000e+00, 0.000000e+00]> : tensor<3xf32>} : () -> tensor<3xf32>
+  // CHECK: [[RES:%.+]] = "onnx.Gemm"(%arg0, [[W]], [[B]]) {transB = 1 : i64} : (tensor<4x8xf32>, tensor<3x8xf32>, tensor<3xf32>) -> tensor<4x3xf32>
+  // CHECK: [[SPLIT:%.+]]:2 = "onnx.Split"([[RES]]) {axis = 1 : i64, split = [2, 1]} : (tensor<4x3xf32>) -> (tensor<4x2xf32>, tensor<4x1xf32>)
+  // CHECK: return [[SPLIT]]#0, [[SPLIT]]#1 : tensor<4x2xf32>, tensor<4x1xf32>
+}
+
+// -----
+
+/// Products whose outputs are as wide as their input are left as they are,
+/// since splitting the fused result would cost more than it saves.
+func @test_fuse_matmuls_unprofitable(%arg0 : tensor<?x2xf32>) -> (tensor<?x2xf32>, tensor<?x2xf32>) {
+  %wq = "onnx.Constant"() {value = dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  %wk = "onnx.Constant"() {value = dense<[[5.0, 6.0], [7.0, 8.0]]> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  %0 = "onnx.MatMul"(%arg0, %wq) : (tensor<?x2xf32>, tensor<2x2xf32>) -> tensor<?x2xf32>
+  %1 = "onnx.MatMul"(%arg0, %wk) : (tensor<?x2xf32>, tensor<2x2xf32>) -> tensor<?x2xf32>
+  return %0, %1 : tensor<?x2xf32>, tensor<?x2xf32>
+
+  // CHECK-LABEL: test_fuse_matmuls_unprofitable
+  // CHECK: "onnx.MatMul"(%arg0, {{%.+}}) : (tensor<?x2xf32>, tensor<2x2xf32>) -> tensor<?x2xf32>
+  // CHECK: "onnx.MatMul"(%arg0, {{%.+}}) : (tensor<?x2xf32>, tensor<2x2xf32>) -> tensor<?x2xf32>
+  // CHECK-NOT: "onnx.Split"
+}
+
+// -----
+
+/// Products of different inputs, or with non constant weights, are left as
+/// they are.
+func @test_fuse_matmuls_none(%arg0 : tensor<2x2xf32>, %arg1 : tensor<2x2xf32>) -> (tensor<2x2xf32>, tensor<2x2xf32>) {
+  %w = "onnx.Constant"() {value = dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  %0 = "onnx.MatMul"(%arg0, %w) : (tensor<2x2xf32>, tensor<2x2xf32>) -> tensor<2x2xf32>
+  %1 = "onnx.MatMul"(%arg0, %arg1) : (tensor<2x2xf32>, tensor<2x2xf32>) -> tensor<2x2xf32>
+  return %0, %1 : tensor<2x2xf32>, tensor<2x2xf32>
+
+  // CHECK-LABEL: test_fuse_matmuls_none
+  // CHECK: "onnx.MatMul"(%arg0, {{%.+}})
+  // CHECK: "onnx.MatMul"(%arg0, %arg1)
+  // CHECK-NOT: "onnx.Split"
+}
@@ -0,0 +1,108 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/MainUtils.hpp"
+#include "src/Runtime/BatchScorer.hpp"
+
+using namespace std;
+
+// Compile a model adding two 2x3 float tensors into <path>.so.
+void compileAddModel(const string &path) {
+  registerDialects();
+  MLIRContext ctx;
+
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  auto type = RankedTensorType::get({2, 3}, builder.getF32Type());
+  llvm::SmallVector<Type, 2> inputsType{type, type};
+  llvm::SmallVector<Type, 1> outputsType{type};
+
+  auto funcType = builder.getFunctionType(inputsType, outputsType);
+  llvm::SmallVector<NamedAttribute, 1> attrs;
+  auto funcOp = builder.create<FuncOp>(
+      UnknownLoc::get(&ctx), "main_graph", funcType, attrs);
+
+  auto entryBlock = funcOp.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  auto addOp = builder.create<ONNXAddOp>(UnknownLoc::get(&ctx), type,
+      entryBlock->getArgument(0), entryBlock->getArgument(1));
+  llvm::SmallVector<Value, 1> results = {addOp.getResult()};
+  builder.create<ReturnOp>(UnknownLoc::get(&ctx), results);
+  module.push_back(funcOp);
+
+  auto entryPoint = ONNXEntryPointOp::create(UnknownLoc::get(&ctx), funcOp,
+      /*numInputs=*/2,
+      /*numOutputs=*/1);
+  module.push_back(entryPoint);
+
+  OwningModuleRef moduleRef(module);
+  compileModule(moduleRef, ctx, path, EmitLib);
+}
+
+// Write `data` as a .npy file of samples of 3 elements of NumPy type `descr`.
+template <typename T>
+void writeNpy(const string &path, const string &descr, const vector<T> &data) {
+  string header = "{'descr': '" + descr +
+                  "', 'fortran_order': False, 'shape': (" +
+                  to_string(data.size() / 3) + ", 3), }";
+  // The header is padded so that the data is aligned on 64 bytes.
+  header.append(64 - (10 + header.size() + 1) % 64, ' ');
+  header += '\n';
+  ofstream file(path, ios::binary);
+  file.write("\x93NUMPY\x01\x00", 8);
+  file.put(header.size() & 0xff);
+  file.put(header.size() >> 8);
+  file << header;
+  file.write((const char *)data.data(), data.size() * sizeof(T));
+}
+
+int main() {
+  llvm::SmallVector<char, 10> path;
+  llvm::sys::fs::createTemporaryFile("_add", "", path);
+  string pathStr(path.begin(), path.end());
+  llvm::FileRemover remover(path);
+  compileAddModel(pathStr);
+  llvm::FileRemover libRemover(pathStr + ".so");
+
+  string aPath = pathStr + ".a.npy", bPath = pathStr + ".b.npy";
+  string intPath = pathStr + ".int.npy", outPath = pathStr + ".out";
+  llvm::FileRemover aRemover(aPath), bRemover(bPath);
+  llvm::FileRemover intRemover(intPath), outRemover(outPath);
+
+  // Five samples, scored by batches of two, the last one being padded.
+  vector<float> a, b;
+  for (int i = 0; i < 15; i++) {
+    a.emplace_back(i);
+    b.emplace_back(100 * i);
+  }
+  writeNpy(aPath, "<f4", a);
+  writeNpy(bPath, "<f4", b);
+  writeNpy(intPath, "<i4", vector<int32_t>(15, 1));
+
+  onnx_mlir::BatchScorer scorer(pathStr + ".so", /*batchSize=*/2);
+  assert(scorer.score({{aPath, bPath}}, {outPath}) == 5);
+  ifstream out(outPath, ios::binary);
+  vector<char> bytes((istreambuf_iterator<char>(out)), {});
+  assert(bytes.size() == 15 * sizeof(float));
+  for (int i = 0; i < 15; i++)
+    assert(((float *)bytes.data())[i] == a[i] + b[i]);
+
+  // Integers are not read as floats of the same size.
+  bool rejected = false;
+  try {
+    scorer.score({{aPath, intPath}}, {outPath});
+  } catch (const runtime_error &) {
+    rejected = true;
+  }
+  assert(rejected);
+  return 0;
+}
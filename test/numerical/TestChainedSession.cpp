@@ -0,0 +1,129 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/MainUtils.hpp"
+#include "src/Runtime/ChainedSession.hpp"
+
+using namespace std;
+
+// Compile a model applying a binary operation to two 2x3 float tensors into
+// <path>.so, overwriting its inputs if they are donated.
+template <typename BinaryOp>
+void compileBinaryModel(const string &path, bool donateInputs) {
+  registerDialects();
+  MLIRContext ctx;
+
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  auto type = RankedTensorType::get({2, 3}, builder.getF32Type());
+  llvm::SmallVector<Type, 2> inputsType{type, type};
+  llvm::SmallVector<Type, 1> outputsType{type};
+
+  auto funcType = builder.getFunctionType(inputsType, outputsType);
+  llvm::SmallVector<NamedAttribute, 1> attrs;
+  auto funcOp = builder.create<FuncOp>(
+      UnknownLoc::get(&ctx), "main_graph", funcType, attrs);
+
+  auto entryBlock = funcOp.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  auto binaryOp = builder.create<BinaryOp>(UnknownLoc::get(&ctx), type,
+      entryBlock->getArgument(0), entryBlock->getArgument(1));
+  llvm::SmallVector<Value, 1> results = {binaryOp.getResult()};
+  builder.create<ReturnOp>(UnknownLoc::get(&ctx), results);
+  module.push_back(funcOp);
+
+  auto entryPoint = ONNXEntryPointOp::create(UnknownLoc::get(&ctx), funcOp,
+      /*numInputs=*/2,
+      /*numOutputs=*/1);
+  module.push_back(entryPoint);
+  if (donateInputs)
+    module.setAttr(ONNXEntryPointOp::getDonateInputsAttrName(),
+        UnitAttr::get(&ctx));
+
+  OwningModuleRef moduleRef(module);
+  compileModule(moduleRef, ctx, path, EmitLib);
+}
+
+// A 2x3 input owning a copy of data.
+unique_ptr<DynMemRef> getInput(const float *data) {
+  auto *dmr = DynMemRef::create<float>({2, 3});
+  memcpy(dmr->data, data, 6 * sizeof(float));
+  return unique_ptr<DynMemRef>(dmr);
+}
+
+// A chain exposing how it passes a value to a stage that does not use it
+// last.
+class InspectedChain : public onnx_mlir::ChainedSession {
+public:
+  using ChainedSession::ChainedSession;
+  using ChainedSession::borrow;
+};
+
+int main() {
+  llvm::SmallVector<char, 10> addPath, mulPath;
+  llvm::sys::fs::createTemporaryFile("_add", "", addPath);
+  llvm::sys::fs::createTemporaryFile("_mul", "", mulPath);
+  string addPathStr(addPath.begin(), addPath.end());
+  string mulPathStr(mulPath.begin(), mulPath.end());
+  llvm::FileRemover addRemover(addPath);
+  llvm::FileRemover mulRemover(mulPath);
+  compileBinaryModel<ONNXAddOp>(addPathStr, /*donateInputs=*/false);
+  compileBinaryModel<ONNXMulOp>(mulPathStr, /*donateInputs=*/true);
+  llvm::FileRemover addLibRemover(addPathStr + ".so");
+  llvm::FileRemover mulLibRemover(mulPathStr + ".so");
+  string addLib = addPathStr + ".so", mulLib = mulPathStr + ".so";
+
+  float a[6] = {1, 2, 3, 4, 5, 6};
+  float b[6] = {10, 20, 30, 40, 50, 60};
+
+  // Values used last by a stage overwriting its inputs are moved into it:
+  // both products are computed in place into the buffer of the first input.
+  {
+    onnx_mlir::ChainedSession chain({{mulLib, {0, 1}}, {mulLib, {2, 1}}});
+    vector<unique_ptr<DynMemRef>> ins;
+    ins.emplace_back(getInput(a));
+    ins.emplace_back(getInput(b));
+    void *buffer = ins[0]->alignedData;
+    auto outs = chain.run(move(ins));
+    assert(outs.size() == 1);
+    assert(outs[0]->alignedData == buffer && outs[0]->data == buffer);
+    for (int i = 0; i < 6; i++)
+      assert(((float *)buffer)[i] == a[i] * b[i] * b[i]);
+  }
+
+  // Values used again later are passed as views to stages that do not
+  // overwrite their inputs, and as copies to the others.
+  {
+    InspectedChain chain(
+        {{addLib, {0, 1}}, {addLib, {2, 0}}, {mulLib, {2, 3}}}, {2, 4});
+    auto value = getInput(a);
+    unique_ptr<DynMemRef> view(chain.borrow(*value, 1, 0));
+    assert(view->alignedData == value->alignedData && !view->data);
+    unique_ptr<DynMemRef> copy(chain.borrow(*value, 2, 0));
+    assert(copy->alignedData != value->alignedData && copy->data);
+    assert(memcmp(copy->alignedData, a, sizeof(a)) == 0);
+
+    // The sum is returned and read by both later stages, the last of which
+    // overwrites a copy of it.
+    vector<unique_ptr<DynMemRef>> ins;
+    ins.emplace_back(getInput(a));
+    ins.emplace_back(getInput(b));
+    auto outs = chain.run(move(ins));
+    assert(outs.size() == 2);
+    auto *sum = (float *)outs[0]->alignedData;
+    auto *result = (float *)outs[1]->alignedData;
+    assert(outs[1]->alignedData != outs[0]->alignedData);
+    for (int i = 0; i < 6; i++) {
+      assert(sum[i] == a[i] + b[i]);
+      assert(result[i] == (a[i] + b[i]) * (a[i] + b[i] + a[i]));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mlir/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/MainUtils.hpp"
+#include "src/Runtime/InferenceServer.hpp"
+
+using namespace std;
+
+// Compile a model adding two 2x3 float tensors into <path>.so.
+void compileAddModel(const string &path) {
+  registerDialects();
+  MLIRContext ctx;
+
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  auto type = RankedTensorType::get({2, 3}, builder.getF32Type());
+  llvm::SmallVector<Type, 2> inputsType{type, type};
+  llvm::SmallVector<Type, 1> outputsType{type};
+
+  auto funcType = builder.getFunctionType(inputsType, outputsType);
+  llvm::SmallVector<NamedAttribute, 1> attrs;
+  auto funcOp = builder.create<FuncOp>(
+      UnknownLoc::get(&ctx), "main_graph", funcType, attrs);
+
+  auto entryBlock = funcOp.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  auto addOp = builder.create<ONNXAddOp>(UnknownLoc::get(&ctx), type,
+      entryBlock->getArgument(0), entryBlock->getArgument(1));
+  llvm::SmallVector<Value, 1> results = {addOp.getResult()};
+  builder.create<ReturnOp>(UnknownLoc::get(&ctx), results);
+  module.push_back(funcOp);
+
+  auto entryPoint = ONNXEntryPointOp::create(UnknownLoc::get(&ctx), funcOp,
+      /*numInputs=*/2,
+      /*numOutputs=*/1);
+  module.push_back(entryPoint);
+
+  OwningModuleRef moduleRef(module);
+  compileModule(moduleRef, ctx, path, EmitLib);
+}
+
+onnx_mlir::ServedTensor getTensor(float *data, vector<int64_t> dims) {
+  onnx_mlir::ServedTensor tensor;
+  tensor.data = (char *)data;
+  tensor.elementSize = sizeof(float);
+  tensor.dims = dims;
+  return tensor;
+}
+
+int main() {
+  llvm::SmallVector<char, 10> path;
+  llvm::sys::fs::createTemporaryFile("_add", "", path);
+  string pathStr(path.begin(), path.end());
+  llvm::FileRemover remover(path);
+  compileAddModel(pathStr);
+  llvm::FileRemover libRemover(pathStr + ".so");
+
+  // Two unpinned workers serve the model.
+  onnx_mlir::ThreadingConfig config;
+  config.coreGroups = {{}, {}};
+  string socketPath = pathStr + ".sock";
+  onnx_mlir::InferenceServer server(
+      {{"add", pathStr + ".so"}}, socketPath, 1 << 20, config);
+  thread serving([&server] { server.serve(); });
+
+  float a[6] = {1, 2, 3, 4, 5, 6};
+  float b[6] = {10, 20, 30, 40, 50, 60};
+  {
+    onnx_mlir::InferenceClient client(socketPath);
+
+    // The outputs come back through the ring.
+    auto response = client.run(
+        "add", {getTensor(a, {2, 3}), getTensor(b, {2, 3})}, 64);
+    assert(response.error.empty() && response.outputs.size() == 1);
+    auto &output = response.outputs[0];
+    assert((output.dims == vector<int64_t>{2, 3}));
+    for (int i = 0; i < 6; i++)
+      assert(((float *)output.data)[i] == a[i] + b[i]);
+    client.release(response.id);
+
+    // Requests that do not match the signature of the model are rejected.
+    response = client.run("add", {getTensor(a, {2, 3})}, 64);
+    assert(!response.error.empty());
+    client.release(response.id);
+    response = client.run(
+        "add", {getTensor(a, {3, 2}), getTensor(b, {2, 3})}, 64);
+    assert(!response.error.empty());
+    client.release(response.id);
+    response =
+        client.run("add", {getTensor(a, {6}), getTensor(b, {2, 3})}, 64);
+    assert(!response.error.empty());
+    client.release(response.id);
+    response = client.run("mul", {}, 64);
+    assert(!response.error.empty());
+    client.release(response.id);
+  }
+
+  server.stop();
+  serving.join();
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/Module.h"
+
+#include "src/Builder/FrontendDialectHelper.hpp"
+#include "src/MainUtils.hpp"
+
+using namespace std;
+
+// A float initializer holding `values`.
+onnx::TensorProto getInitializer(const string &name, vector<float> values) {
+  onnx::TensorProto tensor;
+  tensor.set_name(name);
+  tensor.set_data_type(onnx::TensorProto::FLOAT);
+  tensor.add_dims(values.size());
+  for (float value : values)
+    tensor.add_float_data(value);
+  return tensor;
+}
+
+// The values of the constant emitted for initializer `name`.
+vector<float> emitInitializer(onnx_mlir::InitializedTensorMapping &mapping,
+    OpBuilder &builder, const string &name) {
+  auto constant = mapping.EmitInitializerForInputTensor(
+      builder.getUnknownLoc(), builder, name);
+  auto attr = cast<ONNXConstantOp>(constant.getDefiningOp())
+                  .valueAttr()
+                  .cast<DenseElementsAttr>();
+  auto values = attr.getValues<float>();
+  return vector<float>(values.begin(), values.end());
+}
+
+int main() {
+  registerDialects();
+  MLIRContext ctx;
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  builder.setInsertionPointToStart(module.getBody());
+
+  auto weights = getInitializer("w", {1, 2, 3});
+  auto unused = getInitializer("unused", {4, 5});
+  auto innerWeights = getInitializer("w", {6});
+
+  onnx_mlir::InitializedTensorMapping mapping;
+  mapping.AddMapping("w", weights);
+  mapping.AddMapping("unused", unused);
+
+  // Only the initializers read by the graph are converted, and the mapping
+  // refers to the initializers of the model instead of copying them.
+  mapping.DecodeInitializers(ctx, {"w", "x"});
+  assert(mapping.IsDecoded("w"));
+  assert(!mapping.IsDecoded("unused"));
+  assert(&mapping.GetInitializedTensor("w") == &weights);
+  assert(emitInitializer(mapping, builder, "w") == vector<float>({1, 2, 3}));
+
+  // Initializers that were not converted are converted on first use.
+  assert(emitInitializer(mapping, builder, "unused") == vector<float>({4, 5}));
+  assert(!mapping.IsDecoded("unused"));
+
+  // The initializers of a subgraph are converted in their own scope.
+  mapping.PushScope();
+  mapping.AddMapping("w", innerWeights);
+  mapping.DecodeInitializers(ctx, {"w", "unused"});
+  assert(mapping.IsDecoded("w") && !mapping.IsDecoded("unused"));
+  assert(&mapping.GetInitializedTensor("w") == &innerWeights);
+  assert(emitInitializer(mapping, builder, "w") == vector<float>({6}));
+  mapping.PopScope();
+  assert(&mapping.GetInitializedTensor("w") == &weights);
+
+  module.erase();
+  return 0;
+}
@@ -0,0 +1,43 @@
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "src/Runtime/Kernels.h"
+
+using namespace std;
+
+// Check the exponential kernel against std::exp, on special values and over
+// the whole range of inputs whose exponential is neither 0 nor infinite.
+void testExpF32() {
+  const float inf = numeric_limits<float>::infinity();
+  vector<float> inputs = {0.f, -0.f, 1.f, -1.f, 88.72f, 88.73f, 100.f, 1e30f,
+      inf, -87.4f, -100.f, -103.9f, -104.f, -110.f, -1e30f, -inf,
+      numeric_limits<float>::quiet_NaN()};
+  for (float x = -105.f; x < 90.f; x += 0.0137f)
+    inputs.emplace_back(x);
+  vector<float> outputs(inputs.size());
+  omKernelExpF32(inputs.data(), outputs.data(), inputs.size());
+
+  for (size_t i = 0; i < inputs.size(); i++) {
+    float expected = exp(inputs[i]);
+    float result = outputs[i];
+    if (isnan(expected)) {
+      assert(isnan(result));
+    } else if (isinf(expected) || expected == 0) {
+      assert(result == expected);
+    } else if (expected >= FLT_MIN) {
+      // Normal results are within a few units in the last place.
+      assert(fabs(result - expected) <= 1e-6f * expected);
+    } else {
+      // Denormal results are within one unit in the last place.
+      assert(fabs(result - expected) <= nextafter(expected, inf) - expected);
+    }
+  }
+}
+
+int main() {
+  testExpF32();
+  return 0;
+}
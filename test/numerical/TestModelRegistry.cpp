@@ -0,0 +1,134 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mlir/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/MainUtils.hpp"
+#include "src/Runtime/ModelRegistry.hpp"
+
+using namespace std;
+
+// Compile a model applying a binary operation to two 2x3 float tensors into
+// <path>.so.
+template <typename BinaryOp>
+void compileBinaryModel(const string &path) {
+  registerDialects();
+  MLIRContext ctx;
+
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  auto type = RankedTensorType::get({2, 3}, builder.getF32Type());
+  llvm::SmallVector<Type, 2> inputsType{type, type};
+  llvm::SmallVector<Type, 1> outputsType{type};
+
+  auto funcType = builder.getFunctionType(inputsType, outputsType);
+  llvm::SmallVector<NamedAttribute, 1> attrs;
+  auto funcOp = builder.create<FuncOp>(
+      UnknownLoc::get(&ctx), "main_graph", funcType, attrs);
+
+  auto entryBlock = funcOp.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  auto binaryOp = builder.create<BinaryOp>(UnknownLoc::get(&ctx), type,
+      entryBlock->getArgument(0), entryBlock->getArgument(1));
+  llvm::SmallVector<Value, 1> results = {binaryOp.getResult()};
+  builder.create<ReturnOp>(UnknownLoc::get(&ctx), results);
+  module.push_back(funcOp);
+
+  auto entryPoint = ONNXEntryPointOp::create(UnknownLoc::get(&ctx), funcOp,
+      /*numInputs=*/2,
+      /*numOutputs=*/1);
+  module.push_back(entryPoint);
+
+  OwningModuleRef moduleRef(module);
+  compileModule(moduleRef, ctx, path, EmitLib);
+}
+
+// A 2x3 input pointing to data owned by the caller.
+unique_ptr<DynMemRef> getInput(float *data) {
+  auto *dmr = new DynMemRef(2);
+  dmr->offset = 0;
+  dmr->sizes[0] = 2;
+  dmr->sizes[1] = 3;
+  dmr->strides[0] = 3;
+  dmr->strides[1] = 1;
+  dmr->data = nullptr;
+  dmr->alignedData = data;
+  return unique_ptr<DynMemRef>(dmr);
+}
+
+int main() {
+  llvm::SmallVector<char, 10> addPath, mulPath;
+  llvm::sys::fs::createTemporaryFile("_add", "", addPath);
+  llvm::sys::fs::createTemporaryFile("_mul", "", mulPath);
+  string addPathStr(addPath.begin(), addPath.end());
+  string mulPathStr(mulPath.begin(), mulPath.end());
+  llvm::FileRemover addRemover(addPath);
+  llvm::FileRemover mulRemover(mulPath);
+  compileBinaryModel<ONNXAddOp>(addPathStr);
+  compileBinaryModel<ONNXMulOp>(mulPathStr);
+  llvm::FileRemover addLibRemover(addPathStr + ".so");
+  llvm::FileRemover mulLibRemover(mulPathStr + ".so");
+
+  onnx_mlir::ModelRegistry registry;
+  registry.load("model", addPathStr + ".so");
+
+  // Clients keep running the model while its version is swapped. Every
+  // request is served by one version or the other, and a client never goes
+  // back to the first version once it has seen the second one.
+  float a[6] = {1, 2, 3, 4, 5, 6};
+  float b[6] = {10, 20, 30, 40, 50, 60};
+  atomic<bool> done(false);
+  atomic<int> added(0), multiplied(0), errors(0);
+  vector<thread> clients;
+  for (int c = 0; c < 4; c++)
+    clients.emplace_back([&] {
+      bool swapped = false;
+      while (!done) {
+        vector<unique_ptr<DynMemRef>> ins;
+        ins.emplace_back(getInput(a));
+        ins.emplace_back(getInput(b));
+        auto outs = registry.run("model", move(ins));
+        auto *result = (float *)outs.at(0)->alignedData;
+        bool isSum = true, isProduct = true;
+        for (int i = 0; i < 6; i++) {
+          isSum &= result[i] == a[i] + b[i];
+          isProduct &= result[i] == a[i] * b[i];
+        }
+        if (isProduct)
+          swapped = true;
+        if (isSum && !swapped)
+          added++;
+        else if (isProduct)
+          multiplied++;
+        else
+          errors++;
+      }
+    });
+
+  while (added < 100)
+    this_thread::sleep_for(chrono::milliseconds(1));
+  registry.loadAsync("model", mulPathStr + ".so").get();
+  int addedBeforeSwap = added;
+  while (multiplied < 100)
+    this_thread::sleep_for(chrono::milliseconds(1));
+  done = true;
+  for (auto &client : clients)
+    client.join();
+
+  // Requests started after the swap only run the second version.
+  assert(errors == 0);
+  assert(added - addedBeforeSwap <= (int)clients.size());
+
+  // The first version was closed with its last request, so its library can
+  // be loaded again.
+  registry.load("model", addPathStr + ".so");
+  registry.unload("model");
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "src/Runtime/RuntimeBitcode.hpp"
+
+using namespace std;
+
+// Report a failed check and exit.
+int fail(const string &message) {
+  llvm::errs() << "TestRuntimeBitcode: " << message << "\n";
+  return 1;
+}
+
+int main() {
+  // Without the runtime bitcode, models are linked against the runtime
+  // libraries instead, which other tests cover.
+  if (!onnx_mlir::getRuntimeBitcodePath()) {
+    cout << "runtime.bc not found, skipping" << endl;
+    return 0;
+  }
+
+  // A model calling the exponential kernel of the runtime.
+  llvm::LLVMContext context;
+  llvm::Module module("model", context);
+  llvm::IRBuilder<> builder(context);
+  auto *floatPtrType = builder.getFloatTy()->getPointerTo();
+  auto *kernelType = llvm::FunctionType::get(builder.getVoidTy(),
+      {floatPtrType, floatPtrType, builder.getInt64Ty()}, /*isVarArg=*/false);
+  auto kernel = module.getOrInsertFunction("omKernelExpF32", kernelType);
+  auto *modelFunc = llvm::Function::Create(
+      kernelType, llvm::GlobalValue::ExternalLinkage, "model", module);
+  builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", modelFunc));
+  llvm::SmallVector<llvm::Value *, 3> args;
+  for (auto &arg : modelFunc->args())
+    args.emplace_back(&arg);
+  builder.CreateCall(kernel, args);
+  builder.CreateRetVoid();
+
+  // Only the functions the model calls are linked, as internal functions.
+  if (auto error = onnx_mlir::linkRuntimeBitcode(module))
+    return fail(llvm::toString(std::move(error)));
+  auto *linked = module.getFunction("omKernelExpF32");
+  if (!linked || linked->isDeclaration() || !linked->hasInternalLinkage())
+    return fail("omKernelExpF32 is not linked as an internal function");
+  if (module.getFunction("omKernelTranspose2DF32"))
+    return fail("omKernelTranspose2DF32 is linked but not called");
+
+  // Once inlined into the model, the internal kernel is dropped.
+  auto optimize = mlir::makeOptimizingTransformer(
+      /*optLevel=*/3, /*sizeLevel=*/0, /*targetMachine=*/nullptr);
+  if (auto error = optimize(&module))
+    return fail(llvm::toString(std::move(error)));
+  if (module.getFunction("omKernelExpF32"))
+    return fail("omKernelExpF32 is not inlined into the model");
+  if (modelFunc->isDeclaration())
+    return fail("the model function is dropped");
+  return 0;
+}
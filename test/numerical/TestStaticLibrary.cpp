@@ -0,0 +1,125 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/Module.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/ExternalUtil.hpp"
+#include "src/MainUtils.hpp"
+#include "src/Runtime/RuntimeBitcode.hpp"
+
+using namespace std;
+
+// Compile a model applying a binary operation to two 2x3 float tensors into
+// the static library <path>.a, whose symbols are prefixed by the file name of
+// `path` and an underscore.
+template <typename BinaryOp>
+void compileBinaryModel(const string &path) {
+  registerDialects();
+  MLIRContext ctx;
+
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  auto type = RankedTensorType::get({2, 3}, builder.getF32Type());
+  llvm::SmallVector<Type, 2> inputsType{type, type};
+  llvm::SmallVector<Type, 1> outputsType{type};
+
+  auto funcType = builder.getFunctionType(inputsType, outputsType);
+  llvm::SmallVector<NamedAttribute, 1> attrs;
+  auto funcOp = builder.create<FuncOp>(
+      UnknownLoc::get(&ctx), "main_graph", funcType, attrs);
+
+  auto entryBlock = funcOp.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  auto binaryOp = builder.create<BinaryOp>(UnknownLoc::get(&ctx), type,
+      entryBlock->getArgument(0), entryBlock->getArgument(1));
+  llvm::SmallVector<Value, 1> results = {binaryOp.getResult()};
+  builder.create<ReturnOp>(UnknownLoc::get(&ctx), results);
+  module.push_back(funcOp);
+
+  auto entryPoint = ONNXEntryPointOp::create(UnknownLoc::get(&ctx), funcOp,
+      /*numInputs=*/2,
+      /*numOutputs=*/1);
+  module.push_back(entryPoint);
+
+  OwningModuleRef moduleRef(module);
+  compileModule(moduleRef, ctx, path, EmitStaticLib);
+}
+
+// A host program running the entry points of both models, which returns 0
+// if they compute the sum and the product of their inputs.
+const char *kHostSource = R"(
+#include "src/Runtime/DynMemRef.h"
+
+extern "C" {
+OrderedDynMemRefDict *add__dyn_entry_point_main_graph(OrderedDynMemRefDict *);
+OrderedDynMemRefDict *mul__dyn_entry_point_main_graph(OrderedDynMemRefDict *);
+}
+
+int main() {
+  auto *a = DynMemRef::create<float>({2, 3});
+  auto *b = DynMemRef::create<float>({2, 3});
+  for (int i = 0; i < 6; i++) {
+    ((float *)a->data)[i] = i;
+    ((float *)b->data)[i] = 10 * i;
+  }
+  auto *ins = createOrderedDynMemRefDict();
+  setDynMemRef(ins, 0, a);
+  setDynMemRef(ins, 1, b);
+  auto *sum = (float *)getDynMemRef(add__dyn_entry_point_main_graph(ins), 0)
+                  ->alignedData;
+  auto *product =
+      (float *)getDynMemRef(mul__dyn_entry_point_main_graph(ins), 0)
+          ->alignedData;
+  for (int i = 0; i < 6; i++)
+    if (sum[i] != i + 10 * i || product[i] != i * 10 * i)
+      return 1;
+  return 0;
+}
+)";
+
+int main() {
+  // Models linked into a host binary need the runtime bitcode.
+  if (!onnx_mlir::getRuntimeBitcodePath()) {
+    cout << "runtime.bc not found, skipping" << endl;
+    return 0;
+  }
+
+  llvm::SmallString<64> dir;
+  llvm::sys::fs::createUniqueDirectory("static_lib", dir);
+  string dirStr = dir.str().str();
+  string addPath = dirStr + "/add", mulPath = dirStr + "/mul";
+  string hostPath = dirStr + "/host";
+  compileBinaryModel<ONNXAddOp>(addPath);
+  compileBinaryModel<ONNXMulOp>(mulPath);
+  ofstream(hostPath + ".cpp") << kHostSource;
+
+  // Both models are linked into the host, their symbols not clashing.
+  vector<string> linkArgs = {
+      llvm::sys::path::filename(onnx_mlir::kCxxPath).str(), "-std=c++14",
+      string("-I") + ONNX_MLIR_SRC_ROOT, hostPath + ".cpp", addPath + ".a",
+      mulPath + ".a", "-L" + onnx_mlir::kRuntimeBitcodeDir, "-lcruntime",
+      "-o", hostPath};
+  vector<llvm::StringRef> linkArgRefs(linkArgs.begin(), linkArgs.end());
+  int linked = llvm::sys::ExecuteAndWait(onnx_mlir::kCxxPath, linkArgRefs);
+  llvm::StringRef runArgs[] = {hostPath};
+  int result = linked == 0 ? llvm::sys::ExecuteAndWait(hostPath, runArgs) : -1;
+
+  for (auto path : {addPath + ".a", mulPath + ".a", hostPath + ".cpp",
+           hostPath})
+    llvm::sys::fs::remove(path);
+  llvm::sys::fs::remove(dirStr);
+  if (linked != 0 || result != 0) {
+    cerr << "TestStaticLibrary: the host binary "
+         << (linked != 0 ? "failed to link" : "returned a wrong result")
+         << endl;
+    return 1;
+  }
+  return 0;
+}
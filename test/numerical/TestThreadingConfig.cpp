@@ -0,0 +1,50 @@
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "src/Runtime/ThreadingConfig.hpp"
+
+using namespace std;
+
+int main() {
+  // Without the environment variables, threads are not pinned.
+  unsetenv("ONNX_MLIR_CORE_GROUPS");
+  unsetenv("ONNX_MLIR_SPIN_US");
+  unsetenv("ONNX_MLIR_QUEUE_DEPTH");
+  auto config = onnx_mlir::ThreadingConfig::fromEnvironment();
+  assert(config.coreGroups.empty());
+  assert(config.spinDuration.count() == 50 && config.queueDepth == 4);
+
+#ifdef __linux__
+  // Core groups only keep the cores the process is allowed to run on.
+  cpu_set_t allowed;
+  assert(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+  int core = 0;
+  while (!CPU_ISSET(core, &allowed))
+    core++;
+  string groups = to_string(core) + "-" + to_string(core) + "," +
+                  to_string(CPU_SETSIZE + 1) + "::" + to_string(core);
+  setenv("ONNX_MLIR_CORE_GROUPS", groups.c_str(), 1);
+  setenv("ONNX_MLIR_SPIN_US", "0", 1);
+  setenv("ONNX_MLIR_QUEUE_DEPTH", "0", 1);
+  config = onnx_mlir::ThreadingConfig::fromEnvironment();
+  assert(config.coreGroups.size() == 3);
+  assert(config.coreGroups[0] == vector<int>{core});
+  assert(config.coreGroups[1].empty());
+  assert(config.coreGroups[2] == vector<int>{core});
+  assert(config.spinDuration.count() == 0 && config.queueDepth == 1);
+
+  // A pinned thread only runs on the cores of its group.
+  onnx_mlir::ThreadingConfig::pinCurrentThread(config.coreGroups[0]);
+  cpu_set_t pinned;
+  pthread_getaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+  assert(CPU_COUNT(&pinned) == 1 && CPU_ISSET(core, &pinned));
+#endif
+  return 0;
+}
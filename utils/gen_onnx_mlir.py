@@ -240,6 +240,8 @@ special_op_handler = dict([
     ("BatchNormalization", "ImportNodeBatchNormalization"),
     ("Pad", "ImportNodePad"),
     ("Reshape", "ImportNodeReshape"),
+    ("If", "ImportNodeIf"),
+    ("Loop", "ImportNodeLoop"),
     #("Transpose", "ImportNodeTranspose")
 ])
 
@@ -253,6 +255,7 @@ OpsWithShapeInference = [
     'Sign', 'Constant', 'AveragePool', 'Abs', 'Conv', 'Concat', 'Neg', 'RNN',
     'LSTM', 'GRU', 'Split', 'Pad', 'Cast', 'ConvTranspose', 'Flatten',
     'DynamicQuantizeLinear', 'QuantizeLinear', 'DequantizeLinear', 'ConvInteger',
+    'If', 'Loop',
 ]
 
 # Operations supporting canonicalization.
@@ -528,12 +531,9 @@ def get_operands_or_results(schema, type_str_dict,  is_input):
         if OpSchema.FormalParameterOption.Optional == value.option:
             types.append("NoneType")
         elif OpSchema.FormalParameterOption.Variadic == value.option:
-            if value.isHomogeneous:
-                types = ["Variadic<{}>".format(any_type_of(types))]
-            else:
-                #TODO handle(variadic, heterogeneous) "
-                sys.stderr.write("warning: (variadic, heterogeneous) for" + schema.name +
-                      ' ' + value.name + "\n")
+            # Elements of a heterogeneous variadic may each have a different
+            # type among the allowed ones.
+            types = ["Variadic<{}>".format(any_type_of(types))]
 
         # Since output name can coincide with that of an input, we explicitly
         # append a suffix "_out" to such names for disambiguation.
@@ -560,6 +560,9 @@ def get_attrs(schema):
 
     name_to_type = OrderedDict()
     for _, attr in sorted(schema.attributes.items()):
+        # Graph attributes are imported as regions.
+        if Text(attr.type) == "AttrType.GRAPH":
+            continue
         qualified_attr_name = "{}.{}".format(schema.name, attr.name)
         if qualified_attr_name in special_attr_defaults:
             name_to_type[attr.name] = get_attr_type_with_default(
@@ -604,6 +607,13 @@ def get_attrs(schema):
             name_to_type[attr.name] = get_attr_type_optional(attr.type)
     return name_to_type
 
+def get_regions(schema):
+    name_to_region = OrderedDict()
+    for _, attr in sorted(schema.attributes.items()):
+        if Text(attr.type) == "AttrType.GRAPH":
+            name_to_region[attr.name] = 'SizedRegion<1>'
+    return name_to_region
+
 def get_numberof_list(mylist):
     expected_num = len(mylist)
     for element in mylist :
@@ -810,6 +820,13 @@ def gen_op_def(schema):
     s += indent + 'let results = (outs {});\n'.format(
         (',\n' + inc_indent(indent)).join(outs_strs))
 
+    # Generate regions (subgraphs held by graph attributes).
+    regions = get_regions(schema)
+    if regions:
+        regions_strs = ["{1}:${0}".format(*i) for i in regions.items()]
+        s += indent + 'let regions = (region {});\n'.format(
+            (',\n' + inc_indent(indent)).join(regions_strs))
+
     # custom_builder_broadcast_ops_list
     
     # add custom builders